@@ -145,8 +145,11 @@ void AccountRegistry::invokeLogin()
                                 d->m_accountsLoading.removeAll(accountId);
                                 emit accountsLoadingChanged();
                             });
-                    connection->assumeIdentity(
-                        account.userId(),
+                    // With the device id saved, connected() comes right
+                    // away, and the state cache and the first sync load while
+                    // the server checks the access token
+                    connection->restoreSession(
+                        account.userId(), account.deviceId(),
                         QString::fromUtf8(accessTokenLoadingJob->binaryData()));
                 });
         accessTokenLoadingJob->start();
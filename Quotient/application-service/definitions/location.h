@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -35,4 +35,25 @@ struct JsonObjectConverter<ThirdPartyLocation> {
     }
 };
 
+template <>
+struct JsonReaderConverter<ThirdPartyLocation> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          ThirdPartyLocation& pod)
+    {
+        if (key == "alias") {
+            readFromJson(reader, pod.alias);
+            return true;
+        }
+        if (key == "protocol") {
+            readFromJson(reader, pod.protocol);
+            return true;
+        }
+        if (key == "fields") {
+            readFromJson(reader, pod.fields);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
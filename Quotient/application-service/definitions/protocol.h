@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 /// Definition of valid values for a field.
@@ -32,6 +32,23 @@ struct JsonObjectConverter<FieldType> {
     }
 };
 
+template <>
+struct JsonReaderConverter<FieldType> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          FieldType& pod)
+    {
+        if (key == "regexp") {
+            readFromJson(reader, pod.regexp);
+            return true;
+        }
+        if (key == "placeholder") {
+            readFromJson(reader, pod.placeholder);
+            return true;
+        }
+        return false;
+    }
+};
+
 struct ProtocolInstance {
     /// A human-readable description for the protocol, such as the name.
     QString desc;
@@ -65,6 +82,31 @@ struct JsonObjectConverter<ProtocolInstance> {
     }
 };
 
+template <>
+struct JsonReaderConverter<ProtocolInstance> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          ProtocolInstance& pod)
+    {
+        if (key == "desc") {
+            readFromJson(reader, pod.desc);
+            return true;
+        }
+        if (key == "fields") {
+            readFromJson(reader, pod.fields);
+            return true;
+        }
+        if (key == "network_id") {
+            readFromJson(reader, pod.networkId);
+            return true;
+        }
+        if (key == "icon") {
+            readFromJson(reader, pod.icon);
+            return true;
+        }
+        return false;
+    }
+};
+
 struct ThirdPartyProtocol {
     /// Fields which may be used to identify a third-party user. These should be
     /// ordered to suggest the way that entities may be grouped, where higher
@@ -114,4 +156,33 @@ struct JsonObjectConverter<ThirdPartyProtocol> {
     }
 };
 
+template <>
+struct JsonReaderConverter<ThirdPartyProtocol> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          ThirdPartyProtocol& pod)
+    {
+        if (key == "user_fields") {
+            readFromJson(reader, pod.userFields);
+            return true;
+        }
+        if (key == "location_fields") {
+            readFromJson(reader, pod.locationFields);
+            return true;
+        }
+        if (key == "icon") {
+            readFromJson(reader, pod.icon);
+            return true;
+        }
+        if (key == "field_types") {
+            readFromJson(reader, pod.fieldTypes);
+            return true;
+        }
+        if (key == "instances") {
+            readFromJson(reader, pod.instances);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
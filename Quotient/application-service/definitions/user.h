@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -35,4 +35,25 @@ struct JsonObjectConverter<ThirdPartyUser> {
     }
 };
 
+template <>
+struct JsonReaderConverter<ThirdPartyUser> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          ThirdPartyUser& pod)
+    {
+        if (key == "userid") {
+            readFromJson(reader, pod.userid);
+            return true;
+        }
+        if (key == "protocol") {
+            readFromJson(reader, pod.protocol);
+            return true;
+        }
+        if (key == "fields") {
+            readFromJson(reader, pod.fields);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
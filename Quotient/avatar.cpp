@@ -8,43 +8,323 @@
 #include "events/eventcontent.h"
 #include "jobs/mediathumbnailjob.h"
 
-#include <QtCore/QDir>
 #include <QtCore/QPointer>
-#include <QtCore/QStandardPaths>
-#include <QtCore/QStringBuilder>
-#include <QtGui/QPainter>
+#ifndef Quotient_NO_GUI
+#    include <QtCore/QCache>
+#    include <QtCore/QStringBuilder>
+#    include <QtCore/QThreadPool>
+#endif
 
 using namespace Quotient;
 using std::move;
 
+#ifndef Quotient_NO_GUI
+namespace {
+//! \brief The process-wide storage of decoded avatar images
+//!
+//! All Avatar objects with the same mxc URL share one record here; images
+//! (both originals and scaled ones) are kept in a QCache with the cost
+//! in kilobytes so that the total memory stays within a budget, the least
+//! recently used images being evicted first. Loading and decoding images, as
+//! well as saving them to the disk cache, are done in a thread pool, with
+//! the results delivered back to the thread where the cache has been created
+//! (normally, the GUI thread). Scaling an image that is already in memory
+//! is quick enough to be done right away.
+class AvatarCache {
+public:
+    static AvatarCache& instance()
+    {
+        static AvatarCache cache;
+        return cache;
+    }
+    ~AvatarCache()
+    {
+        // The tasks refer to the cache; don't let them outlive it
+        pool.clear();
+        pool.waitForDone();
+    }
+
+    QImage get(Connection* connection, const QUrl& url, QSize size,
+               const void* requester, Avatar::get_callback_t callback);
+    //! Drop callbacks registered by \p requester for the given URL
+    void forget(const QUrl& url, const void* requester);
+
+    qsizetype capacity() const { return qsizetype(images.maxCost()) * 1024; }
+    void setCapacity(qsizetype bytes) { images.setMaxCost(int(bytes / 1024)); }
+
+private:
+    AvatarCache() { images.setMaxCost(64 * 1024); } // 64 MiB
+
+    struct Record {
+        //! The size of the biggest thumbnail obtained from the server so far
+        QSize requestedSize;
+        QPointer<MediaThumbnailJob> thumbnailRequest;
+        //! Whether the original is being loaded from the disk or decoded
+        bool loading = false;
+        bool savedOnDisk = true; // Until proven otherwise
+        //! \brief Whether the image from the server couldn't be decoded
+        //!
+        //! Media behind an mxc: URL never change, so it's not requested again.
+        bool undecodable = false;
+        std::vector<QSize> scaledSizes;
+        std::vector<std::pair<const void*, Avatar::get_callback_t>> callbacks;
+    };
+
+    static QString mediaId(const QUrl& url)
+    {
+        return url.authority() + url.path();
+    }
+    static QString scaledKey(const QString& mediaId, QSize size)
+    {
+        return mediaId % u'@' % QString::number(size.width()) % u'x'
+               % QString::number(size.height());
+    }
+    static QString localFile(const QString& mediaId)
+    {
+        static const auto cachePath = cacheLocation(QStringLiteral("avatars"));
+        return cachePath % QString(mediaId).replace(u'/', u'_') % ".png"_ls;
+    }
+    static int cost(const QImage& image)
+    {
+        return int(image.sizeInBytes() / 1024) + 1;
+    }
+
+    template <typename FnT>
+    void runInPool(FnT&& fn);
+    template <typename FnT>
+    void deliver(FnT&& fn);
+
+    void loadFromDisk(const QString& mediaId, Record& r);
+    void requestThumbnail(Connection* connection, const QUrl& url,
+                          const QString& mediaId, QSize size, Record& r);
+    QImage scale(const QString& mediaId, const QImage& original, QSize size,
+                 Record& r);
+    void setOriginal(const QString& mediaId, const QImage& image,
+                     bool fromDisk);
+    static void notify(Record& r);
+
+    QObject context; //!< Receives results from the thread pool
+    QCache<QString, QImage> images;
+    UnorderedMap<QString, Record> records;
+    QThreadPool pool;
+};
+
+template <typename FnT>
+void AvatarCache::runInPool(FnT&& fn)
+{
+    pool.start(std::forward<FnT>(fn));
+}
+
+template <typename FnT>
+void AvatarCache::deliver(FnT&& fn)
+{
+    QMetaObject::invokeMethod(&context, std::forward<FnT>(fn),
+                              Qt::QueuedConnection);
+}
+
+QImage AvatarCache::get(Connection* connection, const QUrl& url, QSize size,
+                        const void* requester,
+                        Avatar::get_callback_t callback)
+{
+    const auto id = mediaId(url);
+    auto& r = records[id];
+    if (r.undecodable)
+        return {};
+    const auto* original = images.object(id);
+    bool startedWork = false;
+    if (!original && !r.loading && r.savedOnDisk
+        && !isJobPending(r.thumbnailRequest)) {
+        loadFromDisk(id, r);
+        startedWork = true;
+    }
+
+    // Alternating between longer-width and longer-height requests is a sure way
+    // to trick the below code into constantly getting another image from
+    // the server because the existing one is alleged unsatisfactory.
+    // Client authors can only blame themselves if they do so.
+    if (!r.loading
+        && ((!original && !isJobPending(r.thumbnailRequest))
+            || size.width() > r.requestedSize.width()
+            || size.height() > r.requestedSize.height())) {
+        requestThumbnail(connection, url, id, size, r);
+        startedWork = true;
+    }
+
+    // Even if a bigger thumbnail has just been requested, give out what
+    // there is until it arrives
+    QImage result;
+    if (const auto* scaled = images.object(scaledKey(id, size)))
+        result = *scaled;
+    else if (original)
+        result = scale(id, *original, size, r);
+
+    if (startedWork
+        || (result.isNull()
+            && std::none_of(r.callbacks.cbegin(), r.callbacks.cend(),
+                            [requester](const auto& c) {
+                                return c.first == requester;
+                            })))
+        r.callbacks.emplace_back(requester, std::move(callback));
+    return result;
+}
+
+void AvatarCache::forget(const QUrl& url, const void* requester)
+{
+    const auto it = records.find(mediaId(url));
+    if (it == records.end())
+        return;
+    auto& r = it->second;
+    std::erase_if(r.callbacks,
+                  [requester](const auto& c) { return c.first == requester; });
+    // The job may be shared with other users of Connection::getThumbnail(),
+    // so it's not abandoned; and its result still goes to the cache
+    if (r.callbacks.empty() && isJobPending(r.thumbnailRequest))
+        r.thumbnailRequest->setPriority(JobPriority::Idle);
+}
+
+void AvatarCache::loadFromDisk(const QString& mediaId, Record& r)
+{
+    r.loading = true;
+    runInPool([this, mediaId, fileName = localFile(mediaId)] {
+        QImage image;
+        image.load(fileName);
+        deliver([this, mediaId, image] { setOriginal(mediaId, image, true); });
+    });
+}
+
+void AvatarCache::requestThumbnail(Connection* connection, const QUrl& url,
+                                   const QString& mediaId, QSize size,
+                                   Record& r)
+{
+    qCDebug(MAIN) << "Getting avatar from" << url.toString();
+    // The server is asked for one of the standard sizes; the thumbnail
+    // obtained this way is then scaled down for all smaller requests
+    const auto prevRequestedSize =
+        std::exchange(r.requestedSize, MediaThumbnailJob::normalizedSize(size));
+    if (isJobPending(r.thumbnailRequest)) {
+        // The smaller thumbnail is not needed here any more; but the job may
+        // be shared (see Connection::getThumbnail()), so only stop listening
+        QObject::disconnect(r.thumbnailRequest, nullptr, &context, nullptr);
+        r.thumbnailRequest->setPriority(JobPriority::Idle);
+    }
+    auto* job = connection->getThumbnail(url, r.requestedSize);
+    r.thumbnailRequest = job;
+    QObject::connect(job, &MediaThumbnailJob::failure, &context,
+                     [this, mediaId, prevRequestedSize] {
+                         auto& r = records[mediaId];
+                         // Allow requesting this size again later
+                         r.requestedSize = prevRequestedSize;
+                         // Nothing is coming; the clients will ask again
+                         // when they need the image
+                         r.callbacks.clear();
+                     });
+    QObject::connect(job, &MediaThumbnailJob::success, &context,
+                     [this, job, mediaId] {
+        auto& r = records[mediaId];
+        r.loading = true;
+        runInPool([this, mediaId, data = job->thumbnailData(),
+                   size = r.requestedSize] {
+            QImage image;
+            if (image.loadFromData(data)) {
+                if (image.width() > size.width()
+                    || image.height() > size.height())
+                    image = image.scaled(size, Qt::KeepAspectRatio,
+                                         Qt::SmoothTransformation);
+                image.save(localFile(mediaId));
+            }
+            deliver(
+                [this, mediaId, image] { setOriginal(mediaId, image, false); });
+        });
+    });
+}
+
+QImage AvatarCache::scale(const QString& mediaId, const QImage& original,
+                          QSize size, Record& r)
+{
+    auto scaled =
+        original.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    if (!images.insert(scaledKey(mediaId, size), new QImage(scaled),
+                       cost(scaled))) {
+        qCWarning(MAIN) << "Scaled avatar for" << mediaId
+                        << "does not fit the avatar cache";
+        return scaled;
+    }
+    if (std::find(r.scaledSizes.cbegin(), r.scaledSizes.cend(), size)
+        == r.scaledSizes.cend())
+        r.scaledSizes.push_back(size);
+    return scaled;
+}
+
+void AvatarCache::setOriginal(const QString& mediaId, const QImage& image,
+                              bool fromDisk)
+{
+    auto& r = records[mediaId];
+    r.loading = false;
+    if (image.isNull()) {
+        if (fromDisk) {
+            r.savedOnDisk = false;
+            // Let the clients ask again, so that the server is queried
+            notify(r);
+            return;
+        }
+        qCWarning(MAIN) << "Couldn't decode the avatar image for" << mediaId
+                        << "- it won't be requested again";
+        r.undecodable = true;
+        r.callbacks.clear(); // There's nothing to wait for any more
+        return;
+    }
+    // "scale" thumbnails keep the aspect ratio, so an image from the disk
+    // can be smaller than the size it has been requested with in one of
+    // the dimensions; normalising its size gives back that size
+    if (fromDisk && r.requestedSize.isEmpty())
+        r.requestedSize = MediaThumbnailJob::normalizedSize(image.size());
+    r.savedOnDisk = true;
+    for (const auto& size : r.scaledSizes)
+        images.remove(scaledKey(mediaId, size));
+    r.scaledSizes.clear();
+    if (!images.insert(mediaId, new QImage(image), cost(image))) {
+        qCWarning(MAIN) << "Avatar image for" << mediaId
+                        << "does not fit the avatar cache";
+        return;
+    }
+    notify(r);
+}
+
+void AvatarCache::notify(Record& r)
+{
+    // Callbacks may call Avatar::get() again, registering new callbacks
+    const auto callbacks = std::exchange(r.callbacks, {});
+    for (const auto& c : callbacks)
+        c.second();
+}
+} // namespace
+#endif // !Quotient_NO_GUI
+
 class Q_DECL_HIDDEN Avatar::Private {
 public:
     explicit Private(QUrl url = {}) : _url(std::move(url)) {}
     ~Private()
     {
-        if (isJobPending(_thumbnailRequest))
-            _thumbnailRequest->abandon();
+#ifndef Quotient_NO_GUI
+        if (!_url.isEmpty())
+            AvatarCache::instance().forget(_url, this);
+#endif
         if (isJobPending(_uploadRequest))
             _uploadRequest->abandon();
     }
 
+#ifndef Quotient_NO_GUI
     QImage get(Connection* connection, QSize size,
                get_callback_t callback) const;
+#endif
     bool upload(UploadContentJob* job, upload_callback_t&& callback);
 
     bool checkUrl(const QUrl& url) const;
-    QString localFile() const;
 
     QUrl _url;
 
-    // The below are related to image caching, hence mutable
-    mutable QImage _originalImage;
-    mutable std::vector<std::pair<QSize, QImage>> _scaledImages;
-    mutable QSize _requestedSize;
-    mutable enum { Unknown, Cache, Network, Banned } _imageSource = Unknown;
-    mutable QPointer<MediaThumbnailJob> _thumbnailRequest = nullptr;
+    mutable bool _banned = false;
     mutable QPointer<BaseJob> _uploadRequest = nullptr;
-    mutable std::vector<get_callback_t> callbacks;
 };
 
 Avatar::Avatar()
@@ -53,6 +333,7 @@ Avatar::Avatar()
 
 Avatar::Avatar(QUrl url) : d(makeImpl<Private>(std::move(url))) {}
 
+#ifndef Quotient_NO_GUI
 QImage Avatar::get(Connection* connection, int dimension,
                    get_callback_t callback) const
 {
@@ -64,6 +345,7 @@ QImage Avatar::get(Connection* connection, int width, int height,
 {
     return d->get(connection, { width, height }, std::move(callback));
 }
+#endif
 
 bool Avatar::upload(Connection* connection, const QString& fileName,
                     upload_callback_t callback) const
@@ -83,6 +365,7 @@ bool Avatar::upload(Connection* connection, QIODevice* source,
 
 QString Avatar::mediaId() const { return d->_url.authority() + d->_url.path(); }
 
+#ifndef Quotient_NO_GUI
 QImage Avatar::Private::get(Connection* connection, QSize size,
                             get_callback_t callback) const
 {
@@ -90,50 +373,13 @@ QImage Avatar::Private::get(Connection* connection, QSize size,
         qCCritical(MAIN) << "Null callbacks are not allowed in Avatar::get";
         Q_ASSERT(false);
     }
+    if (!checkUrl(_url))
+        return {};
 
-    if (_imageSource == Unknown && _originalImage.load(localFile())) {
-        _imageSource = Cache;
-        _requestedSize = _originalImage.size();
-    }
-
-    // Alternating between longer-width and longer-height requests is a sure way
-    // to trick the below code into constantly getting another image from
-    // the server because the existing one is alleged unsatisfactory.
-    // Client authors can only blame themselves if they do so.
-    if (((_imageSource == Unknown && !_thumbnailRequest)
-         || size.width() > _requestedSize.width()
-         || size.height() > _requestedSize.height())
-        && checkUrl(_url)) {
-        qCDebug(MAIN) << "Getting avatar from" << _url.toString();
-        _requestedSize = size;
-        if (isJobPending(_thumbnailRequest))
-            _thumbnailRequest->abandon();
-        if (callback)
-            callbacks.emplace_back(std::move(callback));
-        _thumbnailRequest = connection->getThumbnail(_url, size);
-        QObject::connect(_thumbnailRequest, &MediaThumbnailJob::success,
-                         _thumbnailRequest, [this] {
-                             _imageSource = Network;
-                             _originalImage = _thumbnailRequest->scaledThumbnail(
-                                 _requestedSize);
-                             _originalImage.save(localFile());
-                             _scaledImages.clear();
-                             for (const auto& n : callbacks)
-                                 n();
-                             callbacks.clear();
-                         });
-    }
-
-    for (const auto& [scaledSize, scaledImage] : _scaledImages)
-        if (scaledSize == size)
-            return scaledImage;
-    auto result = _originalImage.isNull()
-                      ? QImage()
-                      : _originalImage.scaled(size, Qt::KeepAspectRatio,
-                                              Qt::SmoothTransformation);
-    _scaledImages.emplace_back(size, result);
-    return result;
+    return AvatarCache::instance().get(connection, _url, size, this,
+                                       std::move(callback));
 }
+#endif
 
 bool Avatar::Private::upload(UploadContentJob* job, upload_callback_t &&callback)
 {
@@ -147,7 +393,7 @@ bool Avatar::Private::upload(UploadContentJob* job, upload_callback_t &&callback
 
 bool Avatar::Private::checkUrl(const QUrl& url) const
 {
-    if (_imageSource == Banned || url.isEmpty())
+    if (_banned || url.isEmpty())
         return false;
 
     // FIXME: Make "mxc" a library-wide constant and maybe even make
@@ -155,15 +401,9 @@ bool Avatar::Private::checkUrl(const QUrl& url) const
     if (!url.isValid() || url.scheme() != "mxc"_ls || url.path().count(u'/') != 1) {
         qCWarning(MAIN) << "Avatar URL is invalid or not mxc-based:"
                         << url.toDisplayString();
-        _imageSource = Banned;
+        _banned = true;
     }
-    return _imageSource != Banned;
-}
-
-QString Avatar::Private::localFile() const
-{
-    static const auto cachePath = cacheLocation(QStringLiteral("avatars"));
-    return cachePath % _url.authority() % u'_' % _url.fileName() % ".png"_ls;
+    return !_banned;
 }
 
 QUrl Avatar::url() const { return d->_url; }
@@ -173,9 +413,20 @@ bool Avatar::updateUrl(const QUrl& newUrl)
     if (newUrl == d->_url)
         return false;
 
+#ifndef Quotient_NO_GUI
+    if (!d->_url.isEmpty())
+        AvatarCache::instance().forget(d->_url, d.get());
+#endif
     d->_url = newUrl;
-    d->_imageSource = Private::Unknown;
-    if (isJobPending(d->_thumbnailRequest))
-        d->_thumbnailRequest->abandon();
+    d->_banned = false;
     return true;
 }
+
+#ifndef Quotient_NO_GUI
+qsizetype Avatar::cacheCapacity() { return AvatarCache::instance().capacity(); }
+
+void Avatar::setCacheCapacity(qsizetype bytes)
+{
+    AvatarCache::instance().setCapacity(bytes);
+}
+#endif
@@ -6,10 +6,14 @@
 #include "util.h"
 
 #include <QtCore/QUrl>
-#include <QtGui/QIcon>
+#ifndef Quotient_NO_GUI
+#    include <QtGui/QImage>
+#endif
 
 #include <functional>
 
+class QIODevice;
+
 namespace Quotient {
 class Connection;
 
@@ -22,10 +26,12 @@ public:
     using get_callback_t = std::function<void()>;
     using upload_callback_t = std::function<void(QUrl)>;
 
+#ifndef Quotient_NO_GUI
     QImage get(Connection* connection, int dimension,
                get_callback_t callback) const;
     QImage get(Connection* connection, int w, int h,
                get_callback_t callback) const;
+#endif
 
     bool upload(Connection* connection, const QString& fileName,
                 upload_callback_t callback) const;
@@ -36,6 +42,17 @@ public:
     QUrl url() const;
     bool updateUrl(const QUrl& newUrl);
 
+#ifndef Quotient_NO_GUI
+    //! \brief The memory budget for decoded avatar images, in bytes
+    //!
+    //! Avatar objects with the same URL share decoded and scaled images
+    //! in a process-wide cache; once the images take more memory than this,
+    //! the least recently used ones are dropped (and loaded again from
+    //! the disk cache when needed). The default is 64 MiB.
+    static qsizetype cacheCapacity();
+    static void setCacheCapacity(qsizetype bytes);
+#endif
+
 private:
     class Private;
     ImplPtr<Private> d;
@@ -9,7 +9,9 @@
 #include "connectiondata.h"
 #include "qt_connection_util.h"
 #include "room.h"
+#include "servermetadatacache.h"
 #include "settings.h"
+#include "tracing.h"
 #include "user.h"
 #include "connection_p.h"
 
@@ -30,6 +32,7 @@
 #include "events/directchatevent.h"
 #include "jobs/downloadfilejob.h"
 #include "jobs/mediathumbnailjob.h"
+#include "jobs/requestdata.h"
 #include "jobs/syncjob.h"
 #include <variant>
 
@@ -38,6 +41,8 @@
 #    include "database.h"
 
 #    include "e2ee/qolminboundsession.h"
+
+#    include <olm/olm.h>
 #endif // Quotient_E2EE_ENABLED
 
 #if QT_VERSION_MAJOR >= 6
@@ -52,10 +57,15 @@
 #include <QtCore/QFile>
 #include <QtCore/QMimeDatabase>
 #include <QtCore/QRegularExpression>
+#include <QtCore/QSaveFile>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QStringBuilder>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
 #include <QtNetwork/QDnsLookup>
 
+#include <algorithm>
+
 using namespace Quotient;
 
 // This is very much Qt-specific; STL iterators don't have key() and value()
@@ -73,6 +83,50 @@ HashT remove_if(HashT& hashMap, Pred pred)
     return removals;
 }
 
+namespace {
+
+//! \brief The thread pool that writes state cache files
+//!
+//! A single thread keeps the writes in the order they were requested, so
+//! that an older snapshot of a file never overwrites a newer one.
+QThreadPool& cacheWriter()
+{
+    static QThreadPool pool;
+    static const auto singleThread [[maybe_unused]] = [] {
+        pool.setMaxThreadCount(1);
+        return true;
+    }();
+    return pool;
+}
+
+//! \brief Serialise and write a state cache file in the background
+//!
+//! The file is written via QSaveFile, so a crash or a write error leaves
+//! the previous version of the file intact.
+void writeCacheFile(QString fileName, QJsonObject json, bool toBinary)
+{
+    cacheWriter().start([fileName = std::move(fileName),
+                         json = std::move(json), toBinary] {
+        const auto data =
+            toBinary ? QCborValue::fromJsonValue(json).toCbor()
+                     : QJsonDocument(json).toJson(QJsonDocument::Compact);
+        QSaveFile outFile { fileName };
+        if (!outFile.open(QIODevice::WriteOnly)) {
+            qCWarning(MAIN) << "Error opening" << fileName << ":"
+                            << outFile.errorString();
+            return;
+        }
+        outFile.write(data);
+        if (outFile.commit())
+            qCDebug(MAIN) << "State cache saved to" << fileName;
+        else
+            qCWarning(MAIN) << "Error saving" << fileName << ":"
+                            << outFile.errorString();
+    });
+}
+
+} // namespace
+
 Connection::Connection(const QUrl& server, QObject* parent)
     : QObject(parent)
     , d(makeImpl<Private>(std::make_unique<ConnectionData>(server)))
@@ -82,6 +136,9 @@ Connection::Connection(const QUrl& server, QObject* parent)
 #endif
     d->q = this; // All d initialization should occur before this line
     setObjectName(server.toString());
+    d->tokenRefreshTimer.setSingleShot(true);
+    connect(&d->tokenRefreshTimer, &QTimer::timeout, this,
+            [this] { d->refreshAccessToken(); });
 }
 
 Connection::Connection(QObject* parent) : Connection({}, parent) {}
@@ -90,6 +147,7 @@ Connection::~Connection()
 {
     qCDebug(MAIN) << "deconstructing connection object for" << userId();
     stopSync();
+    d->flushRoomSaves();
 }
 
 void Connection::resolveServer(const QString& mxid)
@@ -97,7 +155,8 @@ void Connection::resolveServer(const QString& mxid)
     if (isJobPending(d->resolverJob))
         d->resolverJob->abandon();
 
-    auto maybeBaseUrl = QUrl::fromUserInput(serverPart(mxid));
+    const auto serverName = serverPart(mxid);
+    auto maybeBaseUrl = QUrl::fromUserInput(serverName);
     maybeBaseUrl.setScheme("https"_ls); // Instead of the Qt-default "http"
     if (maybeBaseUrl.isEmpty() || !maybeBaseUrl.isValid()) {
         emit resolveError(tr("%1 is not a valid homeserver address")
@@ -105,19 +164,38 @@ void Connection::resolveServer(const QString& mxid)
         return;
     }
 
+    if (const auto cached =
+            ServerMetadataCache::get(ServerMetadataCache::WellKnown, serverName);
+        cached && cached->isFresh()) {
+        const QUrl baseUrl { cached->data.value("base_url"_ls).toString() };
+        qCDebug(MAIN) << "Using cached base URL" << baseUrl.toString() << "for"
+                      << serverName;
+        // Callers connect to homeserverChanged()/loginFlowsChanged() after
+        // calling this, so the result shouldn't come synchronously
+        QTimer::singleShot(0, this, [this, baseUrl] { setHomeserver(baseUrl); });
+        return;
+    }
+
     qCDebug(MAIN) << "Finding the server" << maybeBaseUrl.host();
 
     const auto& oldBaseUrl = d->data->baseUrl();
     d->data->setBaseUrl(maybeBaseUrl); // Temporarily set it for this one call
     d->resolverJob = callApi<GetWellknownJob>();
     // Connect to finished() to make sure baseUrl is restored in any case
-    connect(d->resolverJob, &BaseJob::finished, this, [this, maybeBaseUrl, oldBaseUrl] {
+    connect(d->resolverJob, &BaseJob::finished, this,
+            [this, maybeBaseUrl, oldBaseUrl, serverName] {
         // Revert baseUrl so that setHomeserver() below triggers signals
         // in case the base URL actually changed
         d->data->setBaseUrl(oldBaseUrl);
         if (d->resolverJob->error() == BaseJob::Abandoned)
             return;
 
+        const auto cacheBaseUrl = [this, serverName](const QUrl& baseUrl) {
+            ServerMetadataCache::put(ServerMetadataCache::WellKnown, serverName,
+                                     { { "base_url"_ls, baseUrl.toString() } },
+                                     *d->resolverJob);
+        };
+
         if (d->resolverJob->error() != BaseJob::NotFound) {
             if (!d->resolverJob->status().good()) {
                 qCWarning(MAIN)
@@ -139,13 +217,14 @@ void Connection::resolveServer(const QString& mxid)
             }
             qCInfo(MAIN) << ".well-known URL for" << maybeBaseUrl.host() << "is"
                          << baseUrl.toString();
+            cacheBaseUrl(baseUrl);
             setHomeserver(baseUrl);
         } else {
             qCInfo(MAIN) << "No .well-known file, using" << maybeBaseUrl
                          << "for base URL";
+            cacheBaseUrl(maybeBaseUrl);
             setHomeserver(maybeBaseUrl);
         }
-        Q_ASSERT(d->loginFlowsJob != nullptr); // Ensured by setHomeserver()
     });
 }
 
@@ -218,22 +297,104 @@ void Connection::assumeIdentity(const QString& mxId, const QString& accessToken)
     });
 }
 
+void Connection::restoreSession(const QString& mxId, const QString& deviceId,
+                                const QString& accessToken)
+{
+    if (!d->data->baseUrl().isValid() || deviceId.isEmpty()) {
+        qCDebug(MAIN) << "Not enough saved data to restore the session for"
+                      << mxId << "without the server, connecting as usual";
+        assumeIdentity(mxId, accessToken);
+        return;
+    }
+    d->data->setToken(accessToken.toLatin1());
+    d->data->setDeviceId(deviceId);
+    d->data->setUserId(mxId);
+
+    // Run the checks normally done before connecting alongside the first
+    // requests instead; none of them is needed to load the cache and sync
+    setHomeserver(homeserver()); // Only (re)loads the login flows
+    auto* job = callApi<GetTokenOwnerJob>(BackgroundRequest);
+    connect(job, &BaseJob::success, this, [this, job, mxId, deviceId] {
+        if (job->userId() == mxId && job->deviceId() == deviceId)
+            return;
+        qCWarning(MAIN).nospace()
+            << "The access_token owner (" << job->userId() << '/'
+            << job->deviceId() << ") is different from the saved session ("
+            << mxId << '/' << deviceId << ")!";
+        stopSync();
+        emit loginError(tr("The saved session doesn't match the access token"),
+                        job->rawDataSample());
+    });
+    connect(job, &BaseJob::failure, this, [job] {
+        // An expired token is reported by the sync as well, with loginError()
+        qCWarning(MAIN) << "Couldn't check the access token owner:"
+                        << job->errorString();
+    });
+    d->completeSetup(mxId);
+}
+
+void Connection::Private::loadCapabilities()
+{
+    // Use the cached capabilities right away; if they are stale, also get
+    // the new ones from the server
+    if (const auto cached = ServerMetadataCache::get(
+            ServerMetadataCache::Capabilities, data->baseUrl().toString())) {
+        qCDebug(MAIN) << "Using cached capabilities of"
+                      << data->baseUrl().toDisplayString();
+        applyCapabilities(
+            fromJson<GetCapabilitiesJob::Capabilities>(cached->data));
+        if (cached->isFresh())
+            return;
+    }
+    q->reloadCapabilities();
+}
+
+void Connection::Private::applyCapabilities(
+    GetCapabilitiesJob::Capabilities&& newCapabilities)
+{
+    capabilities = std::move(newCapabilities);
+    if (capabilities.roomVersions) {
+        qCDebug(MAIN) << "Room versions:" << q->defaultRoomVersion()
+                      << "is default, full list:" << q->availableRoomVersions();
+        emit q->capabilitiesLoaded();
+        for (auto* r: std::as_const(roomMap))
+            r->checkVersion();
+    } else
+        qCWarning(MAIN)
+            << "The server returned an empty set of supported versions;"
+               " disabling version upgrade recommendations to reduce noise";
+}
+
 void Connection::reloadCapabilities()
 {
+    const auto server = homeserver().toString();
+    // Another connection to the same server may be getting them already
+    if (auto* job = qobject_cast<GetCapabilitiesJob*>(
+            ServerMetadataCache::pendingRequest(
+                ServerMetadataCache::Capabilities, server))) {
+        if (job == d->capabilitiesJob)
+            return;
+        qCDebug(MAIN) << "Waiting for the capabilities of"
+                      << homeserver().toDisplayString()
+                      << "requested by another connection";
+        // If that request doesn't succeed, make one of our own
+        const auto fallback = connect(job, &QObject::destroyed, this,
+                                      &Connection::reloadCapabilities);
+        connect(job, &BaseJob::success, this, [this, job, fallback] {
+            disconnect(fallback);
+            d->applyCapabilities(job->capabilities());
+        });
+        return;
+    }
     d->capabilitiesJob = callApi<GetCapabilitiesJob>(BackgroundRequest);
+    ServerMetadataCache::setPendingRequest(ServerMetadataCache::Capabilities,
+                                           server, d->capabilitiesJob);
     connect(d->capabilitiesJob, &BaseJob::success, this, [this] {
-        d->capabilities = d->capabilitiesJob->capabilities();
-
-        if (d->capabilities.roomVersions) {
-            qCDebug(MAIN) << "Room versions:" << defaultRoomVersion()
-                          << "is default, full list:" << availableRoomVersions();
-            emit capabilitiesLoaded();
-            for (auto* r: std::as_const(d->roomMap))
-                r->checkVersion();
-        } else
-            qCWarning(MAIN)
-                << "The server returned an empty set of supported versions;"
-                   " disabling version upgrade recommendations to reduce noise";
+        ServerMetadataCache::put(
+            ServerMetadataCache::Capabilities, homeserver().toString(),
+            d->capabilitiesJob->jsonData().value("capabilities"_ls).toObject(),
+            *d->capabilitiesJob);
+        d->applyCapabilities(d->capabilitiesJob->capabilities());
     });
     connect(d->capabilitiesJob, &BaseJob::failure, this, [this] {
         if (d->capabilitiesJob->error() == BaseJob::IncorrectRequest)
@@ -245,10 +406,70 @@ void Connection::reloadCapabilities()
 bool Connection::loadingCapabilities() const
 {
     // (Ab)use the fact that room versions cannot be omitted after
-    // the capabilities have been loaded (see reloadCapabilities() above).
+    // the capabilities have been loaded (see applyCapabilities() above).
     return !d->capabilities.roomVersions;
 }
 
+void Connection::Private::setAccessTokenLifetime(Omittable<int> expiresInMs)
+{
+    using namespace std::chrono;
+    if (!expiresInMs) {
+        data->setAccessTokenExpiry({});
+        tokenRefreshTimer.stop();
+        return;
+    }
+    const milliseconds lifetime { *expiresInMs };
+    data->setAccessTokenExpiry(
+        QDateTime::currentDateTimeUtc().addMSecs(lifetime.count()));
+    // Leave a fifth of the lifetime, but no more than a minute, for
+    // the refresh itself, so that requests never go with an expired token
+    const auto refreshIn = lifetime - std::min(lifetime / 5, milliseconds(1min));
+    qCDebug(MAIN) << "The access token for" << q->objectName() << "expires in"
+                  << duration_cast<seconds>(lifetime).count()
+                  << "s, refreshing it in"
+                  << duration_cast<seconds>(refreshIn).count() << "s";
+    tokenRefreshTimer.start(refreshIn);
+}
+
+void Connection::Private::refreshAccessToken()
+{
+    using namespace std::chrono_literals;
+    if (isJobPending(refreshJob) || data->refreshToken().isEmpty()
+        || !data->baseUrl().isValid())
+        return;
+
+    qCDebug(MAIN) << "Refreshing the access token for" << q->objectName();
+    auto* job = new RefreshJob(QString::fromLatin1(data->refreshToken()));
+    refreshJob = job;
+    // Jobs sent from now on would use the token that's about to be replaced
+    data->holdRequests(job, MaxRefreshHold);
+    q->run(job, ForegroundRequest);
+    connect(job, &BaseJob::success, q, [this, job] {
+        data->setToken(job->accessToken().toLatin1());
+        // The old refresh token can be reused if there's no new one
+        if (const auto newRefreshToken = job->refreshToken();
+            !newRefreshToken.isEmpty())
+            data->setRefreshToken(newRefreshToken.toLatin1());
+        setAccessTokenLifetime(job->expiresInMs());
+        data->releaseRequests();
+        saveAccessTokenToKeychain();
+        emit q->tokensRefreshed();
+    });
+    connect(job, &BaseJob::failure, q, [this, job] {
+        data->releaseRequests();
+        if (job->error() == BaseJob::Unauthorised) {
+            qCWarning(MAIN) << "The refresh token for" << q->objectName()
+                            << "has been rejected, a new login is needed";
+            data->setRefreshToken({});
+            emit q->loginError(job->errorString(), job->rawDataSample());
+            return;
+        }
+        // The job has already retried on its own; try again a bit later,
+        // hopefully before the access token expires
+        tokenRefreshTimer.start(30s);
+    });
+}
+
 void Connection::Private::saveAccessTokenToKeychain() const
 {
     qCDebug(MAIN) << "Saving access token to keychain for" << q->userId();
@@ -297,15 +518,22 @@ void Connection::Private::dropAccessToken()
     });
 
     data->setToken({});
+    data->setRefreshToken({});
+    data->setAccessTokenExpiry({});
+    tokenRefreshTimer.stop();
 }
 
 template <typename... LoginArgTs>
 void Connection::Private::loginToServer(LoginArgTs&&... loginArgs)
 {
     auto loginJob =
-            q->callApi<LoginJob>(std::forward<LoginArgTs>(loginArgs)...);
+            q->callApi<LoginJob>(std::forward<LoginArgTs>(loginArgs)...,
+                                 refreshTokensEnabled ? Omittable<bool>(true)
+                                                      : Omittable<bool>());
     connect(loginJob, &BaseJob::success, q, [this, loginJob] {
         data->setToken(loginJob->accessToken().toLatin1());
+        data->setRefreshToken(loginJob->refreshToken().toLatin1());
+        setAccessTokenLifetime(loginJob->expiresInMs());
         data->setDeviceId(loginJob->deviceId());
         completeSetup(loginJob->userId());
         saveAccessTokenToKeychain();
@@ -328,7 +556,10 @@ void Connection::Private::completeSetup(const QString& mxId, bool mock)
     qCDebug(MAIN) << "Using server" << data->baseUrl().toDisplayString()
                   << "by user" << data->userId()
                   << "from device" << data->deviceId();
-    connect(qApp, &QCoreApplication::aboutToQuit, q, &Connection::saveState);
+    connect(qApp, &QCoreApplication::aboutToQuit, q, [this] {
+        q->saveState();
+        cacheWriter().waitForDone();
+    });
 
     static auto callOnce [[maybe_unused]] = //
         (qInfo(MAIN) << "The library is built"
@@ -353,7 +584,7 @@ void Connection::Private::completeSetup(const QString& mxId, bool mock)
     emit q->stateChanged();
     emit q->connected();
     if (!mock)
-        q->reloadCapabilities();
+        loadCapabilities();
 }
 
 void Connection::Private::checkAndConnect(const QString& userId,
@@ -435,6 +666,13 @@ void Connection::sync(int timeout)
     }
 
     d->syncTimeout = timeout;
+    if (!d->roomIdsToRecover.isEmpty()) {
+        // See Connection::Private::requestRecoveredRooms()
+        qCDebug(MAIN) << "Sync will start once the rooms missing in the state "
+                         "cache are recovered";
+        d->syncAfterRecovery = true;
+        return;
+    }
     Filter filter;
     filter.room.timeline.limit.emplace(100);
     filter.room.state.lazyLoadMembers.emplace(d->lazyLoading);
@@ -506,6 +744,7 @@ QJsonObject toJson(const DirectChatsMap& directChats)
 
 void Connection::onSyncSuccess(SyncData&& data, bool fromCache)
 {
+    const Tracing::Span span { "sync", "onSyncSuccess" };
 #ifdef Quotient_E2EE_ENABLED
     if (d->encryptionData) {
         d->encryptionData->onSyncSuccess(data);
@@ -545,15 +784,140 @@ void Connection::Private::consumeRoomData(SyncDataList&& roomDataList,
         }
         if (auto* r = q->provideRoom(roomData.roomId, roomData.joinState)) {
             pendingStateRoomIds.removeOne(roomData.roomId);
-            // Update rooms one by one, giving time to update the UI.
-            QMetaObject::invokeMethod(
-                r,
-                [r, rd = std::move(roomData), fromCache] () mutable {
-                    r->updateData(std::move(rd), fromCache);
-                },
-                Qt::QueuedConnection);
+            // Save the changes the room has so far before it gets ahead of
+            // the applied sync token, as it won't be saved until the whole
+            // batch is applied after that
+            if (!roomIdsAheadOfAppliedToken.contains(roomData.roomId)
+                && roomIdsToSave.remove(roomData.roomId))
+                writeRoomState(roomData.roomId, q->stateCacheDir());
+            pendingRoomUpdates.push_back({ r, std::move(roomData), fromCache });
         }
     }
+    // Update rooms in time-limited slices, giving time to update the UI.
+    scheduleRoomUpdates();
+}
+
+void Connection::Private::scheduleRoomUpdates()
+{
+    if (roomUpdatesScheduled || pendingRoomUpdates.empty())
+        return;
+    roomUpdatesScheduled = true;
+    QMetaObject::invokeMethod(
+        q,
+        [this] {
+            roomUpdatesScheduled = false;
+            processRoomUpdates(roomUpdateBudget);
+        },
+        Qt::QueuedConnection);
+}
+
+void Connection::Private::processRoomUpdates(std::chrono::milliseconds budget)
+{
+    if (pendingRoomUpdates.empty())
+        return;
+
+    // Rooms the client asked for and rooms with the user's own events still
+    // in flight go first; stable_partition keeps several updates of the same
+    // room in their original order.
+    std::stable_partition(pendingRoomUpdates.begin(), pendingRoomUpdates.end(),
+                          [this](const PendingRoomUpdate& u) {
+                              return u.room
+                                     && (priorityRoomIds.contains(u.room->id())
+                                         || !u.room->pendingEvents().empty());
+                          });
+
+    const Tracing::Span span { "sync", "processRoomUpdates" };
+    QElapsedTimer et;
+    et.start();
+    do {
+        auto update = std::move(pendingRoomUpdates.front());
+        pendingRoomUpdates.pop_front();
+        // The room may have been deleted (e.g. forgotten) in the meantime
+        if (update.room) {
+            if (!update.fromCache)
+                roomIdsAheadOfAppliedToken.insert(update.room->id());
+            update.room->updateData(std::move(update.data), update.fromCache);
+        }
+        ++roomUpdatesDone;
+    } while (!pendingRoomUpdates.empty()
+             && (budget == budget.zero() || et.elapsed() < budget.count()));
+
+    const auto total =
+        roomUpdatesDone + static_cast<qsizetype>(pendingRoomUpdates.size());
+    Tracing::counter("pendingRoomUpdates",
+                     static_cast<qint64>(pendingRoomUpdates.size()));
+    emit q->roomUpdatesProgress(roomUpdatesDone, total);
+    if (pendingRoomUpdates.empty()) {
+        roomUpdatesDone = 0;
+        appliedSyncToken = data->lastEvent();
+        roomIdsAheadOfAppliedToken.clear();
+        // Rooms held back while ahead of the token can be saved now
+        if (!roomIdsToSave.isEmpty()
+            && !std::exchange(roomSavesScheduled, true))
+            QTimer::singleShot(RoomSaveInterval, q,
+                               [this] { flushRoomSaves(); });
+    } else
+        scheduleRoomUpdates();
+}
+
+void Connection::Private::recoverRooms(QStringList roomIds)
+{
+    roomIdsToRecover = std::move(roomIds);
+    recoveryRetryDelay = {};
+    requestRecoveredRooms();
+}
+
+void Connection::Private::requestRecoveredRooms()
+{
+    // An initial sync limited to the given rooms; its next_batch token is
+    // not saved, so the regular sync continues from the cached token. That
+    // sync is held until the recovered rooms are applied (see
+    // Connection::sync()); as it cannot end before the recovery sync, its
+    // data for these rooms can be safely applied over the recovered ones.
+    Filter filter;
+    filter.presence.notTypes = filter.accountData.notTypes = { "*"_ls };
+    filter.room.rooms = roomIdsToRecover;
+    filter.room.includeLeave.emplace(true); // Left rooms are cached as well
+    filter.room.timeline.limit.emplace(100);
+    filter.room.state.lazyLoadMembers.emplace(lazyLoading);
+    auto* job = q->callApi<SyncJob>(BackgroundRequest, QString(), filter);
+    connect(job, &SyncJob::success, q, [this, job] {
+        recoveredRoomData = job->takeData().takeRoomData();
+        qCInfo(MAIN) << "Recovered" << recoveredRoomData.size()
+                     << "room(s) missing in the state cache";
+        // A sync that was already running can bring older data for these
+        // rooms; apply the recovered data after it
+        if (syncJob)
+            connect(syncJob, &QObject::destroyed, q,
+                    [this] { finishRoomRecovery(); });
+        else
+            finishRoomRecovery();
+    });
+    connect(job, &SyncJob::failure, q, [this, job] {
+        if (job->error() == BaseJob::Unauthorised) {
+            // Let the regular sync report that
+            qCWarning(MAIN) << "Could not recover rooms missing in the state "
+                               "cache - login expired?";
+            finishRoomRecovery();
+            return;
+        }
+        recoveryRetryDelay = std::clamp(recoveryRetryDelay * 2,
+                                        MinRecoveryRetryDelay,
+                                        MaxRecoveryRetryDelay);
+        qCWarning(MAIN) << "Could not recover rooms missing in the state "
+                           "cache, retrying in"
+                        << recoveryRetryDelay.count() << "second(s)";
+        QTimer::singleShot(recoveryRetryDelay, q,
+                           [this] { requestRecoveredRooms(); });
+    });
+}
+
+void Connection::Private::finishRoomRecovery()
+{
+    roomIdsToRecover.clear();
+    consumeRoomData(std::exchange(recoveredRoomData, {}), false);
+    if (std::exchange(syncAfterRecovery, false))
+        q->sync(syncTimeout);
 }
 
 void Connection::Private::consumeAccountData(Events&& accountDataEvents)
@@ -657,6 +1021,7 @@ void Connection::stopSync()
 {
     // If there's a sync loop, break it
     disconnect(d->syncLoopConnection);
+    d->syncAfterRecovery = false;
     if (d->syncJob) // If there's an ongoing sync job, stop it too
     {
         if (d->syncJob->status().code == BaseJob::Pending)
@@ -723,9 +1088,26 @@ MediaThumbnailJob* Connection::getThumbnail(const QString& mediaId,
                                             QSize requestedSize,
                                             RunningPolicy policy)
 {
+    // All sizes that normalise to the same one end up at the same URL; so
+    // while a request for it is in flight, there's no point in another one
+    const auto size = MediaThumbnailJob::normalizedSize(requestedSize);
+    const QString key = mediaId % u'@' % QString::number(size.width()) % u'x'
+                        % QString::number(size.height());
+    if (auto* const job = d->thumbnailJobs.value(key).data();
+        isJobPending(job)) {
+        if (policy == ForegroundRequest && job->priority() > JobPriority::Normal)
+            job->setPriority(JobPriority::Normal);
+        return job;
+    }
     auto idParts = splitMediaId(mediaId);
-    return callApi<MediaThumbnailJob>(policy, idParts.front(), idParts.back(),
-                                      requestedSize);
+    auto* const job = callApi<MediaThumbnailJob>(policy, idParts.front(),
+                                                 idParts.back(), size);
+    d->thumbnailJobs.insert(key, job);
+    connect(job, &BaseJob::finished, this, [this, key, job] {
+        if (d->thumbnailJobs.value(key) == job)
+            d->thumbnailJobs.remove(key);
+    });
+    return job;
 }
 
 MediaThumbnailJob* Connection::getThumbnail(const QUrl& url, QSize requestedSize,
@@ -975,13 +1357,35 @@ SendToDeviceJob* Connection::sendToDevices(
                                     generateTxnId(), contents);
 }
 
+namespace {
+class SendWrittenToDeviceJob : public SendToDeviceJob {
+public:
+    SendWrittenToDeviceJob(const QString& eventType, const QString& txnId,
+                           JsonObjectWriter&& body)
+        : SendToDeviceJob(eventType, txnId, {})
+    {
+        // Replace the (empty) body made by the generated constructor
+        setRequestData(std::move(body));
+    }
+};
+} // namespace
+
+SendToDeviceJob* Connection::sendToDevices(const QString& eventType,
+                                           JsonObjectWriter&& body)
+{
+    return callApi<SendWrittenToDeviceJob>(BackgroundRequest, eventType,
+                                           generateTxnId(), std::move(body));
+}
+
 SendMessageJob* Connection::sendMessage(const QString& roomId,
                                         const RoomEvent& event)
 {
     const auto txnId = event.transactionId().isEmpty() ? generateTxnId()
                                                        : event.transactionId();
-    return callApi<SendMessageJob>(roomId, event.matrixType(), txnId,
-                                   event.contentJson());
+    auto* job = callApi<SendMessageJob>(roomId, event.matrixType(), txnId,
+                                        event.contentJson());
+    job->setPriority(JobPriority::Urgent);
+    return job;
 }
 
 QUrl Connection::homeserver() const { return d->data->baseUrl(); }
@@ -1098,8 +1502,8 @@ User* Connection::user(const QString& uId)
 {
     if (uId.isEmpty())
         return nullptr;
-    if (const auto v = d->userMap.value(uId, nullptr))
-        return v;
+    if (const auto it = d->userMap.find(uId); it != d->userMap.cend())
+        return it->second;
     // Before creating a user object, check that the user id is well-formed
     // (it's faster to just do a lookup above before validation)
     if (!uId.startsWith(u'@') || serverPart(uId).isEmpty()) {
@@ -1107,14 +1511,20 @@ User* Connection::user(const QString& uId)
         return nullptr;
     }
     auto* user = userFactory()(this, uId);
-    d->userMap.insert(uId, user);
+    d->userMap.emplace(uId, user);
     emit newUser(user);
     return user;
 }
 
 const User* Connection::user() const
 {
-    return d->userMap.value(userId(), nullptr);
+    return findUser(userId());
+}
+
+User* Connection::findUser(const QString& uId) const
+{
+    const auto it = d->userMap.find(uId);
+    return it != d->userMap.cend() ? it->second : nullptr;
 }
 
 User* Connection::user() { return user(userId()); }
@@ -1132,6 +1542,30 @@ QByteArray Connection::accessToken() const
 
 bool Connection::isLoggedIn() const { return !accessToken().isEmpty(); }
 
+bool Connection::refreshTokensEnabled() const
+{
+    return d->refreshTokensEnabled;
+}
+
+void Connection::setRefreshTokensEnabled(bool enabled)
+{
+    d->refreshTokensEnabled = enabled;
+}
+
+QString Connection::refreshToken() const
+{
+    return QString::fromLatin1(d->data->refreshToken());
+}
+
+void Connection::setRefreshToken(const QString& refreshToken)
+{
+    d->data->setRefreshToken(refreshToken.toLatin1());
+    // The lifetime of the current access token is unknown; refresh it as soon
+    // as possible
+    if (!refreshToken.isEmpty())
+        d->tokenRefreshTimer.start(0);
+}
+
 #ifdef Quotient_E2EE_ENABLED
 QOlmAccount* Connection::olmAccount() const
 {
@@ -1340,7 +1774,13 @@ void Connection::removeFromIgnoredUsers(const User* user)
     }
 }
 
-QMap<QString, User*> Connection::users() const { return d->userMap; }
+QMap<QString, User*> Connection::users() const
+{
+    QMap<QString, User*> result;
+    for (const auto& [id, u] : d->userMap)
+        result.insert(id, u);
+    return result;
+}
 
 const ConnectionData* Connection::connectionData() const
 {
@@ -1384,7 +1824,7 @@ Room* Connection::provideRoom(const QString& id, Omittable<JoinState> joinState)
             emit loadedRoomState(room);
             if (d->capabilities.roomVersions)
                 room->checkVersion();
-            // Otherwise, the version will be checked in reloadCapabilities()
+            // Otherwise, the version will be checked in applyCapabilities()
         });
         emit newRoom(room);
     }
@@ -1459,14 +1899,56 @@ void Connection::setHomeserver(const QUrl& url)
         emit homeserverChanged(homeserver());
     }
 
-    // Whenever a homeserver is updated, retrieve available login flows from it
-    d->loginFlowsJob = callApi<GetLoginFlowsJob>(BackgroundRequest);
-    connect(d->loginFlowsJob, &BaseJob::result, this, [this] {
-        if (d->loginFlowsJob->status().good())
-            d->loginFlows = d->loginFlowsJob->flows();
-        else
-            d->loginFlows.clear();
-        emit loginFlowsChanged();
+    // Whenever a homeserver is updated, retrieve available login flows from
+    // it - or from the cache, revalidating the cached ones if they are stale
+    const auto server = url.toString();
+    if (const auto cached =
+            ServerMetadataCache::get(ServerMetadataCache::LoginFlows, server)) {
+        d->loginFlows = fromJson<QVector<LoginFlow>>(
+            cached->data.value("flows"_ls));
+        // Same as with resolveServer(), callers expect the signal to come
+        // after they connect to it
+        QTimer::singleShot(0, this, &Connection::loginFlowsChanged);
+        if (cached->isFresh())
+            return;
+    }
+    d->loadLoginFlows();
+}
+
+void Connection::Private::loadLoginFlows()
+{
+    const auto server = data->baseUrl().toString();
+    // Another connection to the same server may be getting them already
+    if (auto* job = qobject_cast<GetLoginFlowsJob*>(
+            ServerMetadataCache::pendingRequest(ServerMetadataCache::LoginFlows,
+                                                server))) {
+        // If that request doesn't succeed, make one of our own
+        const auto fallback =
+            QObject::connect(job, &QObject::destroyed, q, [this, server] {
+                if (data->baseUrl().toString() == server)
+                    loadLoginFlows();
+            });
+        QObject::connect(job, &BaseJob::success, q,
+                         [this, job, server, fallback] {
+                             QObject::disconnect(fallback);
+                             if (data->baseUrl().toString() != server)
+                                 return; // The homeserver has changed since
+                             loginFlows = job->flows();
+                             emit q->loginFlowsChanged();
+                         });
+        return;
+    }
+    loginFlowsJob = q->callApi<GetLoginFlowsJob>(BackgroundRequest);
+    ServerMetadataCache::setPendingRequest(ServerMetadataCache::LoginFlows,
+                                           server, loginFlowsJob);
+    QObject::connect(loginFlowsJob, &BaseJob::result, q, [this, server] {
+        if (loginFlowsJob->status().good()) {
+            loginFlows = loginFlowsJob->flows();
+            ServerMetadataCache::put(ServerMetadataCache::LoginFlows, server,
+                                     loginFlowsJob->jsonData(), *loginFlowsJob);
+        } else if (loginFlowsJob->error() != BaseJob::NetworkError)
+            loginFlows.clear(); // Cached flows are better than none
+        emit q->loginFlowsChanged();
     });
 }
 
@@ -1476,19 +1958,39 @@ void Connection::saveRoomState(Room* r) const
     if (!d->cacheState)
         return;
 
-    QFile outRoomFile { stateCacheDir().filePath(
-        SyncData::fileNameForRoom(r->id())) };
-    if (outRoomFile.open(QFile::WriteOnly)) {
-        const auto data =
-            d->cacheToBinary
-                ? QCborValue::fromJsonValue(r->toJson()).toCbor()
-                : QJsonDocument(r->toJson()).toJson(QJsonDocument::Compact);
-        outRoomFile.write(data.data(), data.size());
-        qCDebug(MAIN) << "Room state cache saved to" << outRoomFile.fileName();
-    } else {
-        qCWarning(MAIN) << "Error opening" << outRoomFile.fileName() << ":"
-                        << outRoomFile.errorString();
+    // Bursts of changes in a room only lead to a single write per interval
+    d->roomIdsToSave.insert(r->id());
+    if (std::exchange(d->roomSavesScheduled, true))
+        return;
+    QTimer::singleShot(Private::RoomSaveInterval, d->q,
+                       [this] { d->flushRoomSaves(); });
+}
+
+void Connection::Private::flushRoomSaves()
+{
+    roomSavesScheduled = false;
+    if (!cacheState || roomIdsToSave.isEmpty()) {
+        roomIdsToSave.clear();
+        return;
     }
+    const auto cacheDir = q->stateCacheDir();
+    for (auto it = roomIdsToSave.begin(); it != roomIdsToSave.end();)
+        if (!roomIdsAheadOfAppliedToken.contains(*it)) {
+            writeRoomState(*it, cacheDir);
+            it = roomIdsToSave.erase(it);
+        } else
+            ++it;
+}
+
+void Connection::Private::writeRoomState(const QString& roomId,
+                                         const QDir& cacheDir)
+{
+    auto* r = roomMap.value({ roomId, false });
+    if (!r)
+        r = roomMap.value({ roomId, true });
+    if (r)
+        writeCacheFile(cacheDir.filePath(SyncData::fileNameForRoom(roomId)),
+                       r->toJson(), cacheToBinary);
 }
 
 void Connection::saveState() const
@@ -1496,17 +1998,28 @@ void Connection::saveState() const
     if (!d->cacheState)
         return;
 
-    QElapsedTimer et;
-    et.start();
-
-    QFile outFile { d->topLevelStatePath() };
-    if (!outFile.open(QFile::WriteOnly)) {
-        qCWarning(MAIN) << "Error opening" << outFile.fileName() << ":"
-                        << outFile.errorString();
-        qCWarning(MAIN) << "Caching the rooms state disabled";
-        d->cacheState = false;
+    const Tracing::Span span { "cache", "saveState", userId() };
+
+    // The cache stores the token of the latest sync with all room updates
+    // applied. Updates still pending are left to the next slices rather than
+    // applied all at once here; if the client quits before that, the next
+    // sync from the saved token brings them again. Rooms that have already
+    // applied some of them are not saved until then either (see
+    // flushRoomSaves()), so that no room file is ahead of the token.
+    const auto syncToken = d->pendingRoomUpdates.empty()
+                               ? d->data->lastEvent()
+                               : d->appliedSyncToken;
+    if (syncToken.isEmpty()) {
+        qCDebug(MAIN) << "No sync has been applied to the rooms yet,"
+                         " not saving the state of"
+                      << userId();
         return;
     }
+    // Make sure the room files are queued for writing before the top-level one
+    d->flushRoomSaves();
+
+    QElapsedTimer et;
+    et.start();
 
     QJsonObject rootObj {
         { QStringLiteral("cache_version"),
@@ -1530,7 +2043,7 @@ void Connection::saveState() const
         if (!inviteRoomsJson.isEmpty())
             roomObj.insert(QStringLiteral("invite"), inviteRoomsJson);
 
-        rootObj.insert(QStringLiteral("next_batch"), d->data->lastEvent());
+        rootObj.insert(QStringLiteral("next_batch"), syncToken);
         rootObj.insert(QStringLiteral("rooms"), roomObj);
     }
     {
@@ -1553,13 +2066,9 @@ void Connection::saveState() const
     }
 #endif
 
-    const auto data =
-        d->cacheToBinary ? QCborValue::fromJsonValue(rootObj).toCbor()
-                         : QJsonDocument(rootObj).toJson(QJsonDocument::Compact);
     qCDebug(PROFILER) << "Cache for" << userId() << "generated in" << et;
-
-    outFile.write(data.data(), data.size());
-    qCDebug(MAIN) << "State cache saved to" << outFile.fileName();
+    writeCacheFile(d->topLevelStatePath(), std::move(rootObj),
+                   d->cacheToBinary);
 }
 
 void Connection::loadState()
@@ -1567,6 +2076,7 @@ void Connection::loadState()
     if (!d->cacheState)
         return;
 
+    const Tracing::Span span { "cache", "loadState", userId() };
     QElapsedTimer et;
     et.start();
 
@@ -1574,13 +2084,17 @@ void Connection::loadState()
     if (sync.nextBatch().isEmpty()) // No token means no cache by definition
         return;
 
-    if (!sync.unresolvedRooms().isEmpty()) {
-        qCWarning(MAIN) << "State cache incomplete, discarding";
-        return;
+    if (auto unresolvedRoomIds = sync.unresolvedRooms();
+        !unresolvedRoomIds.isEmpty()) {
+        if (!isLoggedIn()) {
+            qCWarning(MAIN) << "State cache incomplete, discarding";
+            return;
+        }
+        // Load what can be loaded and fetch the rest from the server
+        qCWarning(MAIN) << "State cache incomplete, recovering"
+                        << unresolvedRoomIds.size() << "room(s) from the server";
+        d->recoverRooms(std::move(unresolvedRoomIds));
     }
-    // TODO: to handle load failures, instead of the above block:
-    // 1. Do initial sync on failed rooms without saving the nextBatch token
-    // 2. Do the sync across all rooms as normal
     onSyncSuccess(std::move(sync), true);
     qCDebug(PROFILER) << "*** Cached state for" << userId() << "loaded in" << et;
 }
@@ -1609,6 +2123,53 @@ void Connection::setCacheState(bool newValue)
 
 bool Connection::lazyLoading() const { return d->lazyLoading; }
 
+bool Connection::http2Allowed() const { return d->data->http2Allowed(); }
+
+void Connection::setHttp2Allowed(bool allowed)
+{
+    d->data->setHttp2Allowed(allowed);
+}
+
+int Connection::maxRequestsInFlight(NetworkLane lane) const
+{
+    return d->data->maxRequestsInFlight(lane);
+}
+
+void Connection::setMaxRequestsInFlight(NetworkLane lane, int maxRequests)
+{
+    d->data->setMaxRequestsInFlight(lane, maxRequests);
+}
+
+int Connection::maxRequestsInFlight(JobPriority priority) const
+{
+    return d->data->maxRequestsInFlight(priority);
+}
+
+void Connection::setMaxRequestsInFlight(JobPriority priority, int maxRequests)
+{
+    d->data->setMaxRequestsInFlight(priority, maxRequests);
+}
+
+NetworkLaneStats Connection::networkLaneStats(NetworkLane lane) const
+{
+    return d->data->networkLaneStats(lane);
+}
+
+int Connection::roomUpdateBudget() const
+{
+    return static_cast<int>(d->roomUpdateBudget.count());
+}
+
+void Connection::setRoomUpdateBudget(int msecs)
+{
+    d->roomUpdateBudget = std::chrono::milliseconds(std::max(msecs, 0));
+}
+
+void Connection::setPriorityRoomIds(const QStringList& roomIds)
+{
+    d->priorityRoomIds = QSet<QString>(roomIds.cbegin(), roomIds.cend());
+}
+
 void Connection::setLazyLoading(bool newValue)
 {
     if (d->lazyLoading != newValue) {
@@ -1617,12 +2178,151 @@ void Connection::setLazyLoading(bool newValue)
     }
 }
 
+MemoryUsage Connection::memoryUsage() const
+{
+    static constexpr auto NodeOverhead = MemoryUsage::NodeOverhead;
+    const auto eventsBytes = [](const auto& events) {
+        qint64 bytes = 0;
+        for (const auto& evt : events)
+            bytes += qint64(sizeof(void*)) + MemoryUsage::bytesOf(*evt);
+        return bytes;
+    };
+    MemoryUsage usage;
+
+    // Rooms account for their contents in Room::memoryUsage()
+    qint64 bytes = 0;
+    for (auto it = d->roomMap.cbegin(); it != d->roomMap.cend(); ++it)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(it.key().first)
+                 + qint64(sizeof(Room*));
+    usage.add("roomMap"_ls, d->roomMap.size(), bytes);
+
+    bytes = 0;
+    for (auto it = d->roomAliasMap.cbegin(); it != d->roomAliasMap.cend(); ++it)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(it.key())
+                 + MemoryUsage::bytesOf(*it);
+    usage.add("roomAliasMap"_ls, d->roomAliasMap.size(), bytes);
+
+    bytes = 0;
+    for (const auto& [id, u] : d->userMap)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(id) + qint64(sizeof(User))
+                 + MemoryUsage::bytesOf(u->name());
+    usage.add("userMap"_ls, qsizetype(d->userMap.size()), bytes);
+
+    bytes = 0;
+    for (const auto& [type, evt] : d->accountData)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(type)
+                 + MemoryUsage::bytesOf(*evt);
+    usage.add("accountData"_ls, qsizetype(d->accountData.size()), bytes);
+
+    bytes = 0;
+    for (const auto& roomId : std::as_const(d->directChats))
+        bytes += 2 * (NodeOverhead + MemoryUsage::bytesOf(roomId)
+                      + qint64(sizeof(User*)));
+    usage.add("directChats"_ls, d->directChats.size(), bytes);
+
+    bytes = 0;
+    for (const auto& update : d->pendingRoomUpdates)
+        bytes += qint64(sizeof(Private::PendingRoomUpdate))
+                 + eventsBytes(update.data.state)
+                 + eventsBytes(update.data.timeline)
+                 + eventsBytes(update.data.ephemeral)
+                 + eventsBytes(update.data.accountData);
+    usage.add("pendingRoomUpdates"_ls, qsizetype(d->pendingRoomUpdates.size()),
+              bytes);
+
+#ifdef Quotient_E2EE_ENABLED
+    if (const auto& encryptionData = d->encryptionData) {
+        qsizetype sessionCount = 0;
+        bytes = 0;
+        for (const auto& [senderKey, sessions] : encryptionData->olmSessions) {
+            sessionCount += qsizetype(sessions.size());
+            bytes += NodeOverhead + senderKey.capacity()
+                     + qint64(sessions.size())
+                           * (qint64(sizeof(QOlmSession))
+                              + qint64(olm_session_size()));
+        }
+        usage.add("olmSessions"_ls, sessionCount, bytes);
+
+        qsizetype deviceCount = 0;
+        bytes = 0;
+        for (auto it = encryptionData->deviceKeys.cbegin();
+             it != encryptionData->deviceKeys.cend(); ++it) {
+            bytes += NodeOverhead + MemoryUsage::bytesOf(it.key());
+            deviceCount += it->size();
+            for (auto devIt = it->cbegin(); devIt != it->cend(); ++devIt) {
+                bytes += NodeOverhead + MemoryUsage::bytesOf(devIt.key())
+                         + qint64(sizeof(DeviceKeys));
+                for (const auto& key : devIt->keys)
+                    bytes += NodeOverhead + MemoryUsage::bytesOf(key);
+            }
+        }
+        usage.add("deviceKeys"_ls, deviceCount, bytes);
+
+        bytes = 0;
+        for (const auto& userId : encryptionData->trackedUsers)
+            bytes += NodeOverhead + MemoryUsage::bytesOf(userId);
+        for (const auto& userId : encryptionData->outdatedUsers)
+            bytes += NodeOverhead + MemoryUsage::bytesOf(userId);
+        usage.add("trackedUsers"_ls,
+                  encryptionData->trackedUsers.size()
+                      + encryptionData->outdatedUsers.size(),
+                  bytes);
+    }
+#endif
+    return usage;
+}
+
+QByteArray Connection::memoryUsageMetrics() const
+{
+    const auto escape = [](const QString& labelValue) {
+        auto result = labelValue.toUtf8();
+        result.replace('\\', "\\\\")
+            .replace('"', "\\\"")
+            .replace('\n', "\\n");
+        return result;
+    };
+    QByteArray bytesMetric =
+        "# HELP quotient_memory_bytes Approximate memory used by the data\n"
+        "# TYPE quotient_memory_bytes gauge\n";
+    QByteArray itemsMetric =
+        "# HELP quotient_memory_items Items in data structures\n"
+        "# TYPE quotient_memory_items gauge\n";
+    const auto append = [&](const MemoryUsage& usage, const QByteArray& user,
+                            const QByteArray& roomId) {
+        for (const auto& e : usage.entries) {
+            const QByteArray labels = "{user=\"" % user % "\",room=\"" % roomId
+                                      % "\",structure=\"" % e.structure.toUtf8()
+                                      % "\"} ";
+            bytesMetric += "quotient_memory_bytes" % labels
+                           % QByteArray::number(e.bytes) % '\n';
+            itemsMetric += "quotient_memory_items" % labels
+                           % QByteArray::number(e.items) % '\n';
+        }
+    };
+    const auto user = escape(userId());
+    append(memoryUsage(), user, {});
+    for (auto it = d->roomMap.cbegin(); it != d->roomMap.cend(); ++it)
+        // Invites have little data and come under the same room id as
+        // the joined room, if there's one; count them separately
+        append((*it)->memoryUsage(), user,
+               escape(it.key().second ? it.key().first + "/invite"_ls
+                                      : it.key().first));
+    append(Room::sharedMemoryUsage(), {}, {});
+    append(User::sharedMemoryUsage(), {}, {});
+    return bytesMetric + itemsMetric;
+}
+
 BaseJob* Connection::run(BaseJob* job, RunningPolicy runningPolicy)
 {
     // Reparent to protect from #397, #398 and to prevent BaseJob* from being
     // garbage-collected if made by or returned to QML/JavaScript.
     job->setParent(this);
     connect(job, &BaseJob::failure, this, &Connection::requestFailed);
+    // If the scheduled refresh didn't happen in time (e.g., the machine was
+    // asleep), refresh the access token now; the job will wait for that
+    if (job != d->refreshJob && d->data->accessTokenExpiry().isValid()
+        && d->data->accessTokenExpiry() <= QDateTime::currentDateTimeUtc())
+        d->refreshAccessToken();
     job->initiate(d->data.get(), runningPolicy & BackgroundRequest);
     return job;
 }
@@ -1728,10 +2428,12 @@ bool Connection::isQueryingKeys() const
            && d->encryptionData->currentQueryKeysJob != nullptr;
 }
 
-void Connection::encryptionUpdate(const Room* room, const QList<User*>& invited)
+void Connection::encryptionUpdate(const Room* room,
+                                  const QStringList& invitedIds)
 {
     if (d->encryptionData)
-        d->encryptionData->encryptionUpdate(room->users() + invited);
+        d->encryptionData->encryptionUpdate(room->joinedMemberIds()
+                                            + invitedIds);
 }
 
 QJsonObject Connection::decryptNotification(const QJsonObject& notification)
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include "memoryusage.h"
 #include "quotient_common.h"
 #include "ssosession.h"
 #include "util.h"
@@ -49,6 +50,7 @@ class GetContentJob;
 class DownloadFileJob;
 class SendToDeviceJob;
 class SendMessageJob;
+class JsonObjectWriter;
 class LeaveRoomJob;
 class Database;
 struct EncryptedFileMetadata;
@@ -269,7 +271,12 @@ public:
     //! \sa ignoredUsersListChanged
     Q_INVOKABLE void removeFromIgnoredUsers(const Quotient::User* user);
 
-    //! Get the full list of users known to this account
+    //! \brief Get the full list of users known to this account
+    //!
+    //! \deprecated The list is assembled anew on every call, which takes time
+    //!             proportional to the number of users known to the account;
+    //!             use user() or findUser() to look up individual users.
+    [[deprecated("Use user() or findUser() to look up individual users")]]
     QMap<QString, User*> users() const;
 
     //! Get the base URL of the homeserver to connect to
@@ -301,13 +308,42 @@ public:
                            const QStringList& previousRoomAliases,
                            const QStringList& roomAliases);
     Q_INVOKABLE Quotient::Room* invitation(const QString& roomId) const;
+    //! \brief Get a user object for the given id, creating it if necessary
+    //!
+    //! User objects are QObjects and therefore not particularly cheap; code
+    //! that only needs to check or compare ids should work with ids instead,
+    //! and code that can do without a user object that hasn't been created
+    //! yet should use findUser().
     Q_INVOKABLE Quotient::User* user(const QString& uId);
+    //! \brief Get a user object for the given id if it already exists
+    //!
+    //! Unlike user(), this never creates a new object.
+    User* findUser(const QString& uId) const;
     const User* user() const;
     User* user();
     QString userId() const;
     QString deviceId() const;
     QByteArray accessToken() const;
     bool isLoggedIn() const;
+
+    //! \brief Whether to ask the homeserver for a refresh token at login
+    //!
+    //! With refresh tokens, the access token has a limited lifetime and is
+    //! refreshed shortly before it expires; jobs started while the refresh is
+    //! in progress wait for it and go with the new access token. This is off
+    //! by default because a client that stores only the access token (see
+    //! AccountRegistry) won't be able to restore a session after it expires;
+    //! clients turning it on should save refreshToken() along with
+    //! the access token and pass it to setRefreshToken() after restoring
+    //! the session. The setting must be made before logging in.
+    bool refreshTokensEnabled() const;
+    void setRefreshTokensEnabled(bool enabled);
+    QString refreshToken() const;
+    //! \brief Use the refresh token saved from an earlier session
+    //!
+    //! Since the lifetime of the current access token is unknown in that case,
+    //! it is refreshed right away.
+    void setRefreshToken(const QString& refreshToken);
 #ifdef Quotient_E2EE_ENABLED
     QOlmAccount* olmAccount() const;
     Database* database() const;
@@ -425,7 +461,9 @@ public:
     //!
     //! This method saves the current state of rooms (but not messages
     //! in them) to a local cache file, so that it could be loaded by
-    //! loadState() on a next run of the client.
+    //! loadState() on a next run of the client. The state is saved as of
+    //! the latest sync with all room updates applied; updates still being
+    //! applied (see roomUpdatesProgress()) are not waited for.
     //! \sa loadState
     Q_INVOKABLE void saveState() const;
 
@@ -456,6 +494,69 @@ public:
     bool lazyLoading() const;
     void setLazyLoading(bool newValue);
 
+    //! \brief Whether requests to the homeserver may use HTTP/2
+    //!
+    //! With HTTP/2, requests in the same network lane are multiplexed over
+    //! a single connection to the homeserver instead of (up to) six HTTP/1.1
+    //! connections. This is off by default, as some Qt versions occasionally
+    //! crash when HTTP/2 goes over TLS; clients can turn it on for homeservers
+    //! known to support it.
+    //! \sa NetworkLane
+    bool http2Allowed() const;
+    void setHttp2Allowed(bool allowed);
+
+    //! \brief The limit of concurrent requests in the given network lane
+    //!
+    //! Requests beyond the limit wait until earlier ones in the same lane
+    //! finish; 0 means no limit other than that of Qt's network stack. Only
+    //! NetworkLane::Bulk is limited by default, to 4 requests.
+    int maxRequestsInFlight(NetworkLane lane) const;
+    void setMaxRequestsInFlight(NetworkLane lane, int maxRequests);
+    //! \brief The limit of concurrent requests in the given priority class
+    //!
+    //! Same as for network lanes, 0 means no limit. By default, only
+    //! JobPriority::Background and JobPriority::Idle are limited, to 3 and 2
+    //! requests respectively.
+    //! \sa JobPriority
+    int maxRequestsInFlight(JobPriority priority) const;
+    void setMaxRequestsInFlight(JobPriority priority, int maxRequests);
+    //! Request counters for the given network lane
+    NetworkLaneStats networkLaneStats(NetworkLane lane) const;
+
+    //! \brief Approximate memory used by the connection's own data
+    //!
+    //! Covers maps of rooms and users, account data, direct chats and,
+    //! with E2EE, Olm sessions and device keys; rooms have their own
+    //! accounting in Room::memoryUsage().
+    //! \sa MemoryUsage, memoryUsageMetrics
+    MemoryUsage memoryUsage() const;
+
+    //! \brief Memory usage of the connection and all its rooms as metrics
+    //!
+    //! Returns gauges in the Prometheus text exposition format:
+    //! \c quotient_memory_bytes and \c quotient_memory_items, labelled with
+    //! \c user, \c room (empty for data of the connection or data shared
+    //! among all connections; for invites, the room id has \c /invite
+    //! appended) and \c structure. Data shared among connections is marked
+    //! with \c user="" and reported by every connection.
+    QByteArray memoryUsageMetrics() const;
+
+    //! \brief Time budget for applying sync updates to rooms, in milliseconds
+    //!
+    //! Room updates from a sync (or from the cache) are applied in slices,
+    //! each taking roughly this long, so that the event loop (and the UI) can
+    //! run in between. At least one room is updated per slice; 0 means
+    //! no limit. The default is 8 ms.
+    //! \sa roomUpdatesProgress
+    int roomUpdateBudget() const;
+    void setRoomUpdateBudget(int msecs);
+
+    //! \brief Set rooms that should receive sync updates before others
+    //!
+    //! Use this to pass the rooms currently displayed by the client. Rooms
+    //! with pending (not yet sent) events are prioritised automatically.
+    void setPriorityRoomIds(const QStringList& roomIds);
+
     //! Start a pre-created job object on this connection
     Q_INVOKABLE BaseJob* run(BaseJob* job,
                              RunningPolicy runningPolicy = ForegroundRequest);
@@ -465,7 +566,9 @@ public:
     //! This is a universal method to create and start a job of a type passed
     //! as a template parameter. The policy allows to fine-tune the way
     //! the job is executed - as of this writing it means a choice
-    //! between "foreground" and "background".
+    //! between "foreground" and "background", which also determines
+    //! the default priority class of the job; to choose another class, call
+    //! BaseJob::setPriority() on the returned job.
     //!
     //! \param runningPolicy controls how the job is executed
     //! \param jobArgs arguments to the job constructor
@@ -614,6 +717,22 @@ public Q_SLOTS:
     //! \since 0.7.2
     void assumeIdentity(const QString& mxId, const QString& accessToken);
 
+    //! \brief Restore a saved session without waiting for the server
+    //!
+    //! Unlike assumeIdentity(), this neither resolves the homeserver nor
+    //! waits for it to confirm the access token before emitting connected():
+    //! it uses the homeserver URL passed to the constructor, \p deviceId saved
+    //! from the previous session and the cached capabilities (see
+    //! ServerMetadataCache), so that loadState() and the first sync can start
+    //! right away. The access token
+    //! and login flows are checked in the background; if the token turns out
+    //! to belong to a different user or device, the sync is stopped and
+    //! loginError() is emitted. Without a valid homeserver URL or a device id
+    //! this is the same as assumeIdentity().
+    //! \sa AccountRegistry::invokeLogin
+    void restoreSession(const QString& mxId, const QString& deviceId,
+                        const QString& accessToken);
+
     //! Explicitly request capabilities from the server
     void reloadCapabilities();
 
@@ -624,6 +743,18 @@ public Q_SLOTS:
 
     void stopSync();
 
+    //! \brief Get a thumbnail for the media item
+    //!
+    //! The size actually requested from the server is normalised to one of
+    //! the standard thumbnail sizes, see MediaThumbnailJob::normalizedSize().
+    //! By default, thumbnails are loaded in the background; clients that
+    //! know which thumbnails are visible can adjust the priority of the job
+    //! as they scroll (see BaseJob::setPriority()).
+    //!
+    //! While a request for the same media item and normalised size is in
+    //! flight, that request is returned instead of a new one; so the job
+    //! may be shared with other callers and should only be abandoned when
+    //! nobody else can be waiting for it.
     virtual MediaThumbnailJob*
     getThumbnail(const QString& mediaId, QSize requestedSize,
                  RunningPolicy policy = BackgroundRequest);
@@ -726,6 +857,14 @@ public Q_SLOTS:
 
     SendToDeviceJob* sendToDevices(const QString& eventType,
                                    const UsersToDevicesToContent& contents);
+    //! \brief Send to-device events written directly into the request body
+    //!
+    //! This overload is for large payloads, avoiding intermediate copies of
+    //! them. \p body is the whole request body: the same user id ->
+    //! device id -> content structure as \p contents in the other overload
+    //! should be written into it after `beginObject("messages")`.
+    SendToDeviceJob* sendToDevices(const QString& eventType,
+                                   JsonObjectWriter&& body);
 
     [[deprecated("This method is experimental and may be removed any time")]] //
     SendMessageJob* sendMessage(const QString& roomId, const RoomEvent& event);
@@ -737,7 +876,7 @@ public Q_SLOTS:
     KeyVerificationSession* startKeyVerificationSession(const QString& userId,
                                                         const QString& deviceId);
 
-    void encryptionUpdate(const Room* room, const QList<User*>& invited = {});
+    void encryptionUpdate(const Room* room, const QStringList& invitedIds = {});
 #endif
 
     static Connection* makeMockConnection(const QString& mxId,
@@ -765,6 +904,12 @@ Q_SIGNALS:
     //! a successful login and logout and are constant at other times.
     void stateChanged();
     void loginError(QString message, QString details);
+    //! \brief The access token has been refreshed
+    //!
+    //! Clients that store the access and refresh tokens should update them
+    //! when this is emitted.
+    //! \sa refreshTokensEnabled
+    void tokensRefreshed();
 
     //! \brief A network request (job) started by callApi() has failed
     //! \param request the pointer to the failed job
@@ -785,6 +930,13 @@ Q_SIGNALS:
                       int nextRetryInMilliseconds);
 
     void syncDone();
+
+    //! \brief Progress of applying sync updates to rooms
+    //!
+    //! Emitted after each slice of room updates; \p done equals \p total
+    //! when all updates received so far have been applied.
+    //! \sa roomUpdateBudget
+    void roomUpdatesProgress(qsizetype done, qsizetype total);
     void syncError(QString message, QString details);
 
     void newUser(Quotient::User* user);
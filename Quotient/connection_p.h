@@ -11,8 +11,11 @@
 
 #include "csapi/capabilities.h"
 #include "csapi/logout.h"
+#include "csapi/refresh.h"
 #include "csapi/wellknown.h"
 
+#include "jobs/mediathumbnailjob.h"
+
 #ifdef Quotient_E2EE_ENABLED
 #    include "connectionencryptiondata_p.h"
 #endif
@@ -21,6 +24,10 @@
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QPointer>
+#include <QtCore/QTimer>
+
+#include <chrono>
+#include <deque>
 
 namespace Quotient {
 
@@ -44,7 +51,7 @@ public:
     QHash<QString, QString> roomAliasMap;
     QVector<QString> roomIdsToForget;
     QVector<QString> pendingStateRoomIds;
-    QMap<QString, User*> userMap;
+    UnorderedMap<QString, User*> userMap;
     DirectChatsMap directChats;
     DirectChatUsersMap directChatUsers;
     // The below two variables track local changes between sync completions.
@@ -74,6 +81,12 @@ public:
     SyncJob* syncJob = nullptr;
     QPointer<LogoutJob> logoutJob = nullptr;
 
+    bool refreshTokensEnabled = false;
+    QPointer<RefreshJob> refreshJob = nullptr;
+    QTimer tokenRefreshTimer;
+    //! The longest time jobs wait for the access token to be refreshed
+    static constexpr auto MaxRefreshHold = std::chrono::seconds(10);
+
     bool cacheState = true;
     bool cacheToBinary =
         SettingsGroup("libQuotient"_ls).get("cache_type"_ls,
@@ -81,6 +94,40 @@ public:
         != "json"_ls;
     bool lazyLoading = false;
 
+    struct PendingRoomUpdate {
+        QPointer<Room> room;
+        SyncRoomData data;
+        bool fromCache;
+    };
+    std::deque<PendingRoomUpdate> pendingRoomUpdates;
+    QSet<QString> priorityRoomIds;
+    std::chrono::milliseconds roomUpdateBudget { 8 };
+    qsizetype roomUpdatesDone = 0;
+    bool roomUpdatesScheduled = false;
+    //! The latest sync token as of the moment all room updates were applied
+    QString appliedSyncToken;
+
+    static constexpr auto RoomSaveInterval = std::chrono::seconds(3);
+    QSet<QString> roomIdsToSave;
+    bool roomSavesScheduled = false;
+    //! \brief Rooms that have applied updates newer than appliedSyncToken
+    //!
+    //! These are only saved once all pending updates are applied, so that
+    //! no room file is ahead of the sync token in the top-level cache file.
+    QSet<QString> roomIdsAheadOfAppliedToken;
+
+    //! Rooms that failed to load from the state cache and are being fetched
+    QStringList roomIdsToRecover;
+    SyncDataList recoveredRoomData;
+    static constexpr auto MinRecoveryRetryDelay = std::chrono::seconds(5);
+    static constexpr auto MaxRecoveryRetryDelay = std::chrono::seconds(300);
+    std::chrono::seconds recoveryRetryDelay { 0 };
+    //! Set when sync() is called while rooms are being recovered
+    bool syncAfterRecovery = false;
+
+    //! Thumbnail requests in flight, by media id and normalised size
+    QHash<QString, QPointer<MediaThumbnailJob>> thumbnailJobs;
+
     /** \brief Check the homeserver and resolve it if needed, before connecting
      *
      * A single entry for functions that need to check whether the homeserver
@@ -102,9 +149,35 @@ public:
     template <typename... LoginArgTs>
     void loginToServer(LoginArgTs&&... loginArgs);
     void completeSetup(const QString &mxId, bool mock = false);
+    //! Use the cached capabilities and/or get them from the server
+    void loadCapabilities();
+    void applyCapabilities(GetCapabilitiesJob::Capabilities&& newCapabilities);
+    //! Get the login flows, sharing the request with other connections
+    void loadLoginFlows();
     void removeRoom(const QString& roomId);
 
     void consumeRoomData(SyncDataList&& roomDataList, bool fromCache);
+    //! \brief Fetch rooms that failed to load from the state cache
+    //!
+    //! The regular sync is held until the recovered rooms are applied, and
+    //! failed attempts are retried with an increasing delay.
+    void recoverRooms(QStringList roomIds);
+    void requestRecoveredRooms();
+    void finishRoomRecovery();
+    //! \brief Apply pending room updates until the time budget runs out
+    //!
+    //! Rooms in priorityRoomIds and rooms with pending events are updated
+    //! first; if any updates remain after the budget is spent, another slice
+    //! is scheduled on the event loop. Passing a zero budget applies all
+    //! pending updates right away.
+    void processRoomUpdates(std::chrono::milliseconds budget);
+    void scheduleRoomUpdates();
+    //! \brief Snapshot the rooms marked for saving and queue writing their caches
+    //!
+    //! Rooms in roomIdsAheadOfAppliedToken stay marked until all pending
+    //! room updates are applied.
+    void flushRoomSaves();
+    void writeRoomState(const QString& roomId, const QDir& cacheDir);
     void consumeAccountData(Events&& accountDataEvents);
     void consumePresenceData(Events&& presenceData);
     void consumeToDeviceEvents(Events&& toDeviceEvents);
@@ -129,6 +202,11 @@ public:
         return q->stateCacheDir().filePath("state.json"_ls);
     }
 
+    //! Remember when the access token expires and schedule its refresh
+    void setAccessTokenLifetime(Omittable<int> expiresInMs);
+    //! Refresh the access token now, if there's a refresh token
+    void refreshAccessToken();
+
     void saveAccessTokenToKeychain() const;
     void dropAccessToken();
 };
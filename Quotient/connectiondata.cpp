@@ -10,21 +10,33 @@
 
 #include <QtCore/QTimer>
 #include <QtCore/QPointer>
+#include <QtNetwork/QNetworkReply>
 
+#include <algorithm>
 #include <array>
-#include <queue>
+#include <deque>
+#include <numeric>
 
 using namespace Quotient;
+using namespace std::chrono;
 
 class ConnectionData::Private {
 public:
     explicit Private(QUrl url) : baseUrl(std::move(url))
     {
         rateLimiter.setSingleShot(true);
+        holdTimer.setSingleShot(true);
+        lanes[size_t(NetworkLane::Bulk)].maxInFlight = DefaultMaxBulkRequests;
+        priorityClasses[size_t(JobPriority::Background)].maxInFlight =
+            DefaultMaxBackgroundRequests;
+        priorityClasses[size_t(JobPriority::Idle)].maxInFlight =
+            DefaultMaxIdleRequests;
     }
 
     QUrl baseUrl;
     QByteArray accessToken;
+    QByteArray refreshToken;
+    QDateTime accessTokenExpiry;
     QString lastEvent;
     QString userId;
     QString deviceId;
@@ -35,40 +47,165 @@ public:
 
     QString id() const { return userId + u'/' + deviceId; }
 
-    using job_queue_t = std::queue<QPointer<BaseJob>>;
-    std::array<job_queue_t, 2> jobs; // 0 - foreground, 1 - background
-    QTimer rateLimiter;
+    struct QueuedJob {
+        QPointer<BaseJob> job;
+        steady_clock::time_point queuedAt;
+    };
+    using job_queue_t = std::deque<QueuedJob>;
+    std::array<job_queue_t, JobPriorityCount> jobs; // One per priority class
+    QTimer rateLimiter; // Also dispatches queued jobs, see the constructor
+    // Stays after the jobs are released, until the job is gone
+    QPointer<const BaseJob> refreshJob;
+    QTimer holdTimer; // Active while requests are held
+
+    bool http2Allowed = false;
+
+    // Media transfers are many and long, and without a limit would take up
+    // the bandwidth needed for everything else
+    static constexpr int DefaultMaxBulkRequests = 4;
+    // Qt opens up to 6 HTTP/1.1 connections per host; the limits below keep
+    // at least one of them for urgent and normal jobs
+    static constexpr int DefaultMaxBackgroundRequests = 3;
+    static constexpr int DefaultMaxIdleRequests = 2;
+    // A job that waited this long is sent before jobs of higher classes
+    static constexpr auto StarvationThreshold = 5s;
+
+    struct RequestGroup {
+        int maxInFlight = 0;
+        std::vector<QPointer<QNetworkReply>> running;
+
+        void prune()
+        {
+            std::erase_if(running, [](const QPointer<QNetworkReply>& r) {
+                return !r || !r->isRunning();
+            });
+        }
+        bool isFull() const
+        {
+            return maxInFlight > 0 && std::ssize(running) >= maxInFlight;
+        }
+    };
+    struct Lane : RequestGroup {
+        quint64 sent = 0;
+        quint64 sentOverHttp2 = 0;
+    };
+    std::array<Lane, NetworkLaneCount> lanes;
+    std::array<RequestGroup, JobPriorityCount> priorityClasses;
+    // The context for connections to replies, to disconnect them when
+    // ConnectionData is destroyed (replies belong to the thread's NAM)
+    QObject replyContext;
+
+    void scheduleDispatch()
+    {
+        // If the timer is active, either a dispatch is already scheduled or
+        // the rate limit is in effect
+        if (!rateLimiter.isActive())
+            rateLimiter.start(0);
+    }
+    //! \brief Take the next job that can be sent out of the queues
+    //!
+    //! This is the first job in the highest priority class that doesn't
+    //! exceed the limits of its class and its network lane, unless a job in
+    //! a lower class has been waiting for longer than StarvationThreshold.
+    BaseJob* takeNextJob();
+    void sendRequest(BaseJob* job);
 };
 
+BaseJob* ConnectionData::Private::takeNextJob()
+{
+    for (auto& lane : lanes)
+        lane.prune();
+    for (auto& priorityClass : priorityClasses)
+        priorityClass.prune();
+
+    const auto now = steady_clock::now();
+    job_queue_t* pickedQueue = nullptr;
+    job_queue_t::iterator picked;
+    for (auto& queue : jobs) {
+        std::erase_if(queue, [](const QueuedJob& j) {
+            return !j.job || j.job->error() == BaseJob::Abandoned;
+        });
+        const auto it =
+            std::find_if(queue.begin(), queue.end(), [this](const QueuedJob& j) {
+                return !lanes[size_t(j.job->networkLane())].isFull()
+                       && !priorityClasses[size_t(j.job->priority())].isFull();
+            });
+        if (it == queue.end())
+            continue;
+        if (!pickedQueue
+            || (now - it->queuedAt >= StarvationThreshold
+                && it->queuedAt < picked->queuedAt)) {
+            pickedQueue = &queue;
+            picked = it;
+        }
+    }
+    if (!pickedQueue)
+        return nullptr;
+    auto* const job = picked->job.data();
+    pickedQueue->erase(picked);
+    return job;
+}
+
+void ConnectionData::Private::sendRequest(BaseJob* job)
+{
+    if (job->error() == BaseJob::Abandoned)
+        return;
+    job->sendRequest();
+    const QPointer<QNetworkReply> reply = job->reply();
+    if (!reply || !reply->isRunning())
+        return;
+    auto& lane = lanes[size_t(job->networkLane())];
+    lane.running.push_back(reply);
+    priorityClasses[size_t(job->priority())].running.push_back(reply);
+    ++lane.sent;
+    QObject::connect(reply, &QNetworkReply::finished, &replyContext,
+                     [this, reply, &lane] {
+                         if (reply
+                             && reply->attribute(
+                                     QNetworkRequest::Http2WasUsedAttribute)
+                                 .toBool())
+                             ++lane.sentOverHttp2;
+                         // There's room for another job now
+                         scheduleDispatch();
+                     });
+    QObject::connect(reply, &QObject::destroyed, &replyContext,
+                     [this] { scheduleDispatch(); });
+}
+
 ConnectionData::ConnectionData(QUrl baseUrl)
     : d(makeImpl<Private>(std::move(baseUrl)))
 {
     // Each lambda invocation below takes no more than one job from the
-    // queues (first foreground, then background) and resumes it; then
-    // restarts the rate limiter timer with duration 0, effectively yielding
-    // to the event loop and then resuming until both queues are empty.
+    // queues (see Private::takeNextJob()) and sends it; then restarts
+    // the rate limiter timer with duration 0, effectively yielding to
+    // the event loop and then resuming until there are no more jobs that
+    // can be sent. Finished requests make room for more jobs and get back
+    // here (see Private::sendRequest()).
     QObject::connect(&d->rateLimiter, &QTimer::timeout, [this] {
         // TODO: Consider moving out all job->sendRequest() invocations to
         // a dedicated thread
         d->rateLimiter.setInterval(0);
-        for (auto& q : d->jobs)
-            while (!q.empty()) {
-                const auto job = q.front();
-                q.pop();
-                if (!job || job->error() == BaseJob::Abandoned)
-                    continue;
-                if (job->error() != BaseJob::Pending) {
-                    qCCritical(MAIN)
-                        << "Job" << job
-                        << "is in the wrong status:" << job->status();
-                    Q_ASSERT(false);
-                    job->setStatus(BaseJob::Pending);
-                }
-                job->sendRequest();
-                d->rateLimiter.start();
-                return;
+        if (d->holdTimer.isActive())
+            return; // releaseRequests() will restart the timer
+        if (auto* const job = d->takeNextJob()) {
+            if (job->error() != BaseJob::Pending) {
+                qCCritical(MAIN) << "Job" << job
+                                 << "is in the wrong status:" << job->status();
+                Q_ASSERT(false);
+                job->setStatus(BaseJob::Pending);
             }
-        qCDebug(MAIN) << d->id() << "job queues are empty";
+            d->sendRequest(job);
+            d->rateLimiter.start();
+            return;
+        }
+        if (std::all_of(d->jobs.cbegin(), d->jobs.cend(),
+                        [](const auto& q) { return q.empty(); }))
+            qCDebug(MAIN) << d->id() << "job queues are empty";
+    });
+    QObject::connect(&d->holdTimer, &QTimer::timeout, [this] {
+        qCWarning(MAIN) << "Access token refresh for" << d->id()
+                        << "takes too long, releasing held jobs";
+        releaseRequests();
     });
 }
 
@@ -76,19 +213,76 @@ ConnectionData::~ConnectionData()
 {
     d->rateLimiter.disconnect();
     d->rateLimiter.stop();
+    d->holdTimer.disconnect();
+    d->holdTimer.stop();
 }
 
 void ConnectionData::submit(BaseJob* job)
 {
     job->setStatus(BaseJob::Pending);
-    if (!d->rateLimiter.isActive()) {
-        QTimer::singleShot(0, job, &BaseJob::sendRequest);
+    // The refresh job goes first, whatever else holds the queues
+    if (job == d->refreshJob.data()) {
+        QTimer::singleShot(0, job, [this, job] { d->sendRequest(job); });
         return;
     }
-    d->jobs[size_t(job->isBackground())].emplace(job);
-    qCDebug(MAIN) << job << "queued," << d->jobs.front().size() << "(fg) +"
-                  << d->jobs.back().size() << "(bg) total jobs in" << d->id()
-                  << "queues";
+    d->jobs[size_t(job->priority())].push_back({ job, steady_clock::now() });
+    if (d->holdTimer.isActive() || d->rateLimiter.interval() > 0)
+        qCDebug(MAIN) << job << "queued,"
+                      << std::accumulate(d->jobs.cbegin(), d->jobs.cend(),
+                                         size_t(0),
+                                         [](size_t sum, const auto& q) {
+                                             return sum + q.size();
+                                         })
+                      << "total jobs in" << d->id() << "queues";
+    d->scheduleDispatch();
+}
+
+void ConnectionData::changePriority(BaseJob* job, JobPriority oldPriority)
+{
+    auto& oldQueue = d->jobs[size_t(oldPriority)];
+    const auto it = std::find_if(oldQueue.begin(), oldQueue.end(),
+                                 [job](const Private::QueuedJob& j) {
+                                     return j.job == job;
+                                 });
+    if (it == oldQueue.end())
+        return; // Already sent; the new priority applies to retries
+    const auto queuedJob = *it;
+    oldQueue.erase(it);
+    // Keep the job's place in the order of queueing, for the sake of
+    // the starvation protection
+    auto& newQueue = d->jobs[size_t(job->priority())];
+    newQueue.insert(std::upper_bound(newQueue.begin(), newQueue.end(),
+                                     queuedJob.queuedAt,
+                                     [](steady_clock::time_point t,
+                                        const Private::QueuedJob& j) {
+                                         return t < j.queuedAt;
+                                     }),
+                    queuedJob);
+    d->scheduleDispatch(); // The job may fit within the limits of its new class
+}
+
+void ConnectionData::holdRequests(const BaseJob* refreshJob,
+                                  std::chrono::milliseconds maxHold)
+{
+    qCDebug(MAIN) << "Holding jobs for" << d->id()
+                  << "while the access token is refreshed";
+    d->refreshJob = refreshJob;
+    d->holdTimer.start(maxHold);
+}
+
+void ConnectionData::releaseRequests()
+{
+    d->holdTimer.stop();
+    // Unless the rate limiter is holding the jobs as well, send them now
+    if (!d->rateLimiter.isActive())
+        d->rateLimiter.start(0);
+}
+
+bool ConnectionData::requestsHeld() const { return d->holdTimer.isActive(); }
+
+bool ConnectionData::isRefreshJob(const BaseJob* job) const
+{
+    return job && job == d->refreshJob.data();
 }
 
 void ConnectionData::limitRate(std::chrono::milliseconds nextCallAfter)
@@ -107,6 +301,57 @@ NetworkAccessManager* ConnectionData::nam() const
     return NetworkAccessManager::instance();
 }
 
+NetworkAccessManager* ConnectionData::nam(NetworkLane lane) const
+{
+    return NetworkAccessManager::instance(lane);
+}
+
+bool ConnectionData::http2Allowed() const { return d->http2Allowed; }
+
+void ConnectionData::setHttp2Allowed(bool allowed)
+{
+    d->http2Allowed = allowed;
+}
+
+int ConnectionData::maxRequestsInFlight(NetworkLane lane) const
+{
+    return d->lanes[size_t(lane)].maxInFlight;
+}
+
+void ConnectionData::setMaxRequestsInFlight(NetworkLane lane, int maxRequests)
+{
+    d->lanes[size_t(lane)].maxInFlight = std::max(maxRequests, 0);
+    d->scheduleDispatch(); // In case the limit has gone up
+}
+
+int ConnectionData::maxRequestsInFlight(JobPriority priority) const
+{
+    return d->priorityClasses[size_t(priority)].maxInFlight;
+}
+
+void ConnectionData::setMaxRequestsInFlight(JobPriority priority,
+                                            int maxRequests)
+{
+    d->priorityClasses[size_t(priority)].maxInFlight = std::max(maxRequests, 0);
+    d->scheduleDispatch(); // In case the limit has gone up
+}
+
+NetworkLaneStats ConnectionData::networkLaneStats(NetworkLane lane) const
+{
+    const auto& l = d->lanes[size_t(lane)];
+    NetworkLaneStats stats { 0, 0, l.maxInFlight, l.sent, l.sentOverHttp2 };
+    stats.inFlight = int(std::count_if(l.running.cbegin(), l.running.cend(),
+                                       [](const QPointer<QNetworkReply>& r) {
+                                           return r && r->isRunning();
+                                       }));
+    for (const auto& queue : d->jobs)
+        stats.waiting += int(std::count_if(
+            queue.cbegin(), queue.cend(), [lane](const Private::QueuedJob& j) {
+                return j.job && j.job->networkLane() == lane;
+            }));
+    return stats;
+}
+
 void ConnectionData::setBaseUrl(QUrl baseUrl)
 {
     d->baseUrl = std::move(baseUrl);
@@ -120,6 +365,23 @@ void ConnectionData::setToken(QByteArray token)
     d->accessToken = std::move(token);
 }
 
+QByteArray ConnectionData::refreshToken() const { return d->refreshToken; }
+
+void ConnectionData::setRefreshToken(QByteArray refreshToken)
+{
+    d->refreshToken = std::move(refreshToken);
+}
+
+QDateTime ConnectionData::accessTokenExpiry() const
+{
+    return d->accessTokenExpiry;
+}
+
+void ConnectionData::setAccessTokenExpiry(QDateTime expiry)
+{
+    d->accessTokenExpiry = std::move(expiry);
+}
+
 const QString& ConnectionData::deviceId() const { return d->deviceId; }
 
 const QString& ConnectionData::userId() const { return d->userId; }
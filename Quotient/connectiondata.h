@@ -4,8 +4,10 @@
 
 #pragma once
 
+#include "quotient_common.h"
 #include "util.h"
 
+#include <QtCore/QDateTime>
 #include <QtCore/QUrl>
 
 #include <chrono>
@@ -22,6 +24,8 @@ public:
     virtual ~ConnectionData();
 
     void submit(BaseJob* job);
+    //! Move the job, if it's still queued, to the queue of its new priority
+    void changePriority(BaseJob* job, JobPriority oldPriority);
     void limitRate(std::chrono::milliseconds nextCallAfter);
 
     QByteArray accessToken() const;
@@ -30,6 +34,7 @@ public:
     const QString& userId() const;
     bool needsToken(const QString& requestName) const;
     Quotient::NetworkAccessManager *nam() const;
+    Quotient::NetworkAccessManager* nam(NetworkLane lane) const;
 
     void setBaseUrl(QUrl baseUrl);
     void setToken(QByteArray accessToken);
@@ -37,6 +42,35 @@ public:
     void setUserId(const QString& userId);
     void setNeedsToken(const QString& requestName);
 
+    QByteArray refreshToken() const;
+    void setRefreshToken(QByteArray refreshToken);
+    //! When the access token expires; invalid if it doesn't
+    QDateTime accessTokenExpiry() const;
+    void setAccessTokenExpiry(QDateTime expiry);
+
+    //! \brief Hold the jobs submitted from now on, except \p refreshJob
+    //!
+    //! While the access token is being refreshed, jobs that would be sent with
+    //! the old one are queued instead; releaseRequests() sends them, with
+    //! the new token. So that a stuck refresh doesn't stall everything, jobs
+    //! are released anyway after \p maxHold.
+    void holdRequests(const BaseJob* refreshJob,
+                      std::chrono::milliseconds maxHold);
+    void releaseRequests();
+    bool requestsHeld() const;
+    //! Whether \p job is the one passed to the last holdRequests() call
+    bool isRefreshJob(const BaseJob* job) const;
+
+    bool http2Allowed() const;
+    void setHttp2Allowed(bool allowed);
+    //! The limit of concurrent requests in the lane; 0 means no limit
+    int maxRequestsInFlight(NetworkLane lane) const;
+    void setMaxRequestsInFlight(NetworkLane lane, int maxRequests);
+    //! The limit of concurrent requests in the priority class; 0 means no limit
+    int maxRequestsInFlight(JobPriority priority) const;
+    void setMaxRequestsInFlight(JobPriority priority, int maxRequests);
+    NetworkLaneStats networkLaneStats(NetworkLane lane) const;
+
     QString lastEvent() const;
     void setLastEvent(QString identifier);
 
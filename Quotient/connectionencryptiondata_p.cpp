@@ -9,6 +9,7 @@
 
 #include "events/encryptedevent.h"
 #include "events/roomkeyevent.h"
+#include "jobs/requestdata.h"
 
 #if QT_VERSION_MAJOR >= 6
 #    include <qt6keychain/keychain.h>
@@ -281,6 +282,7 @@ void ConnectionEncryptionData::loadOutdatedUserDevices()
         currentQueryKeysJob = nullptr;
     }
     auto queryKeysJob = q->callApi<QueryKeysJob>(users);
+    queryKeysJob->setPriority(JobPriority::Background);
     currentQueryKeysJob = queryKeysJob;
     QObject::connect(queryKeysJob, &BaseJob::result, q, [this, queryKeysJob] {
         currentQueryKeysJob = nullptr;
@@ -372,7 +374,7 @@ void ConnectionEncryptionData::handleEncryptedToDeviceEvent(
 
 void ConnectionEncryptionData::handleQueryKeys(const QueryKeysJob* job)
 {
-    const auto newDeviceKeys = job->deviceKeys();
+    const auto& newDeviceKeys = job->deviceKeys();
     for (const auto& [user, keys] : asKeyValueRange(newDeviceKeys)) {
         const QHash<QString, Quotient::DeviceKeys> oldDevices = deviceKeys[user];
         deviceKeys[user].clear();
@@ -429,12 +431,12 @@ void ConnectionEncryptionData::handleQueryKeys(const QueryKeysJob* job)
                   });
 }
 
-void ConnectionEncryptionData::encryptionUpdate(const QList<User*>& forUsers)
+void ConnectionEncryptionData::encryptionUpdate(const QStringList& forUserIds)
 {
-    for (const auto& user : forUsers)
-        if (!trackedUsers.contains(user->id())) {
-            trackedUsers += user->id();
-            outdatedUsers += user->id();
+    for (const auto& userId : forUserIds)
+        if (!trackedUsers.contains(userId)) {
+            trackedUsers += userId;
+            outdatedUsers += userId;
             encryptionUpdateRequired = true;
         }
 }
@@ -621,6 +623,7 @@ std::pair<EventPtr, QByteArray> ConnectionEncryptionData::sessionDecryptMessage(
               { { deviceId, "signed_curve25519"_ls } } }
         };
         auto job = q->callApi<ClaimKeysJob>(hash);
+        job->setPriority(JobPriority::Background);
         QObject::connect(
             job, &BaseJob::finished, q, [this, deviceId, job, senderId] {
                 if (triedDevices.contains({ senderId, deviceId })) {
@@ -702,27 +705,41 @@ void ConnectionEncryptionData::doSendSessionKeyToDevices(
 
     const auto sendKey = [devices, this, sessionId, messageIndex, sessionKey,
                           roomId] {
-        QHash<QString, QHash<QString, QJsonObject>> usersToDevicesToContent;
-        for (const auto& [targetUserId, targetDeviceId] :
-             asKeyValueRange(devices)) {
-            if (!hasOlmSession(targetUserId, targetDeviceId))
-                continue;
+        // With many devices, the payload gets big; so it is written directly
+        // into the request body, one device at a time
+        JsonObjectWriter body;
+        body.beginObject(QStringLiteral("messages"));
+        const auto keyEventJson =
+            RoomKeyEvent(MegolmV1AesSha2AlgoKey, roomId,
+                         QString::fromLatin1(sessionId),
+                         QString::fromLatin1(sessionKey))
+                .fullJson();
+        qsizetype payloadCount = 0;
+        for (const auto& targetUserId : devices.uniqueKeys()) {
+            bool userStarted = false;
+            for (auto it = devices.constFind(targetUserId);
+                 it != devices.cend() && it.key() == targetUserId; ++it) {
+                const auto& targetDeviceId = it.value();
+                if (!hasOlmSession(targetUserId, targetDeviceId))
+                    continue;
 
-            // Noisy and leaks the key to logs but nice for debugging
-//            qDebug(E2EE) << "Creating the payload for" << targetUserId
-//                         << targetDeviceId << sessionId << sessionKey.toHex();
-            const auto keyEventJson =
-                RoomKeyEvent(MegolmV1AesSha2AlgoKey, roomId,
-                             QString::fromLatin1(sessionId),
-                             QString::fromLatin1(sessionKey))
-                    .fullJson();
-
-            usersToDevicesToContent[targetUserId][targetDeviceId] =
-                assembleEncryptedContent(keyEventJson, targetUserId,
-                                         targetDeviceId);
+                // Noisy and leaks the key to logs but nice for debugging
+//                qDebug(E2EE) << "Creating the payload for" << targetUserId
+//                             << targetDeviceId << sessionId << sessionKey.toHex();
+                if (!std::exchange(userStarted, true))
+                    body.beginObject(targetUserId);
+                body.write(targetDeviceId,
+                           assembleEncryptedContent(keyEventJson, targetUserId,
+                                                    targetDeviceId));
+                ++payloadCount;
+            }
+            if (userStarted)
+                body.endObject();
         }
-        if (!usersToDevicesToContent.empty()) {
-            q->sendToDevices(EncryptedEvent::TypeId, usersToDevicesToContent);
+        if (payloadCount > 0) {
+            // The room message that is about to be sent needs these keys
+            q->sendToDevices(EncryptedEvent::TypeId, std::move(body))
+                ->setPriority(JobPriority::Urgent);
             QVector<std::tuple<QString, QString, QString>> receivedDevices;
             receivedDevices.reserve(devices.size());
             for (const auto& [user, device] : asKeyValueRange(devices))
@@ -740,8 +757,9 @@ void ConnectionEncryptionData::doSendSessionKeyToDevices(
     }
 
     auto job = q->callApi<ClaimKeysJob>(hash);
+    job->setPriority(JobPriority::Urgent);
     QObject::connect(job, &BaseJob::success, q, [job, this, sendKey] {
-        for (const auto oneTimeKeys = job->oneTimeKeys();
+        for (const auto& oneTimeKeys = job->oneTimeKeys();
              const auto& [userId, userDevices] : asKeyValueRange(oneTimeKeys)) {
             for (const auto& [deviceId, keys] : asKeyValueRange(userDevices)) {
                 createOlmSession(userId, deviceId, keys);
@@ -16,4 +16,6 @@ QUrl GetWhoIsJob::makeRequestUrl(QUrl baseUrl, const QString& userId)
 GetWhoIsJob::GetWhoIsJob(const QString& userId)
     : BaseJob(HttpVerb::Get, QStringLiteral("GetWhoIsJob"),
               makePath("/_matrix/client/v3", "/admin/whois/", userId))
-{}
+{
+    streamProperty<QHash<QString, DeviceInfo>>("devices"_ls);
+}
@@ -77,9 +77,15 @@ public:
     QString userId() const { return loadFromJson<QString>("user_id"_ls); }
 
     /// Each key is an identifier for one of the user's devices.
-    QHash<QString, DeviceInfo> devices() const
+    const QHash<QString, DeviceInfo>& devices() const
     {
-        return loadFromJson<QHash<QString, DeviceInfo>>("devices"_ls);
+        return cachedFromJson<QHash<QString, DeviceInfo>>("devices"_ls);
+    }
+
+    /// Move the result of devices() out of the job
+    QHash<QString, DeviceInfo> takeDevices()
+    {
+        return takeCachedFromJson<QHash<QString, DeviceInfo>>("devices"_ls);
     }
 };
 
@@ -94,6 +100,27 @@ struct JsonObjectConverter<GetWhoIsJob::ConnectionInfo> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetWhoIsJob::ConnectionInfo> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetWhoIsJob::ConnectionInfo& result)
+    {
+        if (key == "ip") {
+            readFromJson(reader, result.ip);
+            return true;
+        }
+        if (key == "last_seen") {
+            readFromJson(reader, result.lastSeen);
+            return true;
+        }
+        if (key == "user_agent") {
+            readFromJson(reader, result.userAgent);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<GetWhoIsJob::SessionInfo> {
     static void fillFrom(const QJsonObject& jo, GetWhoIsJob::SessionInfo& result)
@@ -102,6 +129,19 @@ struct JsonObjectConverter<GetWhoIsJob::SessionInfo> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetWhoIsJob::SessionInfo> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetWhoIsJob::SessionInfo& result)
+    {
+        if (key == "connections") {
+            readFromJson(reader, result.connections);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<GetWhoIsJob::DeviceInfo> {
     static void fillFrom(const QJsonObject& jo, GetWhoIsJob::DeviceInfo& result)
@@ -110,4 +150,17 @@ struct JsonObjectConverter<GetWhoIsJob::DeviceInfo> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetWhoIsJob::DeviceInfo> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetWhoIsJob::DeviceInfo& result)
+    {
+        if (key == "sessions") {
+            readFromJson(reader, result.sessions);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
@@ -88,6 +88,31 @@ struct JsonObjectConverter<GetAccount3PIDsJob::ThirdPartyIdentifier> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetAccount3PIDsJob::ThirdPartyIdentifier> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetAccount3PIDsJob::ThirdPartyIdentifier& result)
+    {
+        if (key == "medium") {
+            readFromJson(reader, result.medium);
+            return true;
+        }
+        if (key == "address") {
+            readFromJson(reader, result.address);
+            return true;
+        }
+        if (key == "validated_at") {
+            readFromJson(reader, result.validatedAt);
+            return true;
+        }
+        if (key == "added_at") {
+            readFromJson(reader, result.addedAt);
+            return true;
+        }
+        return false;
+    }
+};
+
 /*! \brief Adds contact information to the user's account.
  *
  * Adds contact information to the user's account.
@@ -74,6 +74,19 @@ struct JsonObjectConverter<GetCapabilitiesJob::ChangePasswordCapability> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetCapabilitiesJob::ChangePasswordCapability> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetCapabilitiesJob::ChangePasswordCapability& result)
+    {
+        if (key == "enabled") {
+            readFromJson(reader, result.enabled);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<GetCapabilitiesJob::RoomVersionsCapability> {
     static void fillFrom(const QJsonObject& jo,
@@ -84,6 +97,23 @@ struct JsonObjectConverter<GetCapabilitiesJob::RoomVersionsCapability> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetCapabilitiesJob::RoomVersionsCapability> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetCapabilitiesJob::RoomVersionsCapability& result)
+    {
+        if (key == "default") {
+            readFromJson(reader, result.defaultVersion);
+            return true;
+        }
+        if (key == "available") {
+            readFromJson(reader, result.available);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<GetCapabilitiesJob::Capabilities> {
     static void fillFrom(QJsonObject jo,
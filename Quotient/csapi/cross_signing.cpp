@@ -30,4 +30,5 @@ UploadCrossSigningSignaturesJob::UploadCrossSigningSignaturesJob(
               makePath("/_matrix/client/v3", "/keys/signatures/upload"))
 {
     setRequestData({ toJson(signatures) });
+    streamProperty<QHash<QString, QHash<QString, QJsonObject>>>("failures"_ls);
 }
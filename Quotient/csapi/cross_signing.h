@@ -72,9 +72,16 @@ public:
     /// A map from user ID to key ID to an error for any signatures
     /// that failed.  If a signature was invalid, the `errcode` will
     /// be set to `M_INVALID_SIGNATURE`.
-    QHash<QString, QHash<QString, QJsonObject>> failures() const
+    const QHash<QString, QHash<QString, QJsonObject>>& failures() const
     {
-        return loadFromJson<QHash<QString, QHash<QString, QJsonObject>>>(
+        return cachedFromJson<QHash<QString, QHash<QString, QJsonObject>>>(
+            "failures"_ls);
+    }
+
+    /// Move the result of failures() out of the job
+    QHash<QString, QHash<QString, QJsonObject>> takeFailures()
+    {
+        return takeCachedFromJson<QHash<QString, QHash<QString, QJsonObject>>>(
             "failures"_ls);
     }
 };
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 /// Used by clients to submit authentication information to the
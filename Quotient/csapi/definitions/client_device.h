@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 /// A client device
@@ -45,4 +45,29 @@ struct JsonObjectConverter<Device> {
     }
 };
 
+template <>
+struct JsonReaderConverter<Device> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          Device& pod)
+    {
+        if (key == "device_id") {
+            readFromJson(reader, pod.deviceId);
+            return true;
+        }
+        if (key == "display_name") {
+            readFromJson(reader, pod.displayName);
+            return true;
+        }
+        if (key == "last_seen_ip") {
+            readFromJson(reader, pod.lastSeenIp);
+            return true;
+        }
+        if (key == "last_seen_ts") {
+            readFromJson(reader, pod.lastSeenTs);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
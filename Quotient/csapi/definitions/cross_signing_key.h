@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 /// Cross signing key
@@ -44,4 +44,29 @@ struct JsonObjectConverter<CrossSigningKey> {
     }
 };
 
+template <>
+struct JsonReaderConverter<CrossSigningKey> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          CrossSigningKey& pod)
+    {
+        if (key == "user_id") {
+            readFromJson(reader, pod.userId);
+            return true;
+        }
+        if (key == "usage") {
+            readFromJson(reader, pod.usage);
+            return true;
+        }
+        if (key == "keys") {
+            readFromJson(reader, pod.keys);
+            return true;
+        }
+        if (key == "signatures") {
+            readFromJson(reader, pod.signatures);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 /// Device identity keys
@@ -53,4 +53,33 @@ struct JsonObjectConverter<DeviceKeys> {
     }
 };
 
+template <>
+struct JsonReaderConverter<DeviceKeys> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          DeviceKeys& pod)
+    {
+        if (key == "user_id") {
+            readFromJson(reader, pod.userId);
+            return true;
+        }
+        if (key == "device_id") {
+            readFromJson(reader, pod.deviceId);
+            return true;
+        }
+        if (key == "algorithms") {
+            readFromJson(reader, pod.algorithms);
+            return true;
+        }
+        if (key == "keys") {
+            readFromJson(reader, pod.keys);
+            return true;
+        }
+        if (key == "signatures") {
+            readFromJson(reader, pod.signatures);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
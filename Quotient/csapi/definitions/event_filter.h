@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -57,4 +57,33 @@ struct JsonObjectConverter<EventFilter> {
     }
 };
 
+template <>
+struct JsonReaderConverter<EventFilter> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          EventFilter& pod)
+    {
+        if (key == "limit") {
+            readFromJson(reader, pod.limit);
+            return true;
+        }
+        if (key == "not_senders") {
+            readFromJson(reader, pod.notSenders);
+            return true;
+        }
+        if (key == "not_types") {
+            readFromJson(reader, pod.notTypes);
+            return true;
+        }
+        if (key == "senders") {
+            readFromJson(reader, pod.senders);
+            return true;
+        }
+        if (key == "types") {
+            readFromJson(reader, pod.types);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -45,4 +45,29 @@ struct JsonObjectConverter<OpenIdCredentials> {
     }
 };
 
+template <>
+struct JsonReaderConverter<OpenIdCredentials> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          OpenIdCredentials& pod)
+    {
+        if (key == "access_token") {
+            readFromJson(reader, pod.accessToken);
+            return true;
+        }
+        if (key == "token_type") {
+            readFromJson(reader, pod.tokenType);
+            return true;
+        }
+        if (key == "matrix_server_name") {
+            readFromJson(reader, pod.matrixServerName);
+            return true;
+        }
+        if (key == "expires_in") {
+            readFromJson(reader, pod.expiresIn);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
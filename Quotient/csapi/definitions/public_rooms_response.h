@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -78,4 +78,53 @@ struct JsonObjectConverter<PublicRoomsChunk> {
     }
 };
 
+template <>
+struct JsonReaderConverter<PublicRoomsChunk> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          PublicRoomsChunk& pod)
+    {
+        if (key == "num_joined_members") {
+            readFromJson(reader, pod.numJoinedMembers);
+            return true;
+        }
+        if (key == "room_id") {
+            readFromJson(reader, pod.roomId);
+            return true;
+        }
+        if (key == "world_readable") {
+            readFromJson(reader, pod.worldReadable);
+            return true;
+        }
+        if (key == "guest_can_join") {
+            readFromJson(reader, pod.guestCanJoin);
+            return true;
+        }
+        if (key == "canonical_alias") {
+            readFromJson(reader, pod.canonicalAlias);
+            return true;
+        }
+        if (key == "name") {
+            readFromJson(reader, pod.name);
+            return true;
+        }
+        if (key == "topic") {
+            readFromJson(reader, pod.topic);
+            return true;
+        }
+        if (key == "avatar_url") {
+            readFromJson(reader, pod.avatarUrl);
+            return true;
+        }
+        if (key == "room_type") {
+            readFromJson(reader, pod.roomType);
+            return true;
+        }
+        if (key == "join_rule") {
+            readFromJson(reader, pod.joinRule);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
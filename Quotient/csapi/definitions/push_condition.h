@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -52,4 +52,29 @@ struct JsonObjectConverter<PushCondition> {
     }
 };
 
+template <>
+struct JsonReaderConverter<PushCondition> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          PushCondition& pod)
+    {
+        if (key == "kind") {
+            readFromJson(reader, pod.kind);
+            return true;
+        }
+        if (key == "key") {
+            readFromJson(reader, pod.key);
+            return true;
+        }
+        if (key == "pattern") {
+            readFromJson(reader, pod.pattern);
+            return true;
+        }
+        if (key == "is") {
+            readFromJson(reader, pod.is);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
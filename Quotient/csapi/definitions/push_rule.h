@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 #include <Quotient/csapi/definitions/push_condition.h>
 
 namespace Quotient {
@@ -54,4 +54,37 @@ struct JsonObjectConverter<PushRule> {
     }
 };
 
+template <>
+struct JsonReaderConverter<PushRule> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          PushRule& pod)
+    {
+        if (key == "actions") {
+            readFromJson(reader, pod.actions);
+            return true;
+        }
+        if (key == "default") {
+            readFromJson(reader, pod.isDefault);
+            return true;
+        }
+        if (key == "enabled") {
+            readFromJson(reader, pod.enabled);
+            return true;
+        }
+        if (key == "rule_id") {
+            readFromJson(reader, pod.ruleId);
+            return true;
+        }
+        if (key == "conditions") {
+            readFromJson(reader, pod.conditions);
+            return true;
+        }
+        if (key == "pattern") {
+            readFromJson(reader, pod.pattern);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
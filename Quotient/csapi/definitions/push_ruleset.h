@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 #include <Quotient/csapi/definitions/push_rule.h>
 
 namespace Quotient {
@@ -41,4 +41,33 @@ struct JsonObjectConverter<PushRuleset> {
     }
 };
 
+template <>
+struct JsonReaderConverter<PushRuleset> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          PushRuleset& pod)
+    {
+        if (key == "content") {
+            readFromJson(reader, pod.content);
+            return true;
+        }
+        if (key == "override") {
+            readFromJson(reader, pod.override);
+            return true;
+        }
+        if (key == "room") {
+            readFromJson(reader, pod.room);
+            return true;
+        }
+        if (key == "sender") {
+            readFromJson(reader, pod.sender);
+            return true;
+        }
+        if (key == "underride") {
+            readFromJson(reader, pod.underride);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
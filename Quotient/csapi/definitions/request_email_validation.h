@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 #include <Quotient/identity/definitions/request_email_validation.h>
 
 namespace Quotient {
@@ -43,4 +43,24 @@ struct JsonObjectConverter<EmailValidationData> {
     }
 };
 
+template <>
+struct JsonReaderConverter<EmailValidationData> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          EmailValidationData& pod)
+    {
+        if (JsonReaderConverter<RequestEmailValidation>::readField(reader, key,
+                                                                   pod))
+            return true;
+        if (key == "id_server") {
+            readFromJson(reader, pod.idServer);
+            return true;
+        }
+        if (key == "id_access_token") {
+            readFromJson(reader, pod.idAccessToken);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
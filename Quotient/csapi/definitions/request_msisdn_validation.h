@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 #include <Quotient/identity/definitions/request_msisdn_validation.h>
 
 namespace Quotient {
@@ -43,4 +43,24 @@ struct JsonObjectConverter<MsisdnValidationData> {
     }
 };
 
+template <>
+struct JsonReaderConverter<MsisdnValidationData> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          MsisdnValidationData& pod)
+    {
+        if (JsonReaderConverter<RequestMsisdnValidation>::readField(reader, key,
+                                                                    pod))
+            return true;
+        if (key == "id_server") {
+            readFromJson(reader, pod.idServer);
+            return true;
+        }
+        if (key == "id_access_token") {
+            readFromJson(reader, pod.idAccessToken);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
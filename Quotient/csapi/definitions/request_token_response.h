@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -42,4 +42,21 @@ struct JsonObjectConverter<RequestTokenResponse> {
     }
 };
 
+template <>
+struct JsonReaderConverter<RequestTokenResponse> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          RequestTokenResponse& pod)
+    {
+        if (key == "sid") {
+            readFromJson(reader, pod.sid);
+            return true;
+        }
+        if (key == "submit_url") {
+            readFromJson(reader, pod.submitUrl);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
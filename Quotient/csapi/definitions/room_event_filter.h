@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 #include <Quotient/csapi/definitions/event_filter.h>
 
 namespace Quotient {
@@ -73,4 +73,39 @@ struct JsonObjectConverter<RoomEventFilter> {
     }
 };
 
+template <>
+struct JsonReaderConverter<RoomEventFilter> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          RoomEventFilter& pod)
+    {
+        if (JsonReaderConverter<EventFilter>::readField(reader, key, pod))
+            return true;
+        if (key == "unread_thread_notifications") {
+            readFromJson(reader, pod.unreadThreadNotifications);
+            return true;
+        }
+        if (key == "lazy_load_members") {
+            readFromJson(reader, pod.lazyLoadMembers);
+            return true;
+        }
+        if (key == "include_redundant_members") {
+            readFromJson(reader, pod.includeRedundantMembers);
+            return true;
+        }
+        if (key == "not_rooms") {
+            readFromJson(reader, pod.notRooms);
+            return true;
+        }
+        if (key == "rooms") {
+            readFromJson(reader, pod.rooms);
+            return true;
+        }
+        if (key == "contains_url") {
+            readFromJson(reader, pod.containsUrl);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 #include <Quotient/csapi/definitions/event_filter.h>
 #include <Quotient/csapi/definitions/room_event_filter.h>
 
@@ -65,6 +65,43 @@ struct JsonObjectConverter<RoomFilter> {
     }
 };
 
+template <>
+struct JsonReaderConverter<RoomFilter> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          RoomFilter& pod)
+    {
+        if (key == "not_rooms") {
+            readFromJson(reader, pod.notRooms);
+            return true;
+        }
+        if (key == "rooms") {
+            readFromJson(reader, pod.rooms);
+            return true;
+        }
+        if (key == "ephemeral") {
+            readFromJson(reader, pod.ephemeral);
+            return true;
+        }
+        if (key == "include_leave") {
+            readFromJson(reader, pod.includeLeave);
+            return true;
+        }
+        if (key == "state") {
+            readFromJson(reader, pod.state);
+            return true;
+        }
+        if (key == "timeline") {
+            readFromJson(reader, pod.timeline);
+            return true;
+        }
+        if (key == "account_data") {
+            readFromJson(reader, pod.accountData);
+            return true;
+        }
+        return false;
+    }
+};
+
 struct Filter {
     /// List of event fields to include. If this list is absent then all fields
     /// are included. The entries are [dot-separated paths for each
@@ -111,4 +148,33 @@ struct JsonObjectConverter<Filter> {
     }
 };
 
+template <>
+struct JsonReaderConverter<Filter> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          Filter& pod)
+    {
+        if (key == "event_fields") {
+            readFromJson(reader, pod.eventFields);
+            return true;
+        }
+        if (key == "event_format") {
+            readFromJson(reader, pod.eventFormat);
+            return true;
+        }
+        if (key == "presence") {
+            readFromJson(reader, pod.presence);
+            return true;
+        }
+        if (key == "account_data") {
+            readFromJson(reader, pod.accountData);
+            return true;
+        }
+        if (key == "room") {
+            readFromJson(reader, pod.room);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
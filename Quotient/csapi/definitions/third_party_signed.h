@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 /// A signature of an `m.third_party_invite` token to prove that this user
@@ -41,4 +41,29 @@ struct JsonObjectConverter<ThirdPartySigned> {
     }
 };
 
+template <>
+struct JsonReaderConverter<ThirdPartySigned> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          ThirdPartySigned& pod)
+    {
+        if (key == "sender") {
+            readFromJson(reader, pod.sender);
+            return true;
+        }
+        if (key == "mxid") {
+            readFromJson(reader, pod.mxid);
+            return true;
+        }
+        if (key == "token") {
+            readFromJson(reader, pod.token);
+            return true;
+        }
+        if (key == "signatures") {
+            readFromJson(reader, pod.signatures);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
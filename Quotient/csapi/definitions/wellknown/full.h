@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 #include <Quotient/csapi/definitions/wellknown/homeserver.h>
 #include <Quotient/csapi/definitions/wellknown/identity_server.h>
 
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 /// Used by clients to discover homeserver information.
@@ -25,4 +25,17 @@ struct JsonObjectConverter<HomeserverInformation> {
     }
 };
 
+template <>
+struct JsonReaderConverter<HomeserverInformation> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          HomeserverInformation& pod)
+    {
+        if (key == "base_url") {
+            readFromJson(reader, pod.baseUrl);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
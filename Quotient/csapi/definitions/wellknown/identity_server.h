@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 /// Used by clients to discover identity server information.
@@ -25,4 +25,17 @@ struct JsonObjectConverter<IdentityServerInformation> {
     }
 };
 
+template <>
+struct JsonReaderConverter<IdentityServerInformation> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          IdentityServerInformation& pod)
+    {
+        if (key == "base_url") {
+            readFromJson(reader, pod.baseUrl);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
@@ -33,4 +33,9 @@ GetEventContextJob::GetEventContextJob(const QString& roomId,
               makePath("/_matrix/client/v3", "/rooms/", roomId, "/context/",
                        eventId),
               queryToGetEventContext(limit, filter))
-{}
+{
+    streamProperty<RoomEvents>("events_before"_ls);
+    streamProperty<RoomEventPtr>("event"_ls);
+    streamProperty<RoomEvents>("events_after"_ls);
+    streamProperty<StateEvents>("state"_ls);
+}
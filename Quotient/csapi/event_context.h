@@ -71,21 +71,24 @@ public:
     /// requested event, in reverse-chronological order.
     RoomEvents eventsBefore()
     {
-        return takeFromJson<RoomEvents>("events_before"_ls);
+        return takeCachedFromJson<RoomEvents>("events_before"_ls);
     }
 
     /// Details of the requested event.
-    RoomEventPtr event() { return takeFromJson<RoomEventPtr>("event"_ls); }
+    RoomEventPtr event()
+    {
+        return takeCachedFromJson<RoomEventPtr>("event"_ls);
+    }
 
     /// A list of room events that happened just after the
     /// requested event, in chronological order.
     RoomEvents eventsAfter()
     {
-        return takeFromJson<RoomEvents>("events_after"_ls);
+        return takeCachedFromJson<RoomEvents>("events_after"_ls);
     }
 
     /// The state of the room at the last event returned.
-    StateEvents state() { return takeFromJson<StateEvents>("state"_ls); }
+    StateEvents state() { return takeCachedFromJson<StateEvents>("state"_ls); }
 };
 
 } // namespace Quotient
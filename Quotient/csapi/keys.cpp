@@ -20,6 +20,7 @@ UploadKeysJob::UploadKeysJob(const Omittable<DeviceKeys>& deviceKeys,
                          fallbackKeys);
     setRequestData({ _dataJson });
     addExpectedKey("one_time_key_counts");
+    streamProperty<QHash<QString, int>>("one_time_key_counts"_ls);
 }
 
 QueryKeysJob::QueryKeysJob(const QHash<QString, QStringList>& deviceKeys,
@@ -31,6 +32,12 @@ QueryKeysJob::QueryKeysJob(const QHash<QString, QStringList>& deviceKeys,
     addParam<IfNotEmpty>(_dataJson, QStringLiteral("timeout"), timeout);
     addParam<>(_dataJson, QStringLiteral("device_keys"), deviceKeys);
     setRequestData({ _dataJson });
+    streamProperty<QHash<QString, QJsonObject>>("failures"_ls);
+    streamProperty<QHash<QString, QHash<QString, DeviceInformation>>>(
+        "device_keys"_ls);
+    streamProperty<QHash<QString, CrossSigningKey>>("master_keys"_ls);
+    streamProperty<QHash<QString, CrossSigningKey>>("self_signing_keys"_ls);
+    streamProperty<QHash<QString, CrossSigningKey>>("user_signing_keys"_ls);
 }
 
 ClaimKeysJob::ClaimKeysJob(
@@ -44,6 +51,9 @@ ClaimKeysJob::ClaimKeysJob(
     addParam<>(_dataJson, QStringLiteral("one_time_keys"), oneTimeKeys);
     setRequestData({ _dataJson });
     addExpectedKey("one_time_keys");
+    streamProperty<QHash<QString, QJsonObject>>("failures"_ls);
+    streamProperty<QHash<QString, QHash<QString, OneTimeKeys>>>(
+        "one_time_keys"_ls);
 }
 
 auto queryToGetKeysChanges(const QString& from, const QString& to)
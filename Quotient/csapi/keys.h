@@ -56,9 +56,16 @@ public:
     /// of that type currently held on the server for this device.
     /// If an algorithm is not listed, the count for that algorithm
     /// is to be assumed zero.
-    QHash<QString, int> oneTimeKeyCounts() const
+    const QHash<QString, int>& oneTimeKeyCounts() const
     {
-        return loadFromJson<QHash<QString, int>>("one_time_key_counts"_ls);
+        return cachedFromJson<QHash<QString, int>>("one_time_key_counts"_ls);
+    }
+
+    /// Move the result of oneTimeKeyCounts() out of the job
+    QHash<QString, int> takeOneTimeKeyCounts()
+    {
+        return takeCachedFromJson<QHash<QString, int>>(
+            "one_time_key_counts"_ls);
     }
 };
 
@@ -111,9 +118,15 @@ public:
     /// If the homeserver could be reached, but the user or device
     /// was unknown, no failure is recorded. Instead, the corresponding
     /// user or device is missing from the `device_keys` result.
-    QHash<QString, QJsonObject> failures() const
+    const QHash<QString, QJsonObject>& failures() const
+    {
+        return cachedFromJson<QHash<QString, QJsonObject>>("failures"_ls);
+    }
+
+    /// Move the result of failures() out of the job
+    QHash<QString, QJsonObject> takeFailures()
     {
-        return loadFromJson<QHash<QString, QJsonObject>>("failures"_ls);
+        return takeCachedFromJson<QHash<QString, QJsonObject>>("failures"_ls);
     }
 
     /// Information on the queried devices. A map from user ID, to a
@@ -121,9 +134,16 @@ public:
     /// the information returned will be the same as uploaded via
     /// `/keys/upload`, with the addition of an `unsigned`
     /// property.
-    QHash<QString, QHash<QString, DeviceInformation>> deviceKeys() const
+    const QHash<QString, QHash<QString, DeviceInformation>>& deviceKeys() const
+    {
+        return cachedFromJson<QHash<QString, QHash<QString, DeviceInformation>>>(
+            "device_keys"_ls);
+    }
+
+    /// Move the result of deviceKeys() out of the job
+    QHash<QString, QHash<QString, DeviceInformation>> takeDeviceKeys()
     {
-        return loadFromJson<QHash<QString, QHash<QString, DeviceInformation>>>(
+        return takeCachedFromJson<QHash<QString, QHash<QString, DeviceInformation>>>(
             "device_keys"_ls);
     }
 
@@ -133,18 +153,33 @@ public:
     /// `/keys/device_signing/upload`, along with the signatures
     /// uploaded via `/keys/signatures/upload` that the requesting user
     /// is allowed to see.
-    QHash<QString, CrossSigningKey> masterKeys() const
+    const QHash<QString, CrossSigningKey>& masterKeys() const
     {
-        return loadFromJson<QHash<QString, CrossSigningKey>>("master_keys"_ls);
+        return cachedFromJson<QHash<QString, CrossSigningKey>>(
+            "master_keys"_ls);
+    }
+
+    /// Move the result of masterKeys() out of the job
+    QHash<QString, CrossSigningKey> takeMasterKeys()
+    {
+        return takeCachedFromJson<QHash<QString, CrossSigningKey>>(
+            "master_keys"_ls);
     }
 
     /// Information on the self-signing keys of the queried users. A map
     /// from user ID, to self-signing key information.  For each key, the
     /// information returned will be the same as uploaded via
     /// `/keys/device_signing/upload`.
-    QHash<QString, CrossSigningKey> selfSigningKeys() const
+    const QHash<QString, CrossSigningKey>& selfSigningKeys() const
     {
-        return loadFromJson<QHash<QString, CrossSigningKey>>(
+        return cachedFromJson<QHash<QString, CrossSigningKey>>(
+            "self_signing_keys"_ls);
+    }
+
+    /// Move the result of selfSigningKeys() out of the job
+    QHash<QString, CrossSigningKey> takeSelfSigningKeys()
+    {
+        return takeCachedFromJson<QHash<QString, CrossSigningKey>>(
             "self_signing_keys"_ls);
     }
 
@@ -153,9 +188,16 @@ public:
     /// from user ID, to user-signing key information.  The
     /// information returned will be the same as uploaded via
     /// `/keys/device_signing/upload`.
-    QHash<QString, CrossSigningKey> userSigningKeys() const
+    const QHash<QString, CrossSigningKey>& userSigningKeys() const
+    {
+        return cachedFromJson<QHash<QString, CrossSigningKey>>(
+            "user_signing_keys"_ls);
+    }
+
+    /// Move the result of userSigningKeys() out of the job
+    QHash<QString, CrossSigningKey> takeUserSigningKeys()
     {
-        return loadFromJson<QHash<QString, CrossSigningKey>>(
+        return takeCachedFromJson<QHash<QString, CrossSigningKey>>(
             "user_signing_keys"_ls);
     }
 };
@@ -170,6 +212,19 @@ struct JsonObjectConverter<QueryKeysJob::UnsignedDeviceInfo> {
     }
 };
 
+template <>
+struct JsonReaderConverter<QueryKeysJob::UnsignedDeviceInfo> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          QueryKeysJob::UnsignedDeviceInfo& result)
+    {
+        if (key == "device_display_name") {
+            readFromJson(reader, result.deviceDisplayName);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<QueryKeysJob::DeviceInformation> {
     static void fillFrom(const QJsonObject& jo,
@@ -180,6 +235,21 @@ struct JsonObjectConverter<QueryKeysJob::DeviceInformation> {
     }
 };
 
+template <>
+struct JsonReaderConverter<QueryKeysJob::DeviceInformation> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          QueryKeysJob::DeviceInformation& result)
+    {
+        if (JsonReaderConverter<DeviceKeys>::readField(reader, key, result))
+            return true;
+        if (key == "unsigned") {
+            readFromJson(reader, result.unsignedData);
+            return true;
+        }
+        return false;
+    }
+};
+
 /*! \brief Claim one-time encryption keys.
  *
  * Claims one-time keys for use in pre-key messages.
@@ -209,9 +279,15 @@ public:
     /// If the homeserver could be reached, but the user or device
     /// was unknown, no failure is recorded. Instead, the corresponding
     /// user or device is missing from the `one_time_keys` result.
-    QHash<QString, QJsonObject> failures() const
+    const QHash<QString, QJsonObject>& failures() const
+    {
+        return cachedFromJson<QHash<QString, QJsonObject>>("failures"_ls);
+    }
+
+    /// Move the result of failures() out of the job
+    QHash<QString, QJsonObject> takeFailures()
     {
-        return loadFromJson<QHash<QString, QJsonObject>>("failures"_ls);
+        return takeCachedFromJson<QHash<QString, QJsonObject>>("failures"_ls);
     }
 
     /// One-time keys for the queried devices. A map from user ID, to a
@@ -222,9 +298,16 @@ public:
     ///
     /// If necessary, the claimed key might be a fallback key. Fallback
     /// keys are re-used by the server until replaced by the device.
-    QHash<QString, QHash<QString, OneTimeKeys>> oneTimeKeys() const
+    const QHash<QString, QHash<QString, OneTimeKeys>>& oneTimeKeys() const
+    {
+        return cachedFromJson<QHash<QString, QHash<QString, OneTimeKeys>>>(
+            "one_time_keys"_ls);
+    }
+
+    /// Move the result of oneTimeKeys() out of the job
+    QHash<QString, QHash<QString, OneTimeKeys>> takeOneTimeKeys()
     {
-        return loadFromJson<QHash<QString, QHash<QString, OneTimeKeys>>>(
+        return takeCachedFromJson<QHash<QString, QHash<QString, OneTimeKeys>>>(
             "one_time_keys"_ls);
     }
 };
@@ -67,6 +67,23 @@ struct JsonObjectConverter<GetLoginFlowsJob::LoginFlow> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetLoginFlowsJob::LoginFlow> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetLoginFlowsJob::LoginFlow& result)
+    {
+        if (key == "type") {
+            readFromJson(reader, result.type);
+            return true;
+        }
+        if (key == "get_login_token") {
+            readFromJson(reader, result.getLoginToken);
+            return true;
+        }
+        return false;
+    }
+};
+
 /*! \brief Authenticates the user.
  *
  * Authenticates the user, and issues an access token they can
@@ -39,4 +39,6 @@ GetRoomEventsJob::GetRoomEventsJob(const QString& roomId, const QString& dir,
 {
     addExpectedKey("start");
     addExpectedKey("chunk");
+    streamProperty<RoomEvents>("chunk"_ls);
+    streamProperty<RoomEvents>("state"_ls);
 }
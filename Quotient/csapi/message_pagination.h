@@ -95,7 +95,7 @@ public:
     /// Note that an empty `chunk` does not *necessarily* imply that no more
     /// events are available. Clients should continue to paginate until no `end`
     /// property is returned.
-    RoomEvents chunk() { return takeFromJson<RoomEvents>("chunk"_ls); }
+    RoomEvents chunk() { return takeCachedFromJson<RoomEvents>("chunk"_ls); }
 
     /// A list of state events relevant to showing the `chunk`. For example, if
     /// `lazy_load_members` is enabled in the filter then this may contain
@@ -105,7 +105,7 @@ public:
     /// may remove membership events which would have already been
     /// sent to the client in prior calls to this endpoint, assuming
     /// the membership of those members has not changed.
-    RoomEvents state() { return takeFromJson<RoomEvents>("state"_ls); }
+    RoomEvents state() { return takeCachedFromJson<RoomEvents>("state"_ls); }
 };
 
 } // namespace Quotient
@@ -34,4 +34,5 @@ GetNotificationsJob::GetNotificationsJob(const QString& from,
               queryToGetNotifications(from, limit, only))
 {
     addExpectedKey("notifications");
+    streamProperty<std::vector<Notification>>("notifications"_ls);
 }
@@ -77,7 +77,8 @@ public:
     /// The list of events that triggered notifications.
     std::vector<Notification> notifications()
     {
-        return takeFromJson<std::vector<Notification>>("notifications"_ls);
+        return takeCachedFromJson<std::vector<Notification>>(
+            "notifications"_ls);
     }
 };
 
@@ -95,4 +96,37 @@ struct JsonObjectConverter<GetNotificationsJob::Notification> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetNotificationsJob::Notification> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetNotificationsJob::Notification& result)
+    {
+        if (key == "actions") {
+            readFromJson(reader, result.actions);
+            return true;
+        }
+        if (key == "event") {
+            readFromJson(reader, result.event);
+            return true;
+        }
+        if (key == "read") {
+            readFromJson(reader, result.read);
+            return true;
+        }
+        if (key == "room_id") {
+            readFromJson(reader, result.roomId);
+            return true;
+        }
+        if (key == "ts") {
+            readFromJson(reader, result.ts);
+            return true;
+        }
+        if (key == "profile_tag") {
+            readFromJson(reader, result.profileTag);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
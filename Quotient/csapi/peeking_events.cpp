@@ -29,4 +29,6 @@ PeekEventsJob::PeekEventsJob(const QString& from, Omittable<int> timeout,
     : BaseJob(HttpVerb::Get, QStringLiteral("PeekEventsJob"),
               makePath("/_matrix/client/v3", "/events"),
               queryToPeekEvents(from, timeout, roomId))
-{}
+{
+    streamProperty<RoomEvents>("chunk"_ls);
+}
@@ -60,7 +60,7 @@ public:
     QString end() const { return loadFromJson<QString>("end"_ls); }
 
     /// An array of events.
-    RoomEvents chunk() { return takeFromJson<RoomEvents>("chunk"_ls); }
+    RoomEvents chunk() { return takeCachedFromJson<RoomEvents>("chunk"_ls); }
 };
 
 } // namespace Quotient
@@ -87,6 +87,23 @@ struct JsonObjectConverter<GetPushersJob::PusherData> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetPushersJob::PusherData> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetPushersJob::PusherData& result)
+    {
+        if (key == "url") {
+            readFromJson(reader, result.url);
+            return true;
+        }
+        if (key == "format") {
+            readFromJson(reader, result.format);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<GetPushersJob::Pusher> {
     static void fillFrom(const QJsonObject& jo, GetPushersJob::Pusher& result)
@@ -103,6 +120,47 @@ struct JsonObjectConverter<GetPushersJob::Pusher> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetPushersJob::Pusher> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetPushersJob::Pusher& result)
+    {
+        if (key == "pushkey") {
+            readFromJson(reader, result.pushkey);
+            return true;
+        }
+        if (key == "kind") {
+            readFromJson(reader, result.kind);
+            return true;
+        }
+        if (key == "app_id") {
+            readFromJson(reader, result.appId);
+            return true;
+        }
+        if (key == "app_display_name") {
+            readFromJson(reader, result.appDisplayName);
+            return true;
+        }
+        if (key == "device_display_name") {
+            readFromJson(reader, result.deviceDisplayName);
+            return true;
+        }
+        if (key == "lang") {
+            readFromJson(reader, result.lang);
+            return true;
+        }
+        if (key == "data") {
+            readFromJson(reader, result.data);
+            return true;
+        }
+        if (key == "profile_tag") {
+            readFromJson(reader, result.profileTag);
+            return true;
+        }
+        return false;
+    }
+};
+
 /*! \brief Modify a pusher for this user on the homeserver.
  *
  * This endpoint allows the creation, modification and deletion of
@@ -39,6 +39,7 @@ GetRelatingEventsJob::GetRelatingEventsJob(
               queryToGetRelatingEvents(from, to, limit, dir))
 {
     addExpectedKey("chunk");
+    streamProperty<RoomEvents>("chunk"_ls);
 }
 
 auto queryToGetRelatingEventsWithRelType(const QString& from, const QString& to,
@@ -75,6 +76,7 @@ GetRelatingEventsWithRelTypeJob::GetRelatingEventsWithRelTypeJob(
               queryToGetRelatingEventsWithRelType(from, to, limit, dir))
 {
     addExpectedKey("chunk");
+    streamProperty<RoomEvents>("chunk"_ls);
 }
 
 auto queryToGetRelatingEventsWithRelTypeAndEventType(const QString& from,
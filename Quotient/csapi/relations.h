@@ -83,7 +83,7 @@ public:
 
     /// The child events of the requested event, ordered topologically
     /// most-recent first.
-    RoomEvents chunk() { return takeFromJson<RoomEvents>("chunk"_ls); }
+    RoomEvents chunk() { return takeCachedFromJson<RoomEvents>("chunk"_ls); }
 
     /// An opaque string representing a pagination token. The absence of this
     /// token means there are no more results to fetch and the client should
@@ -177,7 +177,7 @@ public:
     /// The child events of the requested event, ordered topologically
     /// most-recent first. The events returned will match the `relType`
     /// supplied in the URL.
-    RoomEvents chunk() { return takeFromJson<RoomEvents>("chunk"_ls); }
+    RoomEvents chunk() { return takeCachedFromJson<RoomEvents>("chunk"_ls); }
 
     /// An opaque string representing a pagination token. The absence of this
     /// token means there are no more results to fetch and the client should
@@ -282,7 +282,7 @@ public:
     /// The child events of the requested event, ordered topologically
     /// most-recent first. The events returned will match the `relType` and
     /// `eventType` supplied in the URL.
-    RoomEvents chunk() { return takeFromJson<RoomEvents>("chunk"_ls); }
+    RoomEvents chunk() { return takeCachedFromJson<RoomEvents>("chunk"_ls); }
 
     /// An opaque string representing a pagination token. The absence of this
     /// token means there are no more results to fetch and the client should
@@ -79,7 +79,9 @@ GetMembersByRoomJob::GetMembersByRoomJob(const QString& roomId,
     : BaseJob(HttpVerb::Get, QStringLiteral("GetMembersByRoomJob"),
               makePath("/_matrix/client/v3", "/rooms/", roomId, "/members"),
               queryToGetMembersByRoom(at, membership, notMembership))
-{}
+{
+    streamProperty<StateEvents>("chunk"_ls);
+}
 
 QUrl GetJoinedMembersByRoomJob::makeRequestUrl(QUrl baseUrl,
                                                const QString& roomId)
@@ -93,4 +95,6 @@ GetJoinedMembersByRoomJob::GetJoinedMembersByRoomJob(const QString& roomId)
     : BaseJob(HttpVerb::Get, QStringLiteral("GetJoinedMembersByRoomJob"),
               makePath("/_matrix/client/v3", "/rooms/", roomId,
                        "/joined_members"))
-{}
+{
+    streamProperty<QHash<QString, RoomMember>>("joined"_ls);
+}
@@ -146,7 +146,7 @@ public:
     // Result properties
 
     /// Get the list of members for this room.
-    StateEvents chunk() { return takeFromJson<StateEvents>("chunk"_ls); }
+    StateEvents chunk() { return takeCachedFromJson<StateEvents>("chunk"_ls); }
 };
 
 /*! \brief Gets the list of currently joined users and their profile data.
@@ -194,9 +194,15 @@ public:
     // Result properties
 
     /// A map from user ID to a RoomMember object.
-    QHash<QString, RoomMember> joined() const
+    const QHash<QString, RoomMember>& joined() const
     {
-        return loadFromJson<QHash<QString, RoomMember>>("joined"_ls);
+        return cachedFromJson<QHash<QString, RoomMember>>("joined"_ls);
+    }
+
+    /// Move the result of joined() out of the job
+    QHash<QString, RoomMember> takeJoined()
+    {
+        return takeCachedFromJson<QHash<QString, RoomMember>>("joined"_ls);
     }
 };
 
@@ -210,4 +216,21 @@ struct JsonObjectConverter<GetJoinedMembersByRoomJob::RoomMember> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetJoinedMembersByRoomJob::RoomMember> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetJoinedMembersByRoomJob::RoomMember& result)
+    {
+        if (key == "display_name") {
+            readFromJson(reader, result.displayName);
+            return true;
+        }
+        if (key == "avatar_url") {
+            readFromJson(reader, result.avatarUrl);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
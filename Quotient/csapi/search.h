@@ -248,6 +248,23 @@ struct JsonObjectConverter<SearchJob::UserProfile> {
     }
 };
 
+template <>
+struct JsonReaderConverter<SearchJob::UserProfile> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          SearchJob::UserProfile& result)
+    {
+        if (key == "displayname") {
+            readFromJson(reader, result.displayname);
+            return true;
+        }
+        if (key == "avatar_url") {
+            readFromJson(reader, result.avatarUrl);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<SearchJob::EventContext> {
     static void fillFrom(const QJsonObject& jo, SearchJob::EventContext& result)
@@ -260,6 +277,35 @@ struct JsonObjectConverter<SearchJob::EventContext> {
     }
 };
 
+template <>
+struct JsonReaderConverter<SearchJob::EventContext> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          SearchJob::EventContext& result)
+    {
+        if (key == "start") {
+            readFromJson(reader, result.begin);
+            return true;
+        }
+        if (key == "end") {
+            readFromJson(reader, result.end);
+            return true;
+        }
+        if (key == "profile_info") {
+            readFromJson(reader, result.profileInfo);
+            return true;
+        }
+        if (key == "events_before") {
+            readFromJson(reader, result.eventsBefore);
+            return true;
+        }
+        if (key == "events_after") {
+            readFromJson(reader, result.eventsAfter);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<SearchJob::Result> {
     static void fillFrom(const QJsonObject& jo, SearchJob::Result& result)
@@ -270,6 +316,27 @@ struct JsonObjectConverter<SearchJob::Result> {
     }
 };
 
+template <>
+struct JsonReaderConverter<SearchJob::Result> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          SearchJob::Result& result)
+    {
+        if (key == "rank") {
+            readFromJson(reader, result.rank);
+            return true;
+        }
+        if (key == "result") {
+            readFromJson(reader, result.result);
+            return true;
+        }
+        if (key == "context") {
+            readFromJson(reader, result.context);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<SearchJob::GroupValue> {
     static void fillFrom(const QJsonObject& jo, SearchJob::GroupValue& result)
@@ -280,6 +347,27 @@ struct JsonObjectConverter<SearchJob::GroupValue> {
     }
 };
 
+template <>
+struct JsonReaderConverter<SearchJob::GroupValue> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          SearchJob::GroupValue& result)
+    {
+        if (key == "next_batch") {
+            readFromJson(reader, result.nextBatch);
+            return true;
+        }
+        if (key == "order") {
+            readFromJson(reader, result.order);
+            return true;
+        }
+        if (key == "results") {
+            readFromJson(reader, result.results);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<SearchJob::ResultRoomEvents> {
     static void fillFrom(const QJsonObject& jo,
@@ -294,6 +382,39 @@ struct JsonObjectConverter<SearchJob::ResultRoomEvents> {
     }
 };
 
+template <>
+struct JsonReaderConverter<SearchJob::ResultRoomEvents> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          SearchJob::ResultRoomEvents& result)
+    {
+        if (key == "count") {
+            readFromJson(reader, result.count);
+            return true;
+        }
+        if (key == "highlights") {
+            readFromJson(reader, result.highlights);
+            return true;
+        }
+        if (key == "results") {
+            readFromJson(reader, result.results);
+            return true;
+        }
+        if (key == "state") {
+            readFromJson(reader, result.state);
+            return true;
+        }
+        if (key == "groups") {
+            readFromJson(reader, result.groups);
+            return true;
+        }
+        if (key == "next_batch") {
+            readFromJson(reader, result.nextBatch);
+            return true;
+        }
+        return false;
+    }
+};
+
 template <>
 struct JsonObjectConverter<SearchJob::ResultCategories> {
     static void fillFrom(const QJsonObject& jo,
@@ -303,4 +424,17 @@ struct JsonObjectConverter<SearchJob::ResultCategories> {
     }
 };
 
+template <>
+struct JsonReaderConverter<SearchJob::ResultCategories> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          SearchJob::ResultCategories& result)
+    {
+        if (key == "room_events") {
+            readFromJson(reader, result.roomEvents);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
@@ -40,4 +40,5 @@ GetSpaceHierarchyJob::GetSpaceHierarchyJob(const QString& roomId,
               queryToGetSpaceHierarchy(suggestedOnly, limit, maxDepth, from))
 {
     addExpectedKey("rooms");
+    streamProperty<std::vector<ChildRoomsChunk>>("rooms"_ls);
 }
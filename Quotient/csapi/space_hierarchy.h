@@ -122,7 +122,7 @@ public:
     /// The rooms for the current page, with the current filters.
     std::vector<ChildRoomsChunk> rooms()
     {
-        return takeFromJson<std::vector<ChildRoomsChunk>>("rooms"_ls);
+        return takeCachedFromJson<std::vector<ChildRoomsChunk>>("rooms"_ls);
     }
 
     /// A token to supply to `from` to keep paginating the responses. Not
@@ -149,4 +149,57 @@ struct JsonObjectConverter<GetSpaceHierarchyJob::ChildRoomsChunk> {
     }
 };
 
+template <>
+struct JsonReaderConverter<GetSpaceHierarchyJob::ChildRoomsChunk> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          GetSpaceHierarchyJob::ChildRoomsChunk& result)
+    {
+        if (key == "num_joined_members") {
+            readFromJson(reader, result.numJoinedMembers);
+            return true;
+        }
+        if (key == "room_id") {
+            readFromJson(reader, result.roomId);
+            return true;
+        }
+        if (key == "world_readable") {
+            readFromJson(reader, result.worldReadable);
+            return true;
+        }
+        if (key == "guest_can_join") {
+            readFromJson(reader, result.guestCanJoin);
+            return true;
+        }
+        if (key == "children_state") {
+            readFromJson(reader, result.childrenState);
+            return true;
+        }
+        if (key == "canonical_alias") {
+            readFromJson(reader, result.canonicalAlias);
+            return true;
+        }
+        if (key == "name") {
+            readFromJson(reader, result.name);
+            return true;
+        }
+        if (key == "topic") {
+            readFromJson(reader, result.topic);
+            return true;
+        }
+        if (key == "avatar_url") {
+            readFromJson(reader, result.avatarUrl);
+            return true;
+        }
+        if (key == "join_rule") {
+            readFromJson(reader, result.joinRule);
+            return true;
+        }
+        if (key == "room_type") {
+            readFromJson(reader, result.roomType);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
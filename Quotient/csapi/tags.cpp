@@ -18,7 +18,9 @@ GetRoomTagsJob::GetRoomTagsJob(const QString& userId, const QString& roomId)
     : BaseJob(HttpVerb::Get, QStringLiteral("GetRoomTagsJob"),
               makePath("/_matrix/client/v3", "/user/", userId, "/rooms/",
                        roomId, "/tags"))
-{}
+{
+    streamProperty<QHash<QString, Tag>>("tags"_ls);
+}
 
 SetRoomTagJob::SetRoomTagJob(const QString& userId, const QString& roomId,
                              const QString& tag, Omittable<float> order,
@@ -49,9 +49,15 @@ public:
     // Result properties
 
     /// List the tags set by a user on a room.
-    QHash<QString, Tag> tags() const
+    const QHash<QString, Tag>& tags() const
     {
-        return loadFromJson<QHash<QString, Tag>>("tags"_ls);
+        return cachedFromJson<QHash<QString, Tag>>("tags"_ls);
+    }
+
+    /// Move the result of tags() out of the job
+    QHash<QString, Tag> takeTags()
+    {
+        return takeCachedFromJson<QHash<QString, Tag>>("tags"_ls);
     }
 };
 
@@ -34,4 +34,5 @@ GetThreadRootsJob::GetThreadRootsJob(const QString& roomId,
               queryToGetThreadRoots(include, limit, from))
 {
     addExpectedKey("chunk");
+    streamProperty<RoomEvents>("chunk"_ls);
 }
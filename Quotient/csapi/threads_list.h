@@ -69,7 +69,7 @@ public:
     /// user](/client-server-api/#ignoring-users), the event is returned
     /// redacted to the caller. This is to simulate the same behaviour of a
     /// client doing aggregation locally on the thread.
-    RoomEvents chunk() { return takeFromJson<RoomEvents>("chunk"_ls); }
+    RoomEvents chunk() { return takeCachedFromJson<RoomEvents>("chunk"_ls); }
 
     /// A token to supply to `from` to keep paginating the responses. Not
     /// present when there are no further results.
@@ -81,4 +81,25 @@ struct JsonObjectConverter<SearchUserDirectoryJob::User> {
     }
 };
 
+template <>
+struct JsonReaderConverter<SearchUserDirectoryJob::User> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          SearchUserDirectoryJob::User& result)
+    {
+        if (key == "user_id") {
+            readFromJson(reader, result.userId);
+            return true;
+        }
+        if (key == "display_name") {
+            readFromJson(reader, result.displayName);
+            return true;
+        }
+        if (key == "avatar_url") {
+            readFromJson(reader, result.avatarUrl);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
@@ -17,4 +17,5 @@ GetVersionsJob::GetVersionsJob()
               makePath("/_matrix/client", "/versions"), false)
 {
     addExpectedKey("versions");
+    streamProperty<QHash<QString, bool>>("unstable_features"_ls);
 }
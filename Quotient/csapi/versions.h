@@ -52,9 +52,15 @@ public:
     /// Experimental features the server supports. Features not listed here,
     /// or the lack of this property all together, indicate that a feature is
     /// not supported.
-    QHash<QString, bool> unstableFeatures() const
+    const QHash<QString, bool>& unstableFeatures() const
     {
-        return loadFromJson<QHash<QString, bool>>("unstable_features"_ls);
+        return cachedFromJson<QHash<QString, bool>>("unstable_features"_ls);
+    }
+
+    /// Move the result of unstableFeatures() out of the job
+    QHash<QString, bool> takeUnstableFeatures()
+    {
+        return takeCachedFromJson<QHash<QString, bool>>("unstable_features"_ls);
     }
 };
 
@@ -375,6 +375,20 @@ void Database::saveCurrentOutboundMegolmSession(const QString& roomId,
     commit();
 }
 
+void Database::markCurrentOutboundMegolmSessionInUse(
+    const QString& roomId, const QByteArray& sessionId)
+{
+    // A negative message count is never stored otherwise
+    auto query = prepareQuery(QStringLiteral(
+        "UPDATE outbound_megolm_sessions SET messageCount=-1 WHERE "
+        "roomId=:roomId AND sessionId=:sessionId;"));
+    query.bindValue(":roomId"_ls, roomId);
+    query.bindValue(":sessionId"_ls, sessionId);
+    transaction();
+    execute(query);
+    commit();
+}
+
 Omittable<QOlmOutboundGroupSession> Database::loadCurrentOutboundMegolmSession(
     const QString& roomId)
 {
@@ -383,6 +397,11 @@ Omittable<QOlmOutboundGroupSession> Database::loadCurrentOutboundMegolmSession(
     query.bindValue(":roomId"_ls, roomId);
     execute(query);
     if (query.next()) {
+        if (query.value("messageCount"_ls).toInt() < 0) {
+            qCWarning(E2EE) << "The outbound megolm session for" << roomId
+                            << "was in use when last saved, discarding it";
+            return none;
+        }
         if (auto&& session = QOlmOutboundGroupSession::unpickle(
                 query.value("pickle"_ls).toByteArray(), m_picklingKey)) {
             session->setCreationTime(
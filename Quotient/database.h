@@ -55,6 +55,14 @@ public:
         const QString& roomId);
     void saveCurrentOutboundMegolmSession(
         const QString& roomId, const QOlmOutboundGroupSession& session);
+    //! \brief Mark the saved outbound session as being behind the one in use
+    //!
+    //! Call this before encrypting with a session whose saving is deferred;
+    //! the next saveCurrentOutboundMegolmSession() clears the mark. A marked
+    //! session is not loaded again, so that a crash before saving never
+    //! leads to reusing message indices.
+    void markCurrentOutboundMegolmSessionInUse(const QString& roomId,
+                                               const QByteArray& sessionId);
     void updateOlmSession(const QByteArray& senderKey,
                           const QOlmSession& session);
 
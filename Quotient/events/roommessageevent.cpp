@@ -10,9 +10,11 @@
 
 #include <QtCore/QFileInfo>
 #include <QtCore/QMimeDatabase>
-#include <QtGui/QImageReader>
-#if QT_VERSION_MAJOR < 6
-#    include <QtMultimedia/QMediaResource>
+#ifndef Quotient_NO_GUI
+#    include <QtGui/QImageReader>
+#    if QT_VERSION_MAJOR < 6
+#        include <QtMultimedia/QMediaResource>
+#    endif
 #endif
 
 using namespace Quotient;
@@ -148,14 +150,22 @@ TypedBase* contentFromFile(const QFileInfo& file, bool asGenericFile)
         auto mimeTypeName = mimeType.name();
         if (mimeTypeName.startsWith("image/"_ls))
             return new ImageContent(localUrl, file.size(), mimeType,
+#ifndef Quotient_NO_GUI
                                     QImageReader(filePath).size(),
+#else
+                                    QSize(), // Unknown without QtGui
+#endif
                                     file.fileName());
 
         // duration can only be obtained asynchronously and can only be reliably
         // done by starting to play the file. Left for a future implementation.
         if (mimeTypeName.startsWith("video/"_ls))
             return new VideoContent(localUrl, file.size(), mimeType,
+#ifndef Quotient_NO_GUI
                                     QMediaResource(localUrl).resolution(),
+#else
+                                    QSize(),
+#endif
                                     file.fileName());
 
         if (mimeTypeName.startsWith("audio/"_ls))
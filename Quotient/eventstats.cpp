@@ -3,6 +3,8 @@
 
 #include "eventstats.h"
 
+#include "tracing.h"
+
 using namespace Quotient;
 
 EventStats EventStats::fromRange(const Room* room, const Room::rev_iter_t& from,
@@ -12,6 +14,7 @@ EventStats EventStats::fromRange(const Room* room, const Room::rev_iter_t& from,
     Q_ASSERT(to <= room->historyEdge());
     Q_ASSERT(from >= Room::rev_iter_t(room->syncEdge()));
     Q_ASSERT(from <= to);
+    const Tracing::Span span { "room", "eventStats", room->id() };
     QElapsedTimer et;
     et.start();
     const auto result =
@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -52,4 +52,29 @@ struct JsonObjectConverter<RequestEmailValidation> {
     }
 };
 
+template <>
+struct JsonReaderConverter<RequestEmailValidation> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          RequestEmailValidation& pod)
+    {
+        if (key == "client_secret") {
+            readFromJson(reader, pod.clientSecret);
+            return true;
+        }
+        if (key == "email") {
+            readFromJson(reader, pod.email);
+            return true;
+        }
+        if (key == "send_attempt") {
+            readFromJson(reader, pod.sendAttempt);
+            return true;
+        }
+        if (key == "next_link") {
+            readFromJson(reader, pod.nextLink);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
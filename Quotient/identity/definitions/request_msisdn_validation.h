@@ -4,7 +4,7 @@
 
 #pragma once
 
-#include <Quotient/converters.h>
+#include <Quotient/jsonreader.h>
 
 namespace Quotient {
 
@@ -57,4 +57,33 @@ struct JsonObjectConverter<RequestMsisdnValidation> {
     }
 };
 
+template <>
+struct JsonReaderConverter<RequestMsisdnValidation> {
+    static bool readField(JsonReader& reader, const QByteArray& key,
+                          RequestMsisdnValidation& pod)
+    {
+        if (key == "client_secret") {
+            readFromJson(reader, pod.clientSecret);
+            return true;
+        }
+        if (key == "country") {
+            readFromJson(reader, pod.country);
+            return true;
+        }
+        if (key == "phone_number") {
+            readFromJson(reader, pod.phoneNumber);
+            return true;
+        }
+        if (key == "send_attempt") {
+            readFromJson(reader, pod.sendAttempt);
+            return true;
+        }
+        if (key == "next_link") {
+            readFromJson(reader, pod.nextLink);
+            return true;
+        }
+        return false;
+    }
+};
+
 } // namespace Quotient
@@ -6,7 +6,9 @@
 
 #include <Quotient/connectiondata.h>
 #include <Quotient/networkaccessmanager.h>
+#include <Quotient/tracing.h>
 
+#include <QtCore/QDateTime>
 #include <QtCore/QRegularExpression>
 #include <QtCore/QTimer>
 #include <QtCore/QMetaEnum>
@@ -14,6 +16,10 @@
 #include <QtNetwork/QNetworkReply>
 #include <QtNetwork/QNetworkRequest>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+
 using namespace Quotient;
 using std::chrono::seconds, std::chrono::milliseconds;
 using namespace std::chrono_literals;
@@ -48,6 +54,27 @@ BaseJob::StatusCode BaseJob::Status::fromHttpCode(int httpCode)
     }
 }
 
+//! \brief Pick the network lane by the request endpoint
+//!
+//! Only content downloads (including thumbnails) are bulk traffic; uploads,
+//! URL previews and the media config are small or user-initiated requests
+//! that should not wait behind a batch of downloads.
+static NetworkLane laneForEndpoint(const QByteArray& endpoint)
+{
+    static constexpr std::array BulkEndpoints {
+        "/_matrix/media/v3/download/", "/_matrix/media/v3/thumbnail/",
+        "/_matrix/media/r0/download/", "/_matrix/media/r0/thumbnail/",
+        "/_matrix/client/v1/media/download/",
+        "/_matrix/client/v1/media/thumbnail/"
+    };
+    return std::any_of(BulkEndpoints.cbegin(), BulkEndpoints.cend(),
+                       [&endpoint](const char* prefix) {
+                           return endpoint.startsWith(prefix);
+                       })
+               ? NetworkLane::Bulk
+               : NetworkLane::Interactive;
+}
+
 QDebug BaseJob::Status::dumpToLog(QDebug dbg) const
 {
     QDebugStateSaver _s(dbg);
@@ -76,6 +103,7 @@ public:
         , requestQuery(q)
         , requestData(std::move(data))
         , needsToken(nt)
+        , lane(laneForEndpoint(apiEndpoint))
     {
         timer.setSingleShot(true);
         retryTimer.setSingleShot(true);
@@ -102,6 +130,15 @@ public:
      */
     Status parseJson();
 
+    /*! \brief Parse the response byte array, streaming registered properties
+     *
+     * Properties that have a reader in propertyReaders are decoded directly
+     * into decodedValues; the rest of the top-level object is stored
+     * in jsonResponse, as parseJson() would do. Responses that are not
+     * JSON objects are passed to parseJson().
+     */
+    Status parseJsonStreamed();
+
     ConnectionData* connection = nullptr;
 
     // Contents for the network request
@@ -111,15 +148,25 @@ public:
     QUrlQuery requestQuery;
     RequestData requestData;
     bool needsToken;
+    QByteArray sentAccessToken;
+    NetworkLane lane;
+    std::optional<JobPriority> priority;
 
     bool inBackground = false;
 
+    JobPriority effectivePriority() const
+    {
+        return priority.value_or(inBackground ? JobPriority::Background
+                                              : JobPriority::Normal);
+    }
+
     // There's no use of QMimeType here because we don't want to match
     // content types against the known MIME type hierarchy; and at the same
     // type QMimeType is of little help with MIME type globs (`text/*` etc.)
     QByteArrayList expectedContentTypes { "application/json" };
 
     QByteArrayList expectedKeys;
+    QHash<QString, PropertyReader> propertyReaders;
 
     // When the QNetworkAccessManager is destroyed it destroys all pending replies.
     // Using QPointer allows us to know when that happend.
@@ -133,6 +180,10 @@ public:
     /// definition (including an empty JSON object - QJsonObject{});
     /// and QJsonObject in case of an API error.
     QJsonDocument jsonResponse;
+    /// Response properties already converted from jsonResponse, see
+    /// BaseJob::cachedFromJson(); std::unordered_map is used to keep
+    /// references to the values valid while other properties are added
+    mutable UnorderedMap<QString, std::any> decodedValues;
     QUrl errorUrl; //!< May contain a URL to help with some errors
 
     LoggingCategory logCat = JOBS;
@@ -144,6 +195,8 @@ public:
         { { 90s, 5s }, { 90s, 10s }, { 120s, 30s } });
     int maxRetries = int(errorStrategy.size());
     int retriesTaken = 0;
+    //! Whether the beginning of the current request is in the trace
+    bool requestTraced = false;
 
     [[nodiscard]] const JobTimeoutConfig& getCurrentTimeoutConfig() const
     {
@@ -197,7 +250,11 @@ BaseJob::BaseJob(HttpVerb verb, const QString& name, QByteArray endpoint,
     setObjectName(name);
     connect(&d->timer, &QTimer::timeout, this, &BaseJob::timeout);
     connect(&d->retryTimer, &QTimer::timeout, this, [this] {
+        if (status().code != Pending)
+            return; // Abandoned while waiting for the retry
         qCDebug(d->logCat) << "Retrying" << this;
+        // Retries go through the queues as well, so that they count against
+        // the limits of the job's lane and priority class
         d->connection->submit(this);
     });
 }
@@ -213,6 +270,10 @@ QUrl BaseJob::requestUrl() const { return d->reply ? d->reply->url() : QUrl(); }
 
 bool BaseJob::isBackground() const { return d->inBackground; }
 
+NetworkLane BaseJob::networkLane() const { return d->lane; }
+
+JobPriority BaseJob::priority() const { return d->effectivePriority(); }
+
 const BaseJob::headers_t& BaseJob::requestHeaders() const
 {
     return d->requestHeaders;
@@ -267,6 +328,20 @@ void BaseJob::setExpectedKeys(const QByteArrayList& keys)
     d->expectedKeys = keys;
 }
 
+void BaseJob::addPropertyReader(const QString& keyName, PropertyReader reader)
+{
+    d->propertyReaders.insert(keyName, reader);
+}
+
+static std::atomic_bool streamingParsers = false;
+
+void BaseJob::setStreamingParsersEnabled(bool enabled)
+{
+    streamingParsers = enabled;
+}
+
+bool BaseJob::streamingParsersEnabled() { return streamingParsers; }
+
 const QNetworkReply* BaseJob::reply() const { return d->reply.data(); }
 
 QNetworkReply* BaseJob::reply() { return d->reply.data(); }
@@ -296,14 +371,26 @@ QNetworkRequest BaseJob::Private::prepareRequest() const
         req.setRawHeader("Authorization",
                          QByteArray("Bearer ") + connection->accessToken());
     req.setAttribute(QNetworkRequest::BackgroundRequestAttribute, inBackground);
+    // Qt sends high priority requests first when it runs out of connections
+    switch (effectivePriority()) {
+    case JobPriority::Urgent:
+        req.setPriority(QNetworkRequest::HighPriority);
+        break;
+    case JobPriority::Normal:
+        break;
+    case JobPriority::Background:
+    case JobPriority::Idle:
+        req.setPriority(QNetworkRequest::LowPriority);
+    }
     req.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
                      QNetworkRequest::NoLessSafeRedirectPolicy);
     req.setMaximumRedirectsAllowed(10);
     req.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
-    // Qt doesn't combine HTTP2 with SSL quite right, occasionally crashing at
-    // what seems like an attempt to write to a closed channel. If/when that
-    // changes, false should be turned to true below.
-    req.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+    // Some Qt versions don't combine HTTP2 with SSL quite right, occasionally
+    // crashing at what seems like an attempt to write to a closed channel;
+    // so HTTP/2 is only used for homeservers where it's explicitly allowed.
+    req.setAttribute(QNetworkRequest::Http2AllowedAttribute,
+                     connection->http2Allowed());
     Q_ASSERT(req.url().isValid());
     for (auto it = requestHeaders.cbegin(); it != requestHeaders.cend(); ++it)
         req.setRawHeader(it.key(), it.value());
@@ -314,16 +401,16 @@ void BaseJob::Private::sendRequest(const QNetworkRequest& req)
 {
     switch (verb) {
     case HttpVerb::Get:
-        reply = connection->nam()->get(req);
+        reply = connection->nam(lane)->get(req);
         break;
     case HttpVerb::Post:
-        reply = connection->nam()->post(req, requestData.source());
+        reply = connection->nam(lane)->post(req, requestData.source());
         break;
     case HttpVerb::Put:
-        reply = connection->nam()->put(req, requestData.source());
+        reply = connection->nam(lane)->put(req, requestData.source());
         break;
     case HttpVerb::Delete:
-        reply = connection->nam()->sendCustomRequest(req, "DELETE", requestData.source());
+        reply = connection->nam(lane)->sendCustomRequest(req, "DELETE", requestData.source());
         break;
     }
 }
@@ -376,9 +463,15 @@ void BaseJob::sendRequest()
     Q_ASSERT(d->connection && status().code == Pending);
     d->needsToken |= d->connection->needsToken(objectName());
     auto req = d->prepareRequest();
+    if (d->needsToken)
+        d->sentAccessToken = d->connection->accessToken();
     emit aboutToSendRequest(&req);
     d->sendRequest(req);
     Q_ASSERT(d->reply);
+    if (Tracing::isEnabled()) {
+        Tracing::asyncBegin("network", "request", this, objectName());
+        d->requestTraced = true;
+    }
     connect(reply(), &QNetworkReply::finished, this, [this] {
         gotReply();
         finishJob();
@@ -403,11 +496,38 @@ BaseJob::Status BaseJob::Private::parseJson()
 {
     QJsonParseError error { 0, QJsonParseError::MissingObject };
     jsonResponse = QJsonDocument::fromJson(rawResponse, &error);
+    decodedValues.clear();
     return { error.error == QJsonParseError::NoError ? NoError
                                                      : IncorrectResponse,
              error.errorString() };
 }
 
+BaseJob::Status BaseJob::Private::parseJsonStreamed()
+{
+    JsonReader reader(rawResponse);
+    if (reader.peek() != JsonReader::Object)
+        return parseJson();
+
+    decodedValues.clear();
+    QJsonObject otherProperties;
+    reader.enterObject();
+    while (reader.nextKey()) {
+        const auto key = QString::fromUtf8(reader.key());
+        if (const auto it = propertyReaders.constFind(key);
+            it != propertyReaders.cend())
+            (*it)(reader, decodedValues[key]);
+        else
+            otherProperties.insert(key, reader.readValue());
+    }
+    if (!reader.finish()) {
+        jsonResponse = {};
+        decodedValues.clear();
+        return { IncorrectResponse, reader.errorString() };
+    }
+    jsonResponse.setObject(otherProperties);
+    return NoError;
+}
+
 void BaseJob::gotReply()
 {
     // Defer actually updating the status until it's finalised
@@ -416,12 +536,16 @@ void BaseJob::gotReply()
         && d->expectedContentTypes == QByteArrayList { "application/json" }) //
     {
         d->rawResponse = reply()->readAll();
-        statusSoFar = d->parseJson();
+        statusSoFar = d->propertyReaders.empty() || !streamingParsersEnabled()
+                          ? d->parseJson()
+                          : d->parseJsonStreamed();
         if (statusSoFar.good() && !expectedKeys().empty()) {
             const auto& responseObject = jsonData();
             QByteArrayList missingKeys;
             for (const auto& k: expectedKeys())
-                if (!responseObject.contains(QString::fromLatin1(k)))
+                if (const auto key = QString::fromLatin1(k);
+                    !responseObject.contains(key)
+                    && !d->decodedValues.contains(key))
                     missingKeys.push_back(k);
             if (!missingKeys.empty())
                 statusSoFar = { IncorrectResponse,
@@ -570,11 +694,18 @@ QJsonValue BaseJob::takeValueFromJson(const QString& key)
     return v;
 }
 
+std::any& BaseJob::decodedValue(const QString& key) const
+{
+    return d->decodedValues[key];
+}
+
 void BaseJob::stop()
 {
     // This method is (also) used to semi-finalise the job before retrying; so
     // stop the timeout timer but keep the retry timer running.
     d->timer.stop();
+    if (std::exchange(d->requestTraced, false))
+        Tracing::asyncEnd("network", "request", this);
     if (d->reply) {
         d->reply->disconnect(this); // Ignore whatever comes from the reply
         if (d->reply->isRunning()) {
@@ -595,6 +726,19 @@ void BaseJob::finishJob()
         d->connection->submit(this);
         return;
     case Unauthorised:
+        // A rejected refresh token is final; neither a new access token nor
+        // the current one can help with that
+        if (d->connection->isRefreshJob(this))
+            break;
+        if (d->needsToken
+            && (d->connection->requestsHeld()
+                || d->connection->accessToken() != d->sentAccessToken)) {
+            // The access token has been (or is being) refreshed since
+            // the request was sent; try again with the new one
+            qCDebug(d->logCat) << this << "re-running with the new access token";
+            d->connection->submit(this);
+            return;
+        }
         if (!d->needsToken && !d->connection->accessToken().isEmpty()) {
             // Rerun with access token (extension of the spec while
             // https://github.com/matrix-org/matrix-doc/issues/701 is pending)
@@ -629,6 +773,7 @@ void BaseJob::finishJob()
 
     Q_ASSERT(status().code != Pending);
 
+    const Tracing::Span span { "network", "jobCompletion", objectName() };
     // Notify those interested in any completion of the job including abandon()
     emit finished(this);
 
@@ -679,6 +824,16 @@ void BaseJob::setMaxRetries(int newMaxRetries)
     d->maxRetries = newMaxRetries;
 }
 
+void BaseJob::setNetworkLane(NetworkLane lane) { d->lane = lane; }
+
+void BaseJob::setPriority(JobPriority priority)
+{
+    const auto oldPriority = d->effectivePriority();
+    d->priority = priority;
+    if (d->connection && priority != oldPriority && status().code == Pending)
+        d->connection->changePriority(this, oldPriority);
+}
+
 BaseJob::Status BaseJob::status() const { return d->status; }
 
 QByteArray BaseJob::rawData(int bytesAtMost) const
@@ -711,6 +866,50 @@ QJsonArray BaseJob::jsonItems() const
     return d->jsonResponse.array();
 }
 
+std::optional<seconds> BaseJob::responseMaxAge() const
+{
+    return d->reply ? maxAgeFromHeaders(d->reply->rawHeader("Cache-Control"),
+                                        d->reply->rawHeader("Expires"))
+                    : std::nullopt;
+}
+
+std::optional<seconds> BaseJob::maxAgeFromHeaders(const QByteArray& cacheControl,
+                                                  const QByteArray& expires)
+{
+    for (const auto& directive : cacheControl.split(',')) {
+        const auto trimmed = directive.trimmed().toLower();
+        if (trimmed == "no-cache" || trimmed == "no-store")
+            return seconds::zero();
+        if (trimmed.startsWith("max-age=")) {
+            bool ok = false;
+            const auto maxAge = trimmed.mid(8).toLongLong(&ok);
+            if (ok)
+                return seconds(std::max(maxAge, 0LL));
+        }
+    }
+    if (const auto expiresAt =
+            QDateTime::fromString(QString::fromLatin1(expires), Qt::RFC2822Date);
+        expiresAt.isValid())
+        return seconds(
+            std::max(QDateTime::currentDateTimeUtc().secsTo(expiresAt), 0LL));
+    return std::nullopt;
+}
+
+bool BaseJob::responseAllowsStoring() const
+{
+    return !d->reply
+           || cacheControlAllowsStoring(d->reply->rawHeader("Cache-Control"));
+}
+
+bool BaseJob::cacheControlAllowsStoring(const QByteArray& cacheControl)
+{
+    const auto directives = cacheControl.split(',');
+    return std::none_of(directives.cbegin(), directives.cend(),
+                        [](const QByteArray& directive) {
+                            return directive.trimmed().toLower() == "no-store";
+                        });
+}
+
 QString BaseJob::statusCaption() const
 {
     switch (d->status.code) {
@@ -799,6 +998,8 @@ void BaseJob::abandon()
     beforeAbandon();
     d->timer.stop();
     d->retryTimer.stop(); // In case abandon() was called between retries
+    if (std::exchange(d->requestTraced, false))
+        Tracing::asyncEnd("network", "request", this);
     setStatus(Abandoned);
     if (d->reply)
         d->reply->disconnect(this);
@@ -7,11 +7,16 @@
 #include "requestdata.h"
 #include <Quotient/logging.h>
 #include <Quotient/converters.h> // Common for csapi/ headers even though not used here
+#include <Quotient/jsonreader.h>
 #include <Quotient/quotient_common.h> // For DECL_DEPRECATED_ENUMERATOR
 
 #include <QtCore/QObject>
 #include <QtCore/QStringBuilder>
 
+#include <any>
+#include <chrono>
+#include <optional>
+
 class QNetworkRequest;
 class QNetworkReply;
 class QSslError;
@@ -147,6 +152,21 @@ public:
     QUrl requestUrl() const;
     bool isBackground() const;
 
+    //! \brief The network lane the job's requests go over
+    //!
+    //! By default, media downloads and thumbnails go over NetworkLane::Bulk
+    //! and everything else (including media uploads) over
+    //! NetworkLane::Interactive; jobs can choose another lane in their
+    //! constructors. Retries go over the same lane and are subject to its
+    //! limits, just as the first attempt.
+    NetworkLane networkLane() const;
+
+    //! \brief The priority class of the job
+    //!
+    //! Unless set with setPriority(), this is JobPriority::Background for
+    //! jobs run in the background and JobPriority::Normal otherwise.
+    JobPriority priority() const;
+
     /** Current status of the job */
     Status status() const;
 
@@ -192,6 +212,41 @@ public:
      */
     QJsonArray jsonItems() const;
 
+    /** Get how long the response may be cached according to its headers
+     *
+     * This is the `max-age` value of the `Cache-Control` header or, if there's
+     * none, the time until the date in the `Expires` header; `no-cache` and
+     * `no-store` make it zero. If the response has neither header,
+     * std::nullopt is returned.
+     */
+    std::optional<std::chrono::seconds> responseMaxAge() const;
+
+    /** Get the cache lifetime from `Cache-Control` and `Expires` values
+     *
+     * This is what responseMaxAge() applies to the response headers.
+     */
+    static std::optional<std::chrono::seconds> maxAgeFromHeaders(
+        const QByteArray& cacheControl, const QByteArray& expires);
+
+    /** Check whether the response may be stored, as per its headers
+     *
+     * This returns false if the `Cache-Control` header has `no-store`.
+     */
+    bool responseAllowsStoring() const;
+
+    /** Check whether a `Cache-Control` value allows storing the response */
+    static bool cacheControlAllowsStoring(const QByteArray& cacheControl);
+
+    /** Enable or disable reading response properties straight from bytes
+     *
+     * When enabled, properties registered by the job with streamProperty()
+     * are decoded by JsonReader directly from the response body instead of
+     * being converted from an intermediate QJsonDocument. This is off
+     * by default; the setting applies to all jobs finishing after the call.
+     */
+    static void setStreamingParsersEnabled(bool enabled);
+    static bool streamingParsersEnabled();
+
     /** Load the property from the JSON response assuming a given C++ type
      *
      * If there's no top-level JSON object in the response or if there's
@@ -219,6 +274,46 @@ public:
         return std::forward<T>(defaultValue);
     }
 
+    /** Load the property from the JSON response, decoding it only once
+     *
+     * Unlike loadFromJson(), the decoded value is stored inside the job
+     * and every subsequent call returns a reference to the same object
+     * instead of converting the JSON again. This is meant for big response
+     * properties (nested maps of structures, most notably) that callers may
+     * access more than once. If there's no node with the key \p keyName,
+     * a reference to a default-constructed \p T is returned.
+     *
+     * \sa takeCachedFromJson
+     */
+    template <typename T>
+    const T& cachedFromJson(const QString& keyName) const
+    {
+        auto& decoded = decodedValue(keyName);
+        if (!decoded.has_value())
+            decoded = std::make_shared<T>(loadFromJson<T>(keyName));
+        return **std::any_cast<std::shared_ptr<T>>(&decoded);
+    }
+
+    /** Move the property decoded from the JSON response out of the job
+     *
+     * If the property has already been decoded by cachedFromJson(), the stored
+     * value is moved out; otherwise it is converted from JSON directly. Either
+     * way, the property is deleted from the JSON response, in the same way as
+     * takeFromJson() does.
+     */
+    template <typename T>
+    T takeCachedFromJson(const QString& keyName)
+    {
+        if (auto& decoded = decodedValue(keyName); decoded.has_value()) {
+            auto result =
+                std::move(**std::any_cast<std::shared_ptr<T>>(&decoded));
+            decoded.reset();
+            takeValueFromJson(keyName);
+            return result;
+        }
+        return takeFromJson<T>(keyName);
+    }
+
     /** Error (more generally, status) code
      * Equivalent to status().code
      * \sa status
@@ -233,6 +328,16 @@ public:
 
     int maxRetries() const;
     void setMaxRetries(int newMaxRetries);
+    //! Change the network lane; only effective before the job is sent
+    void setNetworkLane(NetworkLane lane);
+    //! \brief Change the priority class of the job
+    //!
+    //! If the job is waiting in the queue, it moves to the queue of the new
+    //! class; e.g., the job that loads a thumbnail can be given
+    //! JobPriority::Urgent when the thumbnail is visible and
+    //! JobPriority::Idle when it scrolls out of view. A request that has
+    //! already been sent is not affected, but retries are.
+    void setPriority(JobPriority priority);
 
     using duration_ms_t = std::chrono::milliseconds::rep; // normally int64_t
 
@@ -363,6 +468,26 @@ protected:
     void addExpectedKey(const QByteArray &key);
     void setExpectedKeys(const QByteArrayList &keys);
 
+    using PropertyReader = void (*)(JsonReader&, std::any&);
+    void addPropertyReader(const QString& keyName, PropertyReader reader);
+
+    /** Decode a top-level response property with JsonReader
+     *
+     * If streaming parsers are enabled (see setStreamingParsersEnabled()),
+     * the property \p keyName is read from the response body right into
+     * the storage used by cachedFromJson() and takeCachedFromJson(); it does
+     * not appear in jsonData() then. Other properties are not affected.
+     */
+    template <typename T>
+    void streamProperty(const QString& keyName)
+    {
+        addPropertyReader(keyName, [](JsonReader& reader, std::any& storage) {
+            auto value = std::make_shared<T>();
+            readFromJson(reader, *value);
+            storage = std::move(value);
+        });
+    }
+
     const QNetworkReply* reply() const;
     QNetworkReply* reply();
 
@@ -428,6 +553,13 @@ protected:
      */
     QJsonValue takeValueFromJson(const QString& key);
 
+    //! \brief Get the storage for the decoded value of a response property
+    //!
+    //! The storage stays at the same address for the lifetime of the response
+    //! and is reset every time a new response body arrives.
+    //! \sa cachedFromJson
+    std::any& decodedValue(const QString& key) const;
+
     void setStatus(Status s);
     void setStatus(int code, QString message);
 
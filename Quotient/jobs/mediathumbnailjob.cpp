@@ -3,20 +3,41 @@
 
 #include "mediathumbnailjob.h"
 
+#ifndef Quotient_NO_GUI
+#    include <QtCore/QBuffer>
+#    include <QtGui/QImageReader>
+#endif
+
 using namespace Quotient;
 
+// The sizes Synapse generates thumbnails for by default with the "scale"
+// method (32x32 and 96x96 are only generated with "crop"); other homeservers
+// commonly follow the same set
+static constexpr std::array ThumbnailSizes{ QSize(320, 240), QSize(640, 480),
+                                            QSize(800, 600) };
+
+QSize MediaThumbnailJob::normalizedSize(QSize requestedSize)
+{
+    for (const auto& size : ThumbnailSizes)
+        if (requestedSize.width() <= size.width()
+            && requestedSize.height() <= size.height())
+            return size;
+    return requestedSize;
+}
+
 QUrl MediaThumbnailJob::makeRequestUrl(QUrl baseUrl, const QUrl& mxcUri,
                                        QSize requestedSize)
 {
+    const auto size = normalizedSize(requestedSize);
     return makeRequestUrl(std::move(baseUrl), mxcUri.authority(),
-                          mxcUri.path().mid(1), requestedSize.width(),
-                          requestedSize.height());
+                          mxcUri.path().mid(1), size.width(), size.height());
 }
 
 MediaThumbnailJob::MediaThumbnailJob(const QString& serverName,
                                      const QString& mediaId, QSize requestedSize)
-    : GetContentThumbnailJob(serverName, mediaId, requestedSize.width(),
-                             requestedSize.height(), "scale"_ls)
+    : GetContentThumbnailJob(serverName, mediaId,
+                             normalizedSize(requestedSize).width(),
+                             normalizedSize(requestedSize).height(), "scale"_ls)
 {
     setLoggingCategory(THUMBNAILJOB);
 }
@@ -29,18 +50,35 @@ MediaThumbnailJob::MediaThumbnailJob(const QUrl& mxcUri, QSize requestedSize)
     setLoggingCategory(THUMBNAILJOB);
 }
 
-QImage MediaThumbnailJob::thumbnail() const { return _thumbnail; }
+#ifndef Quotient_NO_GUI
+QImage MediaThumbnailJob::thumbnail() const
+{
+    if (_thumbnail.isNull())
+        _thumbnail.loadFromData(_thumbnailData);
+    return _thumbnail;
+}
 
 QImage MediaThumbnailJob::scaledThumbnail(QSize toSize) const
 {
-    return _thumbnail.scaled(toSize, Qt::KeepAspectRatio,
-                             Qt::SmoothTransformation);
+    return thumbnail().scaled(toSize, Qt::KeepAspectRatio,
+                              Qt::SmoothTransformation);
 }
+#endif
 
 BaseJob::Status MediaThumbnailJob::prepareResult()
 {
-    if (_thumbnail.loadFromData(data()->readAll()))
+    // Only check the image header here; decoding is deferred until
+    // the image is actually needed (see thumbnail() and thumbnailData()),
+    // so corrupt image data still make the job succeed
+    _thumbnailData = data()->readAll();
+#ifndef Quotient_NO_GUI
+    QBuffer buffer(&_thumbnailData);
+    if (QImageReader(&buffer).canRead())
+        return Success;
+#else
+    if (!_thumbnailData.isEmpty()) // No way to check the contents without QtGui
         return Success;
+#endif
 
     return { IncorrectResponse, QStringLiteral("Could not read image data") };
 }
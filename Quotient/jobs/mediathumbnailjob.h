@@ -5,7 +5,10 @@
 
 #include <Quotient/csapi/content-repo.h>
 
-#include <QtGui/QPixmap>
+#include <QtCore/QSize>
+#ifndef Quotient_NO_GUI
+#    include <QtGui/QImage>
+#endif
 
 namespace Quotient {
 class QUOTIENT_API MediaThumbnailJob : public GetContentThumbnailJob {
@@ -14,17 +17,49 @@ public:
     static QUrl makeRequestUrl(QUrl baseUrl, const QUrl& mxcUri,
                                QSize requestedSize);
 
+    //! \brief Normalise the thumbnail size to one of a few standard sizes
+    //!
+    //! Homeservers usually pre-generate thumbnails in a handful of sizes;
+    //! asking for one of those (rather than for the exact size needed by
+    //! the UI) avoids resizing on the server side, makes repeated requests
+    //! for slightly different sizes hit the same URL and lets one thumbnail
+    //! serve all smaller sizes. Returns the smallest standard size that is
+    //! at least as big as \p requestedSize in both dimensions, or
+    //! \p requestedSize itself if it is bigger than all standard sizes.
+    static QSize normalizedSize(QSize requestedSize);
+
+    //! \note Both constructors pass the size through normalizedSize()
     MediaThumbnailJob(const QString& serverName, const QString& mediaId,
                       QSize requestedSize);
     MediaThumbnailJob(const QUrl& mxcUri, QSize requestedSize);
 
+#ifndef Quotient_NO_GUI
+    //! \brief The decoded thumbnail
+    //!
+    //! The job only checks that the image format is recognised before
+    //! reporting success; the image itself is decoded on the first call to
+    //! this function. If the data turn out to be corrupt, a null image is
+    //! returned despite the job having succeeded - callers must check for
+    //! that.
     QImage thumbnail() const;
+    //! \brief The decoded thumbnail scaled to fit \p toSize
+    //! \sa thumbnail
     QImage scaledThumbnail(QSize toSize) const;
+#endif
+    //! \brief The thumbnail as it came from the server, before decoding
+    //!
+    //! The image is only decoded on the first call to thumbnail() or
+    //! scaledThumbnail(); use this to decode it elsewhere, e.g. in
+    //! a worker thread.
+    QByteArray thumbnailData() const { return _thumbnailData; }
 
 protected:
     Status prepareResult() override;
 
 private:
-    QImage _thumbnail;
+    QByteArray _thumbnailData;
+#ifndef Quotient_NO_GUI
+    mutable QImage _thumbnail;
+#endif
 };
 } // namespace Quotient
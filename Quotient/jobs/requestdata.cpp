@@ -35,3 +35,81 @@ RequestData::RequestData(const QJsonArray& ja) : _source(fromJson(ja)) {}
 RequestData::RequestData(QIODevice* source)
     : _source(acquireImpl(source))
 {}
+
+RequestData::RequestData(JsonObjectWriter&& writer)
+    : _source(fromData(writer.finish()))
+{}
+
+namespace {
+void appendJsonString(QByteArray& buffer, const QString& s)
+{
+    buffer += '"';
+    for (const char c : s.toUtf8())
+        switch (c) {
+        case '"': buffer += "\\\""; break;
+        case '\\': buffer += "\\\\"; break;
+        case '\b': buffer += "\\b"; break;
+        case '\f': buffer += "\\f"; break;
+        case '\n': buffer += "\\n"; break;
+        case '\r': buffer += "\\r"; break;
+        case '\t': buffer += "\\t"; break;
+        default:
+            if (static_cast<uchar>(c) < 0x20) {
+                buffer += "\\u00";
+                buffer += QByteArray::number(int(c), 16).rightJustified(2, '0');
+            } else
+                buffer += c;
+        }
+    buffer += '"';
+}
+} // namespace
+
+JsonObjectWriter::JsonObjectWriter()
+{
+    buffer += '{';
+    nonEmpty.push_back(false);
+}
+
+void JsonObjectWriter::writeKey(const QString& key)
+{
+    Q_ASSERT_X(!nonEmpty.isEmpty(), __FUNCTION__,
+               "Writing to a finished JsonObjectWriter");
+    if (std::exchange(nonEmpty.back(), true))
+        buffer += ',';
+    appendJsonString(buffer, key);
+    buffer += ':';
+}
+
+void JsonObjectWriter::beginObject(const QString& key)
+{
+    writeKey(key);
+    buffer += '{';
+    nonEmpty.push_back(false);
+}
+
+void JsonObjectWriter::endObject()
+{
+    Q_ASSERT_X(nonEmpty.size() > 1, __FUNCTION__,
+               "endObject() without a matching beginObject()");
+    buffer += '}';
+    nonEmpty.pop_back();
+}
+
+void JsonObjectWriter::write(const QString& key, const QJsonObject& value)
+{
+    writeKey(key);
+    buffer += QJsonDocument(value).toJson(QJsonDocument::Compact);
+}
+
+void JsonObjectWriter::write(const QString& key, const QString& value)
+{
+    writeKey(key);
+    appendJsonString(buffer, value);
+}
+
+QByteArray JsonObjectWriter::finish()
+{
+    buffer += QByteArray(nonEmpty.size(), '}');
+    nonEmpty.clear();
+    return std::exchange(buffer, {});
+}
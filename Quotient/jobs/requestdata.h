@@ -5,12 +5,50 @@
 
 #include <Quotient/util.h>
 
+#include <QtCore/QVarLengthArray>
+
 class QJsonObject;
 class QJsonArray;
 class QJsonDocument;
 class QIODevice;
 
 namespace Quotient {
+/**
+ * An incremental writer of a JSON object
+ *
+ * Large request bodies (e.g. to-device messages with room keys for hundreds
+ * of devices) are usually assembled into QHash'es, then converted to
+ * a QJsonObject and only then serialised, which keeps several copies of
+ * the whole payload in memory at once. This class writes the JSON text
+ * directly, one value at a time, so that the only full copy is the resulting
+ * byte array - which RequestData then uses without copying.
+ *
+ * Keys are not checked for uniqueness; avoid repeating them.
+ */
+class QUOTIENT_API JsonObjectWriter {
+public:
+    JsonObjectWriter();
+
+    //! Start a nested object under \p key; end it with endObject()
+    void beginObject(const QString& key);
+    void endObject();
+
+    void write(const QString& key, const QJsonObject& value);
+    void write(const QString& key, const QString& value);
+
+    //! \brief Close the remaining objects and return the JSON text
+    //!
+    //! The writer is left empty and can't be used after this.
+    QByteArray finish();
+
+private:
+    QByteArray buffer;
+    // Whether the object at each level of nesting already has any entries
+    QVarLengthArray<bool, 8> nonEmpty;
+
+    void writeKey(const QString& key);
+};
+
 /**
  * A simple wrapper that represents the request body.
  * Provides a unified interface to dump an unstructured byte stream
@@ -25,6 +63,7 @@ public:
     QUO_IMPLICIT RequestData(const QJsonObject& jo);
     QUO_IMPLICIT RequestData(const QJsonArray& ja);
     QUO_IMPLICIT RequestData(QIODevice* source);
+    QUO_IMPLICIT RequestData(JsonObjectWriter&& writer);
     // NOLINTEND(google-explicit-constructor)
 
     QIODevice* source() const { return _source.get(); }
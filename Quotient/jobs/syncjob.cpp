@@ -13,6 +13,10 @@ SyncJob::SyncJob(const QString& since, const QString& filter, int timeout,
               "_matrix/client/r0/sync")
 {
     setLoggingCategory(SYNCJOB);
+    setNetworkLane(NetworkLane::LongPoll);
+    // Syncs are run in the background but should not wait behind other jobs
+    // in the background, let alone be limited along with them
+    setPriority(JobPriority::Normal);
     QUrlQuery query;
     addParam<IfNotEmpty>(query, QStringLiteral("filter"), filter);
     addParam<IfNotEmpty>(query, QStringLiteral("set_presence"), presence);
@@ -22,6 +26,13 @@ SyncJob::SyncJob(const QString& since, const QString& filter, int timeout,
     setRequestQuery(query);
 
     setMaxRetries(std::numeric_limits<int>::max());
+    // With streaming parsers enabled, rooms are converted one by one right
+    // from the response body instead of building the tree for all of them
+    addPropertyReader("rooms"_ls, [](JsonReader& reader, std::any& storage) {
+        auto data = std::make_shared<SyncData>();
+        data->parseRooms(reader);
+        storage = std::move(data);
+    });
 }
 
 SyncJob::SyncJob(const QString& since, const Filter& filter, int timeout,
@@ -33,6 +44,8 @@ SyncJob::SyncJob(const QString& since, const Filter& filter, int timeout,
 
 BaseJob::Status SyncJob::prepareResult()
 {
+    if (auto& rooms = decodedValue("rooms"_ls); rooms.has_value())
+        d = std::move(**std::any_cast<std::shared_ptr<SyncData>>(&rooms));
     d.parseJson(jsonData());
     if (Q_LIKELY(d.unresolvedRooms().isEmpty()))
         return Success;
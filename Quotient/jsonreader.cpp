@@ -0,0 +1,437 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "jsonreader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+using namespace Quotient;
+
+// Same as QJsonDocument's limit, to protect the stack in readValue()
+static constexpr auto MaxNestingLevel = 1024;
+
+JsonReader::JsonReader(QByteArray json)
+    : json(std::move(json))
+    , pos(this->json.constData())
+    , end(pos + this->json.size())
+{}
+
+bool JsonReader::fail(const char* message)
+{
+    if (!hasError())
+        errorMessage = QStringLiteral("%1 at offset %2")
+                           .arg(QLatin1String(message))
+                           .arg(pos - json.constData());
+    pos = end;
+    containers.clear();
+    return false;
+}
+
+void JsonReader::skipWhitespace()
+{
+    while (pos != end
+           && (*pos == ' ' || *pos == '\n' || *pos == '\r' || *pos == '\t'))
+        ++pos;
+}
+
+JsonReader::ValueType JsonReader::peek()
+{
+    skipWhitespace();
+    if (pos == end)
+        return Invalid;
+    switch (*pos) {
+    case '{':
+        return Object;
+    case '[':
+        return Array;
+    case '"':
+        return String;
+    case 't':
+    case 'f':
+        return Bool;
+    case 'n':
+        return Null;
+    case '-':
+        return Number;
+    default:
+        return *pos >= '0' && *pos <= '9' ? Number : Invalid;
+    }
+}
+
+bool JsonReader::enterContainer(ValueType type)
+{
+    if (peek() != type) {
+        skipValue();
+        return false;
+    }
+    if (containers.size() >= MaxNestingLevel)
+        return fail("Too deeply nested document");
+    ++pos;
+    containers.push_back(true);
+    return true;
+}
+
+bool JsonReader::enterObject() { return enterContainer(Object); }
+
+bool JsonReader::enterArray() { return enterContainer(Array); }
+
+bool JsonReader::nextItem(char closingBracket)
+{
+    if (containers.empty())
+        return false; // Either misuse or an error has already occurred
+    skipWhitespace();
+    if (pos == end)
+        return fail("Unterminated object or array");
+    if (*pos == closingBracket) {
+        ++pos;
+        containers.pop_back();
+        return false;
+    }
+    if (containers.back())
+        containers.back() = false;
+    else if (*pos == ',') {
+        ++pos;
+        skipWhitespace();
+    } else
+        return fail("Missing value separator");
+    return true;
+}
+
+bool JsonReader::nextKey()
+{
+    if (!nextItem('}'))
+        return false;
+    if (pos == end || *pos != '"')
+        return fail("Missing property name");
+    const char* begin = nullptr;
+    keyBuffer.clear();
+    if (!scanString(begin, &keyBuffer))
+        return false;
+    currentKey = begin ? QByteArray::fromRawData(begin, int(pos - 1 - begin))
+                       : keyBuffer;
+    skipWhitespace();
+    if (pos == end || *pos != ':')
+        return fail("Missing name separator");
+    ++pos;
+    return true;
+}
+
+bool JsonReader::nextElement() { return nextItem(']'); }
+
+static void appendUtf8(QByteArray& target, char32_t c)
+{
+    if (c < 0x80)
+        target.append(char(c));
+    else if (c < 0x800) {
+        target.append(char(0xC0 | (c >> 6)));
+        target.append(char(0x80 | (c & 0x3F)));
+    } else if (c < 0x10000) {
+        target.append(char(0xE0 | (c >> 12)));
+        target.append(char(0x80 | ((c >> 6) & 0x3F)));
+        target.append(char(0x80 | (c & 0x3F)));
+    } else {
+        target.append(char(0xF0 | (c >> 18)));
+        target.append(char(0x80 | ((c >> 12) & 0x3F)));
+        target.append(char(0x80 | ((c >> 6) & 0x3F)));
+        target.append(char(0x80 | (c & 0x3F)));
+    }
+}
+
+static bool parseHex4(const char* p, const char* end, char32_t& result)
+{
+    if (end - p < 4)
+        return false;
+    result = 0;
+    for (const auto* const last = p + 4; p != last; ++p) {
+        result <<= 4;
+        if (*p >= '0' && *p <= '9')
+            result |= char32_t(*p - '0');
+        else if (*p >= 'a' && *p <= 'f')
+            result |= char32_t(*p - 'a' + 10);
+        else if (*p >= 'A' && *p <= 'F')
+            result |= char32_t(*p - 'A' + 10);
+        else
+            return false;
+    }
+    return true;
+}
+
+bool JsonReader::scanString(const char*& begin, QByteArray* decoded)
+{
+    Q_ASSERT(pos != end && *pos == '"');
+    const char* chunkStart = ++pos;
+    // The fast path: no escapes, the string can be used in place
+    while (pos != end && *pos != '"' && *pos != '\\')
+        ++pos;
+    if (pos == end)
+        return fail("Unterminated string");
+    if (*pos == '"') {
+        begin = chunkStart;
+        ++pos;
+        return true;
+    }
+    begin = nullptr;
+    while (true) {
+        if (decoded)
+            decoded->append(chunkStart, int(pos - chunkStart));
+        if (*pos == '"') {
+            ++pos;
+            return true;
+        }
+        // *pos == '\\'
+        if (++pos == end)
+            return fail("Unterminated string");
+        const auto escaped = *pos++;
+        if (escaped == 'u') {
+            char32_t c = 0;
+            if (!parseHex4(pos, end, c))
+                return fail("Invalid \\u escape in a string");
+            pos += 4;
+            if (c >= 0xD800 && c < 0xDC00) { // High surrogate, look for the pair
+                char32_t low = 0;
+                if (end - pos >= 6 && pos[0] == '\\' && pos[1] == 'u'
+                    && parseHex4(pos + 2, end, low) && low >= 0xDC00
+                    && low < 0xE000) {
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                    pos += 6;
+                } else
+                    c = 0xFFFD;
+            } else if (c >= 0xDC00 && c < 0xE000)
+                c = 0xFFFD; // Unpaired low surrogate
+            if (decoded)
+                appendUtf8(*decoded, c);
+        } else {
+            char c = 0;
+            switch (escaped) {
+            case '"':
+            case '\\':
+            case '/':
+                c = escaped;
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            default:
+                return fail("Invalid escape sequence in a string");
+            }
+            if (decoded)
+                decoded->append(c);
+        }
+        chunkStart = pos;
+        while (pos != end && *pos != '"' && *pos != '\\')
+            ++pos;
+        if (pos == end)
+            return fail("Unterminated string");
+    }
+}
+
+QString JsonReader::readString()
+{
+    if (peek() != String) {
+        skipValue();
+        return {};
+    }
+    const char* begin = nullptr;
+    QByteArray decoded;
+    if (!scanString(begin, &decoded))
+        return {};
+    return begin ? QString::fromUtf8(begin, int(pos - 1 - begin))
+                 : QString::fromUtf8(decoded);
+}
+
+const char* JsonReader::scanNumber()
+{
+    const auto* const begin = pos;
+    while (pos != end
+           && ((*pos >= '0' && *pos <= '9') || *pos == '-' || *pos == '+'
+               || *pos == '.' || *pos == 'e' || *pos == 'E'))
+        ++pos;
+    return begin;
+}
+
+static bool isIntegral(const char* begin, const char* end)
+{
+    return std::find_if(begin, end,
+                        [](char c) { return c == '.' || c == 'e' || c == 'E'; })
+           == end;
+}
+
+static double toDouble(const char* begin, const char* end, bool* ok)
+{
+    return QByteArray::fromRawData(begin, int(end - begin)).toDouble(ok);
+}
+
+qint64 JsonReader::readInteger()
+{
+    if (peek() != Number) {
+        skipValue();
+        return 0;
+    }
+    const auto* const begin = scanNumber();
+    if (isIntegral(begin, pos)) {
+        qint64 result = 0;
+        if (const auto [ptr, ec] = std::from_chars(begin, pos, result);
+            ec == std::errc() && ptr == pos)
+            return result;
+    }
+    bool ok = false;
+    const auto result = toDouble(begin, pos, &ok);
+    if (!ok)
+        fail("Invalid number");
+    return qint64(result);
+}
+
+double JsonReader::readDouble()
+{
+    if (peek() != Number) {
+        skipValue();
+        return 0;
+    }
+    const auto* const begin = scanNumber();
+    bool ok = false;
+    const auto result = toDouble(begin, pos, &ok);
+    if (!ok)
+        fail("Invalid number");
+    return result;
+}
+
+bool JsonReader::readBool()
+{
+    if (peek() != Bool) {
+        skipValue();
+        return false;
+    }
+    if (end - pos >= 4 && std::memcmp(pos, "true", 4) == 0) {
+        pos += 4;
+        return true;
+    }
+    if (end - pos >= 5 && std::memcmp(pos, "false", 5) == 0)
+        pos += 5;
+    else
+        fail("Invalid literal");
+    return false;
+}
+
+void JsonReader::skipValue()
+{
+    switch (peek()) {
+    case String: {
+        const char* begin = nullptr;
+        scanString(begin, nullptr);
+        return;
+    }
+    case Number:
+        if (scanNumber() == pos)
+            fail("Invalid number");
+        return;
+    case Bool:
+        readBool();
+        return;
+    case Null:
+        if (end - pos >= 4 && std::memcmp(pos, "null", 4) == 0)
+            pos += 4;
+        else
+            fail("Invalid literal");
+        return;
+    case Object:
+    case Array: {
+        // Only track the nesting and strings (that may contain brackets)
+        int depth = 0;
+        do {
+            switch (*pos) {
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                --depth;
+                break;
+            case '"': {
+                const char* begin = nullptr;
+                if (!scanString(begin, nullptr))
+                    return;
+                continue; // scanString() has already moved past the string
+            }
+            default:;
+            }
+            ++pos;
+        } while (depth > 0 && pos != end);
+        if (depth > 0)
+            fail("Unterminated object or array");
+        return;
+    }
+    case Invalid:
+        if (!hasError())
+            fail(pos == end ? "Unexpected end of the document"
+                            : "Unexpected character");
+    }
+}
+
+QJsonValue JsonReader::readValue()
+{
+    switch (peek()) {
+    case Object: {
+        QJsonObject o;
+        if (enterObject())
+            while (nextKey()) {
+                const auto k = QString::fromUtf8(currentKey);
+                o.insert(k, readValue());
+            }
+        return o;
+    }
+    case Array: {
+        QJsonArray a;
+        if (enterArray())
+            while (nextElement())
+                a.append(readValue());
+        return a;
+    }
+    case String:
+        return readString();
+    case Number: {
+        const auto* const begin = scanNumber();
+        if (isIntegral(begin, pos)) {
+            qint64 result = 0;
+            if (const auto [ptr, ec] = std::from_chars(begin, pos, result);
+                ec == std::errc() && ptr == pos)
+                return result;
+        }
+        bool ok = false;
+        const auto result = toDouble(begin, pos, &ok);
+        if (!ok)
+            fail("Invalid number");
+        return result;
+    }
+    case Bool:
+        return readBool();
+    case Null:
+        skipValue();
+        return QJsonValue::Null;
+    case Invalid:
+        skipValue(); // Sets the error
+    }
+    return QJsonValue::Undefined;
+}
+
+bool JsonReader::finish()
+{
+    skipWhitespace();
+    if (pos != end)
+        fail("Garbage at the end of the document");
+    return !hasError();
+}
@@ -0,0 +1,234 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#pragma once
+
+#include "converters.h"
+
+#include <QtCore/QVarLengthArray>
+
+namespace Quotient {
+
+//! \brief A pull parser for JSON in UTF-8
+//!
+//! JsonReader walks the raw bytes of a JSON document and lets the caller
+//! decide what to do with each value as it comes: read it into a C++ object
+//! directly, build a QJsonValue only for this one node (readValue()), or skip
+//! it altogether. This avoids building a QJsonDocument for the whole response
+//! only to convert it to C++ structures and throw it away afterwards.
+//!
+//! Objects and arrays are traversed as follows:
+//! \code
+//! if (reader.enterObject())
+//!     while (reader.nextKey())
+//!         if (reader.key() == "name")
+//!             name = reader.readString();
+//!         else
+//!             reader.skipValue();
+//! \endcode
+//! Every value inside a container must be either read or skipped, and
+//! the iteration must go on until nextKey()/nextElement() return false.
+//!
+//! Errors are sticky: once the document turns out to be malformed, all
+//! further reads return empty values and hasError() returns true. Values
+//! passed to skipValue() are not validated beyond what's necessary to find
+//! their end.
+class QUOTIENT_API JsonReader {
+public:
+    enum ValueType { Invalid, Null, Bool, Number, String, Array, Object };
+
+    explicit JsonReader(QByteArray json);
+
+    //! The type of the next value; Invalid at the end or after an error
+    ValueType peek();
+
+    //! \brief Start reading an object
+    //!
+    //! If the next value is not an object, it is skipped and false is returned
+    bool enterObject();
+    //! \brief Move to the next property of the current object
+    //! \return false if the object is over (or an error has occurred)
+    bool nextKey();
+    //! \brief The current property key, as UTF-8
+    //!
+    //! The returned array only stays valid until the property value is read.
+    const QByteArray& key() const { return currentKey; }
+
+    //! \brief Start reading an array
+    //!
+    //! If the next value is not an array, it is skipped and false is returned
+    bool enterArray();
+    //! \brief Move to the next element of the current array
+    //! \return false if the array is over (or an error has occurred)
+    bool nextElement();
+
+    // Scalar readers below skip values of other types and return the same
+    // defaults as the respective QJsonValue::to*() functions
+
+    QString readString();
+    qint64 readInteger();
+    double readDouble();
+    bool readBool();
+
+    void skipValue();
+    //! Build a QJsonValue for the next value
+    QJsonValue readValue();
+
+    //! \brief Check that nothing but whitespace follows the top-level value
+    //! \return true if the whole document has been read successfully
+    bool finish();
+
+    bool hasError() const { return !errorMessage.isEmpty(); }
+    QString errorString() const { return errorMessage; }
+
+private:
+    QByteArray json;
+    const char* pos;
+    const char* end;
+    QByteArray currentKey;
+    QByteArray keyBuffer;
+    //! Open containers, innermost last; `true` until the first item is read
+    QVarLengthArray<bool, 32> containers;
+    QString errorMessage;
+
+    void skipWhitespace();
+    bool enterContainer(ValueType type);
+    bool nextItem(char closingBracket);
+    //! \brief Find the end of the string starting at pos, decoding escapes
+    //!
+    //! When the string has no escapes, \p decoded is not touched and
+    //! the string itself is located between \p begin and pos - 1.
+    bool scanString(const char*& begin, QByteArray* decoded);
+    const char* scanNumber();
+    bool fail(const char* message);
+};
+
+//! \brief The switchboard for reading C++ values with JsonReader
+//!
+//! Specialisations provide either `readFrom(JsonReader&, T&)` to read
+//! the whole value, or (for structures) `readField(JsonReader&, key, T&)` that
+//! reads a single property and returns false if the key is not recognised.
+//! The default implementation reads the value into a QJsonValue and converts
+//! it with fillFromJson(), so that every type supported by JsonConverter can
+//! be read, if not as efficiently.
+template <typename T>
+struct JsonReaderConverter {
+    static void readFrom(JsonReader& reader, T& pod)
+    {
+        fillFromJson(reader.readValue(), pod);
+    }
+};
+
+template <typename T>
+inline void readFromJson(JsonReader& reader, T& pod)
+{
+    if constexpr (requires(const QByteArray& key) {
+                      JsonReaderConverter<T>::readField(reader, key, pod);
+                  }) {
+        if (reader.enterObject())
+            while (reader.nextKey())
+                if (!JsonReaderConverter<T>::readField(reader, reader.key(),
+                                                       pod))
+                    reader.skipValue();
+    } else
+        JsonReaderConverter<T>::readFrom(reader, pod);
+}
+
+template <>
+struct JsonReaderConverter<QString> {
+    static void readFrom(JsonReader& reader, QString& s)
+    {
+        s = reader.readString();
+    }
+};
+
+template <>
+struct JsonReaderConverter<bool> {
+    static void readFrom(JsonReader& reader, bool& b) { b = reader.readBool(); }
+};
+
+template <>
+struct JsonReaderConverter<int> {
+    static void readFrom(JsonReader& reader, int& n)
+    {
+        n = static_cast<int>(reader.readInteger());
+    }
+};
+
+template <>
+struct JsonReaderConverter<qint64> {
+    static void readFrom(JsonReader& reader, qint64& n)
+    {
+        n = reader.readInteger();
+    }
+};
+
+template <>
+struct JsonReaderConverter<double> {
+    static void readFrom(JsonReader& reader, double& d)
+    {
+        d = reader.readDouble();
+    }
+};
+
+template <typename T>
+struct JsonReaderConverter<Omittable<T>> {
+    static void readFrom(JsonReader& reader, Omittable<T>& o)
+    {
+        if (reader.peek() == JsonReader::Null) {
+            reader.skipValue();
+            o.reset();
+            return;
+        }
+        readFromJson(reader, o.emplace());
+    }
+};
+
+template <typename ContT>
+struct JsonArrayReader {
+    static void readFrom(JsonReader& reader, ContT& vals)
+    {
+        vals.clear();
+        if (reader.enterArray())
+            while (reader.nextElement()) {
+                typename ContT::value_type v;
+                readFromJson(reader, v);
+                vals.push_back(std::move(v));
+            }
+    }
+};
+
+template <typename T>
+struct JsonReaderConverter<std::vector<T>>
+    : JsonArrayReader<std::vector<T>> {};
+
+#if QT_VERSION_MAJOR < 6 // QVector is an alias of QList in Qt6 but not in Qt 5
+template <typename T>
+struct JsonReaderConverter<QVector<T>> : JsonArrayReader<QVector<T>> {};
+#endif
+
+template <typename T>
+struct JsonReaderConverter<QList<T>> : JsonArrayReader<QList<T>> {};
+
+template <>
+struct JsonReaderConverter<QStringList> : JsonArrayReader<QStringList> {};
+
+template <typename HashMapT>
+struct HashMapJsonReader {
+    static void readFrom(JsonReader& reader, HashMapT& h)
+    {
+        if (reader.enterObject())
+            while (reader.nextKey())
+                readFromJson(reader, h[QString::fromUtf8(reader.key())]);
+    }
+};
+
+template <typename T, typename HashT>
+struct JsonReaderConverter<std::unordered_map<QString, T, HashT>>
+    : HashMapJsonReader<std::unordered_map<QString, T, HashT>> {};
+
+template <typename T>
+struct JsonReaderConverter<QHash<QString, T>>
+    : HashMapJsonReader<QHash<QString, T>> {};
+
+} // namespace Quotient
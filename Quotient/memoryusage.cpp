@@ -0,0 +1,63 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "memoryusage.h"
+
+#include "events/event.h"
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+
+#include <numeric>
+
+using namespace Quotient;
+
+qint64 MemoryUsage::totalBytes() const
+{
+    return std::accumulate(entries.cbegin(), entries.cend(), qint64(0),
+                           [](qint64 sum, const Entry& e) {
+                               return sum + e.bytes;
+                           });
+}
+
+qint64 MemoryUsage::bytesOf(const QString& s)
+{
+    // Shared (and literal) strings are counted in full at each place they're
+    // used, which overestimates but keeps it simple
+    return s.isNull() ? 0 : qint64(s.capacity() + 1) * 2 + NodeOverhead;
+}
+
+namespace {
+// Walks the JSON instead of serialising it, to avoid allocating a buffer
+// as large as the whole event for each estimate
+qint64 jsonBytes(const QJsonValue& v)
+{
+    switch (v.type()) {
+    case QJsonValue::String:
+        return qint64(v.toString().size()) * 2;
+    case QJsonValue::Array: {
+        const auto array = v.toArray();
+        return std::accumulate(array.begin(), array.end(),
+                               qint64(sizeof(QJsonValue)) * array.size(),
+                               [](qint64 sum, const QJsonValue& item) {
+                                   return sum + jsonBytes(item);
+                               });
+    }
+    case QJsonValue::Object: {
+        const auto object = v.toObject();
+        qint64 bytes = 0;
+        for (auto it = object.begin(); it != object.end(); ++it)
+            bytes += qint64(it.key().size()) * 2 + qint64(sizeof(QJsonValue))
+                     + jsonBytes(it.value());
+        return bytes;
+    }
+    default: // Numbers, booleans and nulls are stored in place
+        return 0;
+    }
+}
+} // namespace
+
+qint64 MemoryUsage::bytesOf(const Event& e)
+{
+    return qint64(sizeof(Event)) + jsonBytes(e.fullJson());
+}
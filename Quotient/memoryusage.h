@@ -0,0 +1,50 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#pragma once
+
+#include "quotient_export.h"
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+namespace Quotient {
+
+class Event;
+
+//! \brief Approximate memory used by a group of data structures
+//!
+//! Each entry describes one structure (e.g. the timeline of a room) with
+//! the number of items in it and an estimate of the bytes they take. Events
+//! are estimated by the keys and values in their JSON; containers
+//! by their keys and values plus a fixed overhead per node. The estimates
+//! are meant for comparing rooms and spotting growth over time rather than
+//! for exact figures; collecting them walks through all the data, which is
+//! not free for big accounts.
+//!
+//! \sa Room::memoryUsage, Connection::memoryUsage,
+//!     Connection::memoryUsageMetrics
+struct QUOTIENT_API MemoryUsage {
+    struct Entry {
+        QString structure;
+        qsizetype items = 0;
+        qint64 bytes = 0;
+    };
+    QVector<Entry> entries;
+
+    void add(QString structure, qsizetype items, qint64 bytes)
+    {
+        entries.push_back({ std::move(structure), items, bytes });
+    }
+    qint64 totalBytes() const;
+
+    //! Approximate overhead of a node in hash-based containers
+    static constexpr qint64 NodeOverhead = 2 * sizeof(void*);
+
+    //! Approximate heap size of the string's contents
+    static qint64 bytesOf(const QString& s);
+    //! Approximate size of the event object with its JSON
+    static qint64 bytesOf(const Event& e);
+};
+
+} // namespace Quotient
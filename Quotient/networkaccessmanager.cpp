@@ -84,18 +84,46 @@ void NetworkAccessManager::clearIgnoredSslErrors()
 
 NetworkAccessManager* NetworkAccessManager::instance()
 {
-    thread_local auto* nam = [] {
-        auto* namInit = new NetworkAccessManager();
-        connect(QThread::currentThread(), &QThread::finished, namInit,
+    return instance(NetworkLane::Interactive);
+}
+
+NetworkAccessManager* NetworkAccessManager::instance(NetworkLane lane)
+{
+    thread_local std::array<NetworkAccessManager*, NetworkLaneCount> nams {};
+    auto*& nam = nams[static_cast<size_t>(lane)];
+    if (!nam) {
+        nam = new NetworkAccessManager();
+        connect(QThread::currentThread(), &QThread::finished, nam,
                 &QObject::deleteLater);
-        return namInit;
-    }();
+        if (lane != NetworkLane::Interactive) {
+            auto* const primary = instance(NetworkLane::Interactive);
+            nam->primary = primary;
+            connect(nam, &QNetworkAccessManager::sslErrors, primary,
+                    &QNetworkAccessManager::sslErrors);
+            connect(nam, &QNetworkAccessManager::encrypted, primary,
+                    &QNetworkAccessManager::encrypted);
+            connect(nam, &QNetworkAccessManager::authenticationRequired,
+                    primary, &QNetworkAccessManager::authenticationRequired);
+            connect(nam, &QNetworkAccessManager::proxyAuthenticationRequired,
+                    primary,
+                    &QNetworkAccessManager::proxyAuthenticationRequired);
+            connect(nam, &QNetworkAccessManager::finished, primary,
+                    &QNetworkAccessManager::finished);
+        }
+    }
     return nam;
 }
 
 QNetworkReply* NetworkAccessManager::createRequest(
     Operation op, const QNetworkRequest& request, QIODevice* outgoingData)
 {
+    if (primary) {
+        // Copied for each request, so that changes to instance() apply
+        if (proxy() != primary->proxy())
+            setProxy(primary->proxy());
+        setRedirectPolicy(primary->redirectPolicy());
+        setTransferTimeout(primary->transferTimeout());
+    }
     const auto url = request.url();
     if (url.scheme() != "mxc"_ls) {
         auto reply =
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "quotient_common.h"
 #include "Quotient/quotient_export.h"
 
 #include <QtNetwork/QNetworkAccessManager>
@@ -23,11 +24,26 @@ public:
 
     //! Get a NAM instance for the current thread
     static NetworkAccessManager* instance();
+    //! \brief Get a NAM instance for the current thread and the given lane
+    //!
+    //! Each lane has a separate instance, with its own connection cache;
+    //! instance() is the same as instance(NetworkLane::Interactive) and is
+    //! the configuration point for all lanes. The instances of other lanes
+    //! take the proxy, the redirect policy and the transfer timeout from it
+    //! for each request, and re-emit their sslErrors(), encrypted(),
+    //! authenticationRequired(), proxyAuthenticationRequired() and finished()
+    //! signals from it, so that handlers connected to instance() cover
+    //! the requests of all lanes. The network cache and the cookie jar are
+    //! not shared, as QNetworkAccessManager takes ownership of them.
+    static NetworkAccessManager* instance(NetworkLane lane);
 
 private Q_SLOTS:
     QStringList supportedSchemesImplementation() const; // clazy:exclude=const-signal-or-slot
 
 private:
+    //! The instance for NetworkLane::Interactive, if this is one of other lanes
+    NetworkAccessManager* primary = nullptr;
+
     QNetworkReply* createRequest(Operation op, const QNetworkRequest& request,
                                  QIODevice* outgoingData = Q_NULLPTR) override;
 };
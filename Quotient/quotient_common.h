@@ -96,6 +96,49 @@ QUO_DECLARE_FLAGS_NS(JoinStates, JoinState)
 enum RunningPolicy { ForegroundRequest = 0x0, BackgroundRequest = 0x1 };
 Q_ENUM_NS(RunningPolicy)
 
+//! \brief Kinds of network traffic that go over separate connections
+//!
+//! Each lane has its own network access manager and, therefore, its own pool
+//! of connections to the homeserver, so that a long-polling /sync request or
+//! a pile of media downloads don't stand in the way of interactive requests.
+//! \sa BaseJob::networkLane, Connection::setMaxRequestsInFlight
+enum class NetworkLane : uint8_t {
+    Interactive = 0, //!< Regular API calls
+    LongPoll, //!< Requests that stay open for long, i.e. /sync
+    Bulk //!< Media downloads and thumbnails
+};
+Q_ENUM_NS(NetworkLane)
+
+constexpr size_t NetworkLaneCount = 3;
+
+//! \brief Priority classes of network jobs
+//!
+//! Queued jobs are sent in the order of their priority classes, and in
+//! the order of queueing within a class. Lower classes have limits on
+//! the number of concurrent requests, so that jobs the user waits for don't
+//! get stuck behind a pile of background work; a job that has waited for
+//! long is sent ahead of higher classes, so that lower classes don't starve.
+//! \sa BaseJob::setPriority, Connection::setMaxRequestsInFlight
+enum class JobPriority : uint8_t {
+    Urgent = 0, //!< The user waits for it, e.g. sending a message
+    Normal, //!< The default for jobs run in the foreground
+    Background, //!< The default for jobs run in the background
+    Idle //!< Prefetching and other work that nobody waits for
+};
+Q_ENUM_NS(JobPriority)
+
+constexpr size_t JobPriorityCount = 4;
+
+//! \brief Request counters for a network lane of a connection
+//! \sa Connection::networkLaneStats
+struct NetworkLaneStats {
+    int inFlight = 0; //!< Requests sent and not finished yet
+    int waiting = 0; //!< Jobs queued and not sent yet
+    int maxInFlight = 0; //!< The concurrency limit, 0 if there's none
+    quint64 sent = 0; //!< Requests sent since the connection was created
+    quint64 sentOverHttp2 = 0; //!< Finished requests that used HTTP/2
+};
+
 //! \brief The result of URI resolution using UriResolver
 //! \sa UriResolver
 enum UriResolveResult : int8_t {
@@ -17,6 +17,7 @@
 #include "eventstats.h"
 #include "roomstateview.h"
 #include "qt_connection_util.h"
+#include "tracing.h"
 
 // NB: since Qt 6, moc_room.cpp needs User fully defined
 #include "moc_room.cpp"
@@ -51,15 +52,20 @@
 #include "jobs/downloadfilejob.h"
 #include "jobs/mediathumbnailjob.h"
 
+#include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QHash>
+#include <QtCore/QMetaMethod>
 #include <QtCore/QPointer>
 #include <QtCore/QRegularExpression>
 #include <QtCore/QStringBuilder> // for efficient string concats (operator%)
 #include <QtCore/QTemporaryFile>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
 
 #include <array>
 #include <cmath>
+#include <deque>
 #include <functional>
 
 #ifdef Quotient_E2EE_ENABLED
@@ -67,6 +73,8 @@
 #include "e2ee/qolmaccount.h"
 #include "e2ee/qolminboundsession.h"
 #include "database.h"
+
+#include <olm/olm.h>
 #endif // Quotient_E2EE_ENABLED
 
 
@@ -80,9 +88,9 @@ enum EventsPlacement : int { Older = -1, Newer = 1 };
 
 class Q_DECL_HIDDEN Room::Private {
 public:
-    /// Map of user names to users
+    /// Map of user names to user ids
     /** User names potentially duplicate, hence QMultiHash. */
-    using members_map_t = QMultiHash<QString, User*>;
+    using members_map_t = QMultiHash<QString, QString>;
 
     Private(Connection* c, QString id_, JoinState initialJoinState)
         : connection(c)
@@ -109,6 +117,29 @@ public:
 
     Timeline timeline;
     PendingEvents unsyncedEvents;
+    //! \brief An item in the queue of outgoing messages
+    //!
+    //! The pending message event is identified by its transaction id.
+    struct OutgoingItem {
+        QString txnId;
+        //! The event as it will be sent, if it differs from the pending one
+        RoomEventPtr payload = nullptr;
+    };
+    std::deque<OutgoingItem> sendQueue;
+    //! \brief A message that has been sent but not acknowledged yet
+    //!
+    //! Responses from the server are applied in the order of sending, even if
+    //! they come in a different order, so that clients see messages reach
+    //! the server in the order they were posted.
+    struct SentMessage {
+        QString txnId;
+        //! Applies the response; empty until the response comes
+        std::function<void()> acknowledge;
+    };
+    std::deque<SentMessage> unacknowledgedSends;
+    int requestsInFlight = 0;
+    static constexpr int DefaultMaxSendsInFlight = 1;
+    int maxSendsInFlight = DefaultMaxSendsInFlight;
     QHash<QString, TimelineItem::index_t> eventsIndex;
     // A map from evtId to a map of relation type to a vector of event
     // pointers. Not using QMultiHash, because we want to quickly return
@@ -124,8 +155,8 @@ public:
     members_map_t membersMap;
     QList<User*> usersTyping;
     QHash<QString, QSet<QString>> eventIdReadUsers;
-    QList<User*> usersInvited;
-    QList<User*> membersLeft;
+    QStringList usersInvited;
+    QStringList membersLeft;
     bool displayed = false;
     QString firstDisplayedEventId;
     QString lastDisplayedEventId;
@@ -143,7 +174,27 @@ public:
     //! requesting further historical batches.
     Omittable<QString> prevBatch = QString();
     QPointer<GetRoomEventsJob> eventsHistoryJob;
+    int historyReadAhead = 0;
     QPointer<GetMembersByRoomJob> allMembersJob;
+    //! Set from requesting the full member list until it is fully applied
+    bool allMembersLoading = false;
+    //! The full member list, applied in slices by applyAllMembers()
+    StateEvents allMembers;
+    size_t allMembersApplied = 0;
+    Changes allMembersChanges {};
+    //! The first timeline index not covered by the full member list
+    TimelineItem::index_t allMembersReplayFrom = 0;
+    //! \brief Users whose membership came in the sync state since requesting
+    //!        the full member list
+    //!
+    //! Their entries in the full member list are older and are skipped.
+    QSet<QString> membersUpdatedSinceRequest;
+    static constexpr auto AllMembersSliceBudget = std::chrono::milliseconds(8);
+    //! \brief Set while the full member list is being applied
+    //!
+    //! Suppresses signals about disambiguating namesakes of each added
+    //! member; allMembersLoaded() and memberListChanged() cover those.
+    bool bulkMemberUpdate = false;
     //! Map from megolm sessionId to set of eventIds
     UnorderedMap<QString, QSet<QString>> undecryptedEvents;
 
@@ -201,21 +252,55 @@ public:
                              const RoomEvent* oldEvent);
 
     // void inviteUser(User* u); // We might get it at some point in time.
-    void insertMemberIntoMap(User* u);
-    void removeMemberFromMap(User* u);
+    void insertMemberIntoMap(const QString& userId);
+    void removeMemberFromMap(const QString& userId);
+    //! \brief Emit a signal about a room member
+    //!
+    //! User objects are only created for members when the respective signal
+    //! has receivers; membership itself is tracked by user ids.
+    template <typename... SignalArgTs, typename... ArgTs>
+    void emitMemberSignal(void (Room::*signal)(User*, SignalArgTs...),
+                          const QString& userId, ArgTs&&... args)
+    {
+        if (q->isSignalConnected(QMetaMethod::fromSignal(signal)))
+            if (auto* u = q->user(userId))
+                emit(q->*signal)(u, std::forward<ArgTs>(args)...);
+    }
+    QList<User*> usersFromIds(const QStringList& userIds) const
+    {
+        QList<User*> users;
+        users.reserve(userIds.size());
+        for (const auto& userId : userIds)
+            if (auto* u = q->user(userId))
+                users.push_back(u);
+        return users;
+    }
 
     // This updates the room displayname field (which is the way a room
     // should be shown in the room list); called whenever the list of
     // members, the room name (m.room.name) or canonical alias change.
     void updateDisplayname();
     // This is used by updateDisplayname() but only calculates the new name
-    // without any updates.
-    QString calculateDisplayname() const;
+    // without any updates (aside from remembering the users the name
+    // is made of, see displaynameShortlist).
+    QString calculateDisplayname();
+    // Whether a change in the membership of \p userId may change
+    // the displayname; \p prevName is the name the user had before the change
+    bool memberAffectsDisplayname(const QString& userId,
+                                  const QString& prevName) const;
+    // Set when the inputs of calculateDisplayname() have changed, to only
+    // recalculate the displayname once in postprocessChanges()
+    bool displaynameDirty = false;
 
     rev_iter_t historyEdge() const { return timeline.crend(); }
     Timeline::const_iterator syncEdge() const { return timeline.cend(); }
 
     void getPreviousContent(int limit = 10, const QString &filter = {});
+    //! \brief Request more history if too little is loaded beyond the
+    //!        first displayed event
+    //! \param incomingEvents events received but not yet added to
+    //!                       the timeline, counted as already loaded
+    void prefetchHistory(qsizetype incomingEvents = 0);
 
     const StateEvent* getCurrentState(const StateEventKey& evtKey) const
     {
@@ -239,20 +324,28 @@ public:
         return evt;
     }
 
+    //! Process the state event and, if it changes anything, make it current
+    Changes applyStateEvent(StateEventPtr&& eptr)
+    {
+        const auto& evt = *eptr;
+        Q_ASSERT(evt.isStateEvent());
+        const auto change = q->processStateEvent(evt);
+        if (change)
+            baseState[{ evt.matrixType(), evt.stateKey() }] = std::move(eptr);
+        return change;
+    }
+
     Changes updateStateFrom(StateEvents&& events)
     {
         Changes changes {};
         if (!events.empty()) {
+            const Tracing::Span span { "room", "updateState", id };
             QElapsedTimer et;
             et.start();
             for (auto&& eptr : std::move(events)) {
-                const auto& evt = *eptr;
-                Q_ASSERT(evt.isStateEvent());
-                if (auto change = q->processStateEvent(evt); change) {
-                    changes |= change;
-                    baseState[{ evt.matrixType(), evt.stateKey() }] =
-                        std::move(eptr);
-                }
+                if (allMembersLoading && is<RoomMemberEvent>(*eptr))
+                    membersUpdatedSinceRequest.insert(eptr->stateKey());
+                changes |= applyStateEvent(std::move(eptr));
             }
             if (events.size() > 9 || et.nsecsElapsed() >= ProfilerMinNsecs)
                 qCDebug(PROFILER)
@@ -307,6 +400,9 @@ public:
     bool markMessagesAsRead(const rev_iter_t& upToMarker);
 
     void getAllMembers();
+    void startApplyingAllMembers(StateEvents&& events,
+                                 TimelineItem::index_t replayFrom);
+    void applyAllMembers();
 
     QString sendEvent(RoomEventPtr&& event);
 
@@ -320,20 +416,32 @@ public:
 
     RoomEvent* addAsPending(RoomEventPtr&& event);
 
+    //! Put the pending event to the send queue and return its transaction id
     QString doSendEvent(const RoomEvent* pEvent);
+    //! \brief Start sending queued items, as many as allowed to be in flight
+    //!
+    //! Items are sent in the order of queueing; in encrypted rooms, each
+    //! message is encrypted right before sending it, and the session key is
+    //! shared at most once per call.
+    void dispatchSendQueue();
+#ifdef Quotient_E2EE_ENABLED
+    void encryptForSending(OutgoingItem& item, bool& keyShared);
+#endif
+    void sendQueuedEvent(OutgoingItem&& item);
+    //! Apply the responses that have come, up to the first one still awaited
+    void acknowledgeSends();
     void onEventSendingFailure(const QString& txnId, BaseJob* call = nullptr);
+    void onEventSendingFailure(const QString& txnId, const QString& reason);
 
     SetRoomStateWithKeyJob* requestSetState(const QString& evtType,
                                             const QString& stateKey,
                                             const QJsonObject& contentJson)
     {
-        //            if (event.roomId().isEmpty())
-        //                event.setRoomId(id);
-        //            if (event.senderId().isEmpty())
-        //                event.setSender(connection->userId());
-        // TODO: Queue up state events sending (see #133).
         // TODO: Maybe addAsPending() as well, despite having no txnId
-        return connection->callApi<SetRoomStateWithKeyJob>(id, evtType, stateKey,
+        // State events don't go through the send queue: callers expect
+        // a running job they can watch
+        return connection->callApi<SetRoomStateWithKeyJob>(id, evtType,
+                                                           stateKey,
                                                            contentJson);
     }
 
@@ -357,11 +465,21 @@ public:
 
     QJsonObject toJson() const;
 
-    bool isLocalUser(const User* u) const { return u == q->localUser(); }
+    bool isLocalUser(const QString& userId) const
+    {
+        return userId == connection->userId();
+    }
+    //! The same check as Connection::user() makes before creating a user
+    static bool isValidMemberId(const QString& userId)
+    {
+        return userId.startsWith(u'@') && !serverPart(userId).isEmpty();
+    }
 
 #ifdef Quotient_E2EE_ENABLED
     UnorderedMap<QByteArray, QOlmInboundGroupSession> groupSessions;
     Omittable<QOlmOutboundGroupSession> currentOutboundMegolmSession = none;
+    static constexpr auto OutboundSessionSaveInterval = std::chrono::seconds(5);
+    bool outboundSessionSaveScheduled = false;
 
     bool addInboundGroupSession(QByteArray sessionId, QByteArray sessionKey,
                                 const QString& senderId,
@@ -432,7 +550,11 @@ public:
 
     bool shouldRotateMegolmSession() const
     {
-        const auto* encryptionConfig = currentState.get<EncryptionEvent>();
+        return shouldRotateMegolmSession(currentState.get<EncryptionEvent>());
+    }
+
+    bool shouldRotateMegolmSession(const EncryptionEvent* encryptionConfig) const
+    {
         if (!encryptionConfig || !encryptionConfig->useEncryption())
             return false;
 
@@ -454,6 +576,7 @@ public:
         qCDebug(E2EE) << "Creating new outbound megolm session for room "
                       << q->objectName();
         currentOutboundMegolmSession.emplace();
+        outboundSessionSaveScheduled = false;
         connection->database()->saveCurrentOutboundMegolmSession(
             id, *currentOutboundMegolmSession);
 
@@ -462,12 +585,35 @@ public:
                                q->localUser()->id(), QByteArrayLiteral("SELF"));
     }
 
+    //! \brief Save the outbound session after it's been used for encryption
+    //!
+    //! Saving is deferred by OutboundSessionSaveInterval so that a burst of
+    //! messages leads to a single write; until then, the saved session is
+    //! marked as in use (see Database::markCurrentOutboundMegolmSessionInUse).
+    void scheduleOutboundSessionSave()
+    {
+        if (std::exchange(outboundSessionSaveScheduled, true))
+            return;
+        connection->database()->markCurrentOutboundMegolmSessionInUse(
+            id, currentOutboundMegolmSession->sessionId());
+        QTimer::singleShot(OutboundSessionSaveInterval, q,
+                           [this] { saveOutboundSession(); });
+    }
+
+    void saveOutboundSession()
+    {
+        if (std::exchange(outboundSessionSaveScheduled, false)
+            && currentOutboundMegolmSession)
+            connection->database()->saveCurrentOutboundMegolmSession(
+                id, *currentOutboundMegolmSession);
+    }
+
     QMultiHash<QString, QString> getDevicesWithoutKey() const
     {
         QMultiHash<QString, QString> devices;
-        for (const auto& user : q->users() + usersInvited)
-            for (const auto& deviceId : connection->devicesForUser(user->id()))
-                devices.insert(user->id(), deviceId);
+        for (const auto& userId : q->joinedMemberIds() + usersInvited)
+            for (const auto& deviceId : connection->devicesForUser(userId))
+                devices.insert(userId, deviceId);
 
         return connection->database()->devicesWithoutKey(
             id, devices, currentOutboundMegolmSession->sessionId());
@@ -475,10 +621,12 @@ public:
 #endif // Quotient_E2EE_ENABLED
 
 private:
-    using users_shortlist_t = std::array<User*, 3>;
+    using users_shortlist_t = std::array<QString, 3>;
     template <typename ContT>
-    users_shortlist_t buildShortlist(const ContT& users) const;
-    users_shortlist_t buildShortlist(const QStringList& userIds) const;
+    users_shortlist_t buildShortlist(const ContT& userIds) const;
+
+    // The users whose names have been used in the current displayname
+    users_shortlist_t displaynameShortlist {};
 };
 
 decltype(Room::Private::baseState) Room::Private::stubbedState {};
@@ -502,19 +650,14 @@ Room::Room(Connection* connection, QString id, JoinState initialJoinState)
             }
         });
         d->groupSessions = connection->loadRoomMegolmSessions(this);
+        connect(qApp, &QCoreApplication::aboutToQuit, this,
+                [this] { d->saveOutboundSession(); });
         d->currentOutboundMegolmSession =
             connection->database()->loadCurrentOutboundMegolmSession(id);
         if (d->currentOutboundMegolmSession
             && d->shouldRotateMegolmSession()) {
             d->currentOutboundMegolmSession.reset();
         }
-        connect(this, &Room::userRemoved, this, [this] {
-            if (d->hasValidMegolmSession()) {
-                qCDebug(E2EE)
-                    << "Rotating the megolm session because a user left";
-                d->createMegolmSession();
-            }
-        });
 
         connect(this, &Room::beforeDestruction, this, [id, connection] {
             connection->database()->clearRoomData(id);
@@ -646,6 +789,7 @@ QUrl Room::avatarUrl() const { return d->avatar.url(); }
 
 const Avatar& Room::avatarObject() const { return d->avatar; }
 
+#ifndef Quotient_NO_GUI
 QImage Room::avatar(int dimension) { return avatar(dimension, dimension); }
 
 QImage Room::avatar(int width, int height)
@@ -662,6 +806,7 @@ QImage Room::avatar(int width, int height)
 
     return {};
 }
+#endif
 
 User* Room::user(const QString& userId) const
 {
@@ -670,8 +815,9 @@ User* Room::user(const QString& userId) const
 
 JoinState Room::memberJoinState(User* user) const
 {
-    return d->membersMap.contains(user->name(this), user) ? JoinState::Join
-                                                          : JoinState::Leave;
+    return d->membersMap.contains(user->name(this), user->id())
+               ? JoinState::Join
+               : JoinState::Leave;
 }
 
 Membership Room::memberState(const QString& userId) const
@@ -765,9 +911,16 @@ Omittable<QString> Room::Private::setLastReadReceipt(const QString& userId,
     // receipts arrive. It can be called thousands of times during an initial
     // sync, e.g.
     // TODO: remove in 0.8
-    if (const auto member = q->user(userId); !isLocalUser(member))
-        QT_IGNORE_DEPRECATIONS(emit q->readMarkerForUserMoved(
-            member, prevEventId, storedReceipt.eventId);)
+    // Don't create a user object for every receipt sender unless someone
+    // actually listens to this signal
+    QT_IGNORE_DEPRECATIONS(static const auto markerMovedSignal =
+                               QMetaMethod::fromSignal(
+                                   &Room::readMarkerForUserMoved);)
+    if (userId != connection->userId()
+        && q->isSignalConnected(markerMovedSignal))
+        if (const auto member = q->user(userId))
+            QT_IGNORE_DEPRECATIONS(emit q->readMarkerForUserMoved(
+                member, prevEventId, storedReceipt.eventId);)
     return prevEventId;
 }
 
@@ -1094,27 +1247,95 @@ const RoomTombstoneEvent* Room::tombstone() const
 void Room::Private::getAllMembers()
 {
     // If already loaded or already loading, there's nothing to do here.
-    if (q->joinedCount() <= membersMap.size() || isJobPending(allMembersJob))
+    if (q->joinedCount() <= membersMap.size() || allMembersLoading)
         return;
 
+    allMembersLoading = true;
     allMembersJob = connection->callApi<GetMembersByRoomJob>(
         id, connection->nextBatchToken(), "join"_ls);
+    allMembersJob->setPriority(JobPriority::Background);
     auto nextIndex = timeline.empty() ? 0 : timeline.back().index() + 1;
     connect(allMembersJob, &BaseJob::success, q, [this, nextIndex] {
-        Q_ASSERT(timeline.empty() || nextIndex <= q->maxTimelineIndex() + 1);
-        auto roomChanges = updateStateFrom(allMembersJob->chunk());
-        // Replay member events that arrived after the point for which
-        // the full members list was requested.
-        if (!timeline.empty())
-            for (auto it = q->findInTimeline(nextIndex).base();
-                 it != syncEdge(); ++it)
-                if (is<RoomMemberEvent>(**it))
-                    roomChanges |= q->processStateEvent(**it);
-        postprocessChanges(roomChanges);
-        emit q->allMembersLoaded();
+        auto chunkJson = allMembersJob->jsonData().value("chunk"_ls);
+        if (chunkJson.isUndefined()) {
+            // Streaming parsers have already decoded the list
+            startApplyingAllMembers(allMembersJob->chunk(), nextIndex);
+            return;
+        }
+        // Decoding the list for a room with 100k+ members takes a while;
+        // do it off the main thread and come back to apply it in slices
+        QThreadPool::globalInstance()->start(
+            [chunkJson = std::move(chunkJson), room = QPointer<Room>(q),
+             nextIndex] {
+                auto events = fromJson<StateEvents>(chunkJson);
+                QMetaObject::invokeMethod(
+                    qApp,
+                    [room, nextIndex, events = std::move(events)]() mutable {
+                        if (room)
+                            room->d->startApplyingAllMembers(std::move(events),
+                                                             nextIndex);
+                    },
+                    Qt::QueuedConnection);
+            });
+    });
+    // Covers failures and abandoning alike
+    connect(allMembersJob, &BaseJob::finished, q, [this](BaseJob* job) {
+        if (!job->status().good()) {
+            allMembersLoading = false;
+            membersUpdatedSinceRequest.clear();
+        }
     });
 }
 
+void Room::Private::startApplyingAllMembers(StateEvents&& events,
+                                            TimelineItem::index_t replayFrom)
+{
+    allMembers = std::move(events);
+    allMembersApplied = 0;
+    allMembersReplayFrom = replayFrom;
+    applyAllMembers();
+}
+
+void Room::Private::applyAllMembers()
+{
+    const Tracing::Span span { "room", "applyAllMembers", id };
+    QElapsedTimer et;
+    et.start();
+    bulkMemberUpdate = true;
+    do {
+        if (allMembersApplied == allMembers.size())
+            break;
+        auto& eptr = allMembers[allMembersApplied++];
+        if (!membersUpdatedSinceRequest.contains(eptr->stateKey()))
+            allMembersChanges |= applyStateEvent(std::move(eptr));
+    } while (et.elapsed() < AllMembersSliceBudget.count());
+    bulkMemberUpdate = false;
+    emit q->allMembersLoadProgress(static_cast<qsizetype>(allMembersApplied),
+                                   static_cast<qsizetype>(allMembers.size()));
+
+    if (allMembersApplied < allMembers.size()) {
+        // Let the event loop run before the next slice
+        QMetaObject::invokeMethod(
+            q, [this] { applyAllMembers(); }, Qt::QueuedConnection);
+        return;
+    }
+    allMembers.clear();
+    membersUpdatedSinceRequest.clear();
+    auto roomChanges = std::exchange(allMembersChanges, {});
+    Q_ASSERT(timeline.empty()
+             || allMembersReplayFrom <= q->maxTimelineIndex() + 1);
+    // Replay member events that arrived after the point for which
+    // the full members list was requested.
+    if (!timeline.empty())
+        for (auto it = q->findInTimeline(allMembersReplayFrom).base();
+             it != syncEdge(); ++it)
+            if (is<RoomMemberEvent>(**it))
+                roomChanges |= q->processStateEvent(**it);
+    allMembersLoading = false;
+    postprocessChanges(roomChanges);
+    emit q->allMembersLoaded();
+}
+
 bool Room::displayed() const { return d->displayed; }
 
 void Room::setDisplayed(bool displayed)
@@ -1147,6 +1368,7 @@ void Room::setFirstDisplayedEventId(const QString& eventId)
 
     d->firstDisplayedEventId = eventId;
     emit firstDisplayedEventChanged();
+    d->prefetchHistory();
 }
 
 void Room::setFirstDisplayedEvent(TimelineItem::index_t index)
@@ -1516,9 +1738,17 @@ QString Room::prettyPrint(const QString& plainText) const
 
 QList<User*> Room::usersTyping() const { return d->usersTyping; }
 
-QList<User*> Room::membersLeft() const { return d->membersLeft; }
+QList<User*> Room::membersLeft() const
+{
+    return d->usersFromIds(d->membersLeft);
+}
+
+QList<User*> Room::users() const
+{
+    return d->usersFromIds(d->membersMap.values());
+}
 
-QList<User*> Room::users() const { return d->membersMap.values(); }
+QStringList Room::joinedMemberIds() const { return d->membersMap.values(); }
 
 QStringList Room::memberNames() const
 {
@@ -1529,8 +1759,8 @@ QStringList Room::safeMemberNames() const
 {
     QStringList res;
     res.reserve(d->membersMap.size());
-    for (const auto* u: std::as_const(d->membersMap))
-        res.append(safeMemberName(u->id()));
+    for (const auto& userId : std::as_const(d->membersMap))
+        res.append(safeMemberName(userId));
 
     return res;
 }
@@ -1539,8 +1769,8 @@ QStringList Room::htmlSafeMemberNames() const
 {
     QStringList res;
     res.reserve(d->membersMap.size());
-    for (const auto* u: std::as_const(d->membersMap))
-        res.append(htmlSafeMemberName(u->id()));
+    for (const auto& userId : std::as_const(d->membersMap))
+        res.append(htmlSafeMemberName(userId));
 
     return res;
 }
@@ -1662,56 +1892,65 @@ Room::Changes Room::Private::setSummary(RoomSummary&& newSummary)
     return Change::Summary;
 }
 
-void Room::Private::insertMemberIntoMap(User* u)
+inline QString makeFullUserName(const QString& displayName, const QString& mxId)
+{
+    return displayName % " ("_ls % mxId % u')';
+}
+
+void Room::Private::insertMemberIntoMap(const QString& userId)
 {
     const auto maybeUserName =
-        currentState.query(u->id(), &RoomMemberEvent::newDisplayName);
+        currentState.query(userId, &RoomMemberEvent::newDisplayName);
     if (!maybeUserName)
-        qCDebug(MEMBERS) << "insertMemberIntoMap():" << u->id()
+        qCDebug(MEMBERS) << "insertMemberIntoMap():" << userId
                            << "has no name (even empty)";
     const auto userName = maybeUserName.value_or(QString());
     const auto namesakes = membersMap.values(userName);
-    qCDebug(MEMBERS) << "insertMemberIntoMap(), user" << u->id()
+    qCDebug(MEMBERS) << "insertMemberIntoMap(), user" << userId
                      << "with name" << userName << '-'
                      << namesakes.size() << "namesake(s) found";
 
     // Callers should make sure they are not adding an existing user once more
-    Q_ASSERT(!namesakes.contains(u));
-    if (namesakes.contains(u)) { // Release version whines but continues
-        qCCritical(MEMBERS) << "Trying to add a user" << u->id() << "to room"
+    Q_ASSERT(!namesakes.contains(userId));
+    if (namesakes.contains(userId)) { // Release version whines but continues
+        qCCritical(MEMBERS) << "Trying to add a user" << userId << "to room"
                             << q->objectName() << "but that's already in it";
         return;
     }
 
     // If there is exactly one namesake of the added user, signal member
     // renaming for that other one because the two should be disambiguated now
-    if (namesakes.size() == 1)
-        emit q->memberAboutToRename(namesakes.front(),
-                                    namesakes.front()->fullName(q));
-    membersMap.insert(userName, u);
-    if (namesakes.size() == 1)
-        emit q->memberRenamed(namesakes.front());
+    const auto signalRename = namesakes.size() == 1 && !bulkMemberUpdate;
+    if (signalRename)
+        emitMemberSignal(&Room::memberAboutToRename, namesakes.front(),
+                         userName.isEmpty()
+                             ? namesakes.front()
+                             : makeFullUserName(userName, namesakes.front()));
+    membersMap.insert(userName, userId);
+    if (signalRename)
+        emitMemberSignal(&Room::memberRenamed, namesakes.front());
 }
 
-void Room::Private::removeMemberFromMap(User* u)
+void Room::Private::removeMemberFromMap(const QString& userId)
 {
-    const auto userName = currentState.queryOr(u->id(),
+    const auto userName = currentState.queryOr(userId,
                                                &RoomMemberEvent::newDisplayName,
                                                QString());
 
     qCDebug(MEMBERS) << "removeMemberFromMap(), username" << userName
-                     << "for user" << u->id();
-    User* namesake = nullptr;
+                     << "for user" << userId;
+    QString namesake;
     auto namesakes = membersMap.values(userName);
     // If there was one namesake besides the removed user, signal member
     // renaming for it because it doesn't need to be disambiguated any more.
-    if (namesakes.size() == 2) {
+    if (namesakes.size() == 2 && !bulkMemberUpdate) {
         namesake =
-            namesakes.front() == u ? namesakes.back() : namesakes.front();
-        Q_ASSERT_X(namesake != u, __FUNCTION__, "Room members list is broken");
-        emit q->memberAboutToRename(namesake, userName);
+            namesakes.front() == userId ? namesakes.back() : namesakes.front();
+        Q_ASSERT_X(namesake != userId, __FUNCTION__,
+                   "Room members list is broken");
+        emitMemberSignal(&Room::memberAboutToRename, namesake, userName);
     }
-    if (membersMap.remove(userName, u) == 0) {
+    if (membersMap.remove(userName, userId) == 0) {
         qCDebug(MEMBERS) << "No entries removed; checking the whole list";
         // Unless at the stage of initial filling, this no removed entries
         // is suspicious; double-check that this user is not found in
@@ -1719,7 +1958,7 @@ void Room::Private::removeMemberFromMap(User* u)
         // (for release builds) if there's one. That search is O(n), which
         // may come rather expensive for larger rooms.
         QElapsedTimer et;
-        auto it = std::find(membersMap.cbegin(), membersMap.cend(), u);
+        auto it = std::find(membersMap.cbegin(), membersMap.cend(), userId);
         if (et.nsecsElapsed() > ProfilerMinNsecs / 10)
             qCDebug(MEMBERS) << "...done in" << et;
         if (it != membersMap.cend()) {
@@ -1728,11 +1967,11 @@ void Room::Private::removeMemberFromMap(User* u)
 //                       "Mismatched name in the room members list");
             qCCritical(MEMBERS) << "Mismatched name in the room members list;"
                                    " avoiding the list corruption";
-            membersMap.remove(it.key(), u);
+            membersMap.remove(it.key(), userId);
         }
     }
-    if (namesake)
-        emit q->memberRenamed(namesake);
+    if (!namesake.isEmpty())
+        emitMemberSignal(&Room::memberRenamed, namesake);
 }
 
 inline auto makeErrorStr(const Event& e, QByteArray msg)
@@ -1812,11 +2051,6 @@ QString Room::roomMembername(const QString& userId) const
     return disambiguatedMemberName(userId);
 }
 
-inline QString makeFullUserName(const QString& displayName, const QString& mxId)
-{
-    return displayName % " ("_ls % mxId % u')';
-}
-
 QString Room::disambiguatedMemberName(const QString& mxId) const
 {
     // See the CS spec, section 11.2.2.3
@@ -1930,6 +2164,7 @@ Room::Changes Room::Private::updateStatsFromSyncData(const SyncRoomData& data,
 
 void Room::updateData(SyncRoomData&& data, bool fromCache)
 {
+    const Tracing::Span span { "room", "updateData", id() };
     qCDebug(MAIN) << "--- Updating room" << id() << "/" << objectName();
     bool firstUpdate = d->baseState.empty();
 
@@ -1976,7 +2211,11 @@ void Room::Private::postprocessChanges(Changes changes, bool saveState)
     if ((changes & Change::Members) > 0)
         emit q->memberListChanged();
 
-    if ((changes & (Change::RoomNames | Change::Members | Change::Summary)) > 0)
+    // Member changes mark the displayname dirty themselves, only when they
+    // may affect it (see processStateEvent())
+    if ((changes & (Change::RoomNames | Change::Summary)) > 0)
+        displaynameDirty = true;
+    if (std::exchange(displaynameDirty, false))
         updateDisplayname();
 
     if ((changes & Change::PartiallyReadStats) > 0) {
@@ -2025,88 +2264,298 @@ QString Room::Private::sendEvent(RoomEventPtr&& event)
 
 QString Room::Private::doSendEvent(const RoomEvent* pEvent)
 {
-    const auto txnId = pEvent->transactionId();
-    // TODO, #133: Enqueue the job rather than immediately trigger it.
-    const RoomEvent* _event = pEvent;
-    std::unique_ptr<EncryptedEvent> encryptedEvent;
-
-    if (q->usesEncryption()) {
-        if (!connection->encryptionEnabled()) {
-            qWarning(E2EE) << "Room" << q->objectName()
-                           << "uses encryption but E2EE is switched off for"
-                           << connection->objectName()
-                           << "- the message won't be sent";
-            onEventSendingFailure(txnId);
-            return txnId;
-        }
+    auto txnId = pEvent->transactionId();
+    // A retry of an event that hasn't been sent yet goes to the end
+    std::erase_if(sendQueue,
+                  [&txnId](const OutgoingItem& i) { return i.txnId == txnId; });
+    sendQueue.push_back({ txnId });
+    dispatchSendQueue();
+    return txnId;
+}
+
+void Room::Private::dispatchSendQueue()
+{
 #ifdef Quotient_E2EE_ENABLED
-        if (!hasValidMegolmSession() || shouldRotateMegolmSession()) {
-            createMegolmSession();
-        }
+    bool keyShared = false;
+#endif
+    while (!sendQueue.empty() && requestsInFlight < maxSendsInFlight) {
+        auto item = std::move(sendQueue.front());
+        sendQueue.pop_front();
+#ifdef Quotient_E2EE_ENABLED
+        // Encrypting only now keeps the message indices of the session in
+        // the order of sending, and doesn't waste work on discarded messages
+        if (q->usesEncryption() && connection->encryptionEnabled())
+            encryptForSending(item, keyShared);
+#endif
+        sendQueuedEvent(std::move(item));
+    }
+}
 
-        // Send the session to other people
+#ifdef Quotient_E2EE_ENABLED
+void Room::Private::encryptForSending(OutgoingItem& item, bool& keyShared)
+{
+    const auto it = q->findPendingEvent(item.txnId);
+    if (it == unsyncedEvents.end())
+        return; // Discarded while in the queue
+    if (!hasValidMegolmSession()
+        || shouldRotateMegolmSession(currentState.get<EncryptionEvent>())) {
+        createMegolmSession();
+        keyShared = false;
+    }
+    if (!std::exchange(keyShared, true))
         connection->sendSessionKeyToDevices(id, *currentOutboundMegolmSession,
                                             getDevicesWithoutKey());
 
-        const auto encrypted = currentOutboundMegolmSession->encrypt(
-            QJsonDocument(pEvent->fullJson()).toJson());
-        currentOutboundMegolmSession->setMessageCount(
-            currentOutboundMegolmSession->messageCount() + 1);
-        connection->database()->saveCurrentOutboundMegolmSession(
-            id, *currentOutboundMegolmSession);
-        encryptedEvent = makeEvent<EncryptedEvent>(
-            encrypted, connection->olmAccount()->identityKeys().curve25519,
-            connection->deviceId(), QString::fromLatin1(currentOutboundMegolmSession->sessionId()));
-        encryptedEvent->setTransactionId(connection->generateTxnId());
-        encryptedEvent->setRoomId(id);
-        encryptedEvent->setSender(connection->userId());
-        if (pEvent->contentJson().contains("m.relates_to"_ls)) {
-            encryptedEvent->setRelation(
-                pEvent->contentJson()["m.relates_to"_ls].toObject());
-        }
-        // We show the unencrypted event locally while pending. The echo
-        // check will throw the encrypted version out
-        _event = encryptedEvent.get();
-#endif
+    const auto* pEvent = it->event();
+    scheduleOutboundSessionSave();
+    const auto encrypted = currentOutboundMegolmSession->encrypt(
+        QJsonDocument(pEvent->fullJson()).toJson());
+    currentOutboundMegolmSession->setMessageCount(
+        currentOutboundMegolmSession->messageCount() + 1);
+    auto encryptedEvent = makeEvent<EncryptedEvent>(
+        encrypted, connection->olmAccount()->identityKeys().curve25519,
+        connection->deviceId(),
+        QString::fromLatin1(currentOutboundMegolmSession->sessionId()));
+    encryptedEvent->setTransactionId(connection->generateTxnId());
+    encryptedEvent->setRoomId(id);
+    encryptedEvent->setSender(connection->userId());
+    if (pEvent->contentJson().contains("m.relates_to"_ls)) {
+        encryptedEvent->setRelation(
+            pEvent->contentJson()["m.relates_to"_ls].toObject());
     }
+    // We show the unencrypted event locally while pending. The echo
+    // check will throw the encrypted version out
+    item.payload = std::move(encryptedEvent);
+}
+#endif
 
-    if (auto call =
-            connection->callApi<SendMessageJob>(BackgroundRequest, id,
-                                                _event->matrixType(), txnId,
-                                                _event->contentJson())) {
-        Room::connect(call, &BaseJob::sentRequest, q, [this, txnId] {
-            auto it = q->findPendingEvent(txnId);
-            if (it == unsyncedEvents.end()) {
-                qWarning(EVENTS) << "Pending event for transaction" << txnId
-                                 << "not found - got synced so soon?";
-                return;
-            }
-            it->setDeparted();
-            emit q->pendingEventChanged(int(it - unsyncedEvents.begin()));
+void Room::Private::sendQueuedEvent(OutgoingItem&& item)
+{
+    const auto& txnId = item.txnId;
+    const auto it = q->findPendingEvent(txnId);
+    if (it == unsyncedEvents.end())
+        return; // Discarded while in the queue
+    if (q->usesEncryption() && !item.payload) {
+        qWarning(E2EE) << "Room" << q->objectName()
+                       << "uses encryption but E2EE is switched off for"
+                       << connection->objectName()
+                       << "- the message won't be sent";
+        onEventSendingFailure(txnId);
+        return;
+    }
+    const auto* _event = item.payload ? item.payload.get() : it->event();
+    auto* sendCall = connection->callApi<SendMessageJob>(
+        BackgroundRequest, id, _event->matrixType(), txnId,
+        _event->contentJson());
+    sendCall->setPriority(JobPriority::Urgent);
+    Room::connect(sendCall, &BaseJob::sentRequest, q, [this, txnId] {
+        auto it = q->findPendingEvent(txnId);
+        if (it == unsyncedEvents.end()) {
+            qWarning(EVENTS) << "Pending event for transaction" << txnId
+                             << "not found - got synced so soon?";
+            return;
+        }
+        it->setDeparted();
+        emit q->pendingEventChanged(int(it - unsyncedEvents.begin()));
+    });
+    unacknowledgedSends.push_back({ txnId, {} });
+    Room::connect(sendCall, &BaseJob::result, q, [this, txnId, sendCall] {
+        std::function<void()> acknowledge;
+        if (!sendCall->status().good())
+            acknowledge = [this, txnId,
+                           reason = QString(sendCall->statusCaption() % ": "_ls
+                                            % sendCall->errorString())] {
+                onEventSendingFailure(txnId, reason);
+            };
+        else
+            acknowledge = [this, txnId, eventId = sendCall->eventId()] {
+                auto it = q->findPendingEvent(txnId);
+                if (it != unsyncedEvents.end()) {
+                    if (it->deliveryStatus() != EventStatus::ReachedServer) {
+                        it->setReachedServer(eventId);
+                        emit q->pendingEventChanged(
+                            int(it - unsyncedEvents.begin()));
+                    }
+                } else
+                    qDebug(EVENTS) << "Pending event for transaction"
+                                   << txnId << "already merged";
+
+                emit q->messageSent(txnId, eventId);
+            };
+        const auto it = std::find_if(unacknowledgedSends.begin(),
+                                     unacknowledgedSends.end(),
+                                     [&txnId](const SentMessage& m) {
+                                         return m.txnId == txnId
+                                                && !m.acknowledge;
+                                     });
+        if (it != unacknowledgedSends.end())
+            it->acknowledge = std::move(acknowledge);
+        else
+            acknowledge();
+        acknowledgeSends();
+    });
+    // Abandoned jobs don't emit result(); don't let them hold up the rest
+    Room::connect(sendCall, &BaseJob::finished, q, [this, txnId, sendCall] {
+        if (sendCall->error() != BaseJob::Abandoned)
+            return;
+        std::erase_if(unacknowledgedSends, [&txnId](const SentMessage& m) {
+            return m.txnId == txnId && !m.acknowledge;
         });
-        Room::connect(call, &BaseJob::result, q, [this, txnId, call] {
-            if (!call->status().good()) {
-                onEventSendingFailure(txnId, call);
-                return;
-            }
-            auto it = q->findPendingEvent(txnId);
-            if (it != unsyncedEvents.end()) {
-                if (it->deliveryStatus() != EventStatus::ReachedServer) {
-                    it->setReachedServer(call->eventId());
-                    emit q->pendingEventChanged(int(it - unsyncedEvents.begin()));
-                }
-            } else
-                qDebug(EVENTS) << "Pending event for transaction" << txnId
-                               << "already merged";
+        acknowledgeSends();
+    });
+    ++requestsInFlight;
+    // finished() is emitted on success, failure and abandoning alike
+    Room::connect(sendCall, &BaseJob::finished, q, [this] {
+        --requestsInFlight;
+        dispatchSendQueue();
+    });
+}
 
-            emit q->messageSent(txnId, call->eventId());
-        });
-    } else
-        onEventSendingFailure(txnId);
-    return txnId;
+void Room::Private::acknowledgeSends()
+{
+    while (!unacknowledgedSends.empty()
+           && unacknowledgedSends.front().acknowledge) {
+        // Take it out first: acknowledging may lead to more messages sent
+        const auto acknowledge =
+            std::move(unacknowledgedSends.front().acknowledge);
+        unacknowledgedSends.pop_front();
+        acknowledge();
+    }
+}
+
+int Room::maxSendsInFlight() const { return d->maxSendsInFlight; }
+
+void Room::setMaxSendsInFlight(int n)
+{
+    d->maxSendsInFlight = std::max(n, 1);
+    d->dispatchSendQueue(); // In case the limit has gone up
+}
+
+namespace {
+qint64 keyPairBytes(const std::pair<QString, QString>& key)
+{
+    return MemoryUsage::bytesOf(key.first) + MemoryUsage::bytesOf(key.second);
+}
+} // namespace
+
+MemoryUsage Room::memoryUsage() const
+{
+    static constexpr auto NodeOverhead = MemoryUsage::NodeOverhead;
+    MemoryUsage usage;
+
+    qint64 bytes = 0;
+    for (const auto& ti : d->timeline)
+        bytes += qint64(sizeof(TimelineItem))
+                 + MemoryUsage::bytesOf(*ti.event());
+    usage.add("timeline"_ls, qsizetype(d->timeline.size()), bytes);
+
+    bytes = 0;
+    for (const auto& pe : d->unsyncedEvents)
+        bytes += qint64(sizeof(PendingEventItem))
+                 + MemoryUsage::bytesOf(*pe.event());
+    usage.add("pendingEvents"_ls, qsizetype(d->unsyncedEvents.size()), bytes);
+
+    bytes = 0;
+    for (auto it = d->eventsIndex.cbegin(); it != d->eventsIndex.cend(); ++it)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(it.key())
+                 + qint64(sizeof(TimelineItem::index_t));
+    usage.add("eventsIndex"_ls, d->eventsIndex.size(), bytes);
+
+    bytes = 0;
+    for (auto it = d->relations.cbegin(); it != d->relations.cend(); ++it)
+        bytes += NodeOverhead + keyPairBytes(it.key())
+                 + qint64(sizeof(RelatedEvents))
+                 + qint64(it->capacity()) * qint64(sizeof(void*));
+    usage.add("relations"_ls, d->relations.size(), bytes);
+
+    bytes = 0;
+    for (const auto& [key, evt] : d->baseState)
+        bytes += NodeOverhead + keyPairBytes(key) + MemoryUsage::bytesOf(*evt);
+    usage.add("baseState"_ls, qsizetype(d->baseState.size()), bytes);
+
+    // The current state only points to events stored in the timeline or
+    // the base state, so it only takes memory for the keys
+    const auto& currentState = d->currentState.events();
+    bytes = 0;
+    for (auto it = currentState.cbegin(); it != currentState.cend(); ++it)
+        bytes += NodeOverhead + keyPairBytes(it.key()) + qint64(sizeof(void*));
+    usage.add("currentState"_ls, currentState.size(), bytes);
+
+    bytes = 0;
+    for (auto it = d->membersMap.cbegin(); it != d->membersMap.cend(); ++it)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(it.key())
+                 + MemoryUsage::bytesOf(it.value());
+    usage.add("membersMap"_ls, d->membersMap.size(), bytes);
+
+    bytes = 0;
+    for (auto it = d->notifications.cbegin(); it != d->notifications.cend();
+         ++it)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(it.key())
+                 + qint64(sizeof(Notification));
+    usage.add("notifications"_ls, d->notifications.size(), bytes);
+
+    bytes = 0;
+    for (auto it = d->eventIdReadUsers.cbegin();
+         it != d->eventIdReadUsers.cend(); ++it) {
+        bytes += NodeOverhead + MemoryUsage::bytesOf(it.key());
+        for (const auto& userId : *it)
+            bytes += NodeOverhead + MemoryUsage::bytesOf(userId);
+    }
+    for (auto it = d->lastReadReceipts.cbegin();
+         it != d->lastReadReceipts.cend(); ++it)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(it.key())
+                 + qint64(sizeof(ReadReceipt))
+                 + MemoryUsage::bytesOf(it->eventId);
+    usage.add("receipts"_ls,
+              d->eventIdReadUsers.size() + d->lastReadReceipts.size(), bytes);
+
+    bytes = 0;
+    for (const auto& [type, evt] : d->accountData)
+        bytes += NodeOverhead + MemoryUsage::bytesOf(type)
+                 + MemoryUsage::bytesOf(*evt);
+    usage.add("accountData"_ls, qsizetype(d->accountData.size()), bytes);
+
+    bytes = 0;
+    for (const auto& [sessionId, eventIds] : d->undecryptedEvents) {
+        bytes += NodeOverhead + MemoryUsage::bytesOf(sessionId);
+        for (const auto& eventId : eventIds)
+            bytes += NodeOverhead + MemoryUsage::bytesOf(eventId);
+    }
+    usage.add("undecryptedEvents"_ls, qsizetype(d->undecryptedEvents.size()),
+              bytes);
+
+#ifdef Quotient_E2EE_ENABLED
+    bytes = 0;
+    for (const auto& [sessionId, session] : d->groupSessions)
+        bytes += NodeOverhead + sessionId.capacity()
+                 + qint64(sizeof(QOlmInboundGroupSession))
+                 + qint64(olm_inbound_group_session_size());
+    usage.add("megolmSessions"_ls, qsizetype(d->groupSessions.size()), bytes);
+#endif
+    return usage;
+}
+
+MemoryUsage Room::sharedMemoryUsage()
+{
+    qint64 bytes = 0;
+    for (const auto& [key, evt] : Private::stubbedState)
+        bytes += MemoryUsage::NodeOverhead + keyPairBytes(key)
+                 + MemoryUsage::bytesOf(*evt);
+    MemoryUsage usage;
+    usage.add("stubbedState"_ls, qsizetype(Private::stubbedState.size()),
+              bytes);
+    return usage;
 }
 
 void Room::Private::onEventSendingFailure(const QString& txnId, BaseJob* call)
+{
+    onEventSendingFailure(txnId, call ? call->statusCaption() % ": "_ls
+                                            % call->errorString()
+                                      : tr("The call could not be started"));
+}
+
+void Room::Private::onEventSendingFailure(const QString& txnId,
+                                          const QString& reason)
 {
     auto it = q->findPendingEvent(txnId);
     if (it == unsyncedEvents.end()) {
@@ -2114,8 +2563,7 @@ void Room::Private::onEventSendingFailure(const QString& txnId, BaseJob* call)
                           << "could not be sent";
         return;
     }
-    it->setSendingFailed(call ? call->statusCaption() % ": "_ls % call->errorString()
-                              : tr("The call could not be started"));
+    it->setSendingFailed(reason);
     emit q->pendingEventChanged(int(it - unsyncedEvents.begin()));
 }
 
@@ -2419,11 +2867,11 @@ void Room::Private::getPreviousContent(int limit, const QString& filter)
     if (!prevBatch || isJobPending(eventsHistoryJob))
         return;
 
-    eventsHistoryJob = connection->callApi<GetRoomEventsJob>(id, "b"_ls, *prevBatch,
-                                                             QString(), limit, filter);
+    auto* job = eventsHistoryJob = connection->callApi<GetRoomEventsJob>(
+        id, "b"_ls, *prevBatch, QString(), limit, filter);
     emit q->eventsHistoryJobChanged();
-    connect(eventsHistoryJob, &BaseJob::success, q, [this] {
-        if (const auto newPrevBatch = eventsHistoryJob->end();
+    connect(job, &BaseJob::success, q, [this, job] {
+        if (const auto newPrevBatch = job->end();
             !newPrevBatch.isEmpty() && *prevBatch != newPrevBatch) //
         {
             *prevBatch = newPrevBatch;
@@ -2433,10 +2881,35 @@ void Room::Private::getPreviousContent(int limit, const QString& filter)
             prevBatch.reset();
         }
 
-        addHistoricalMessageEvents(eventsHistoryJob->chunk());
+        auto events = job->chunk();
+        // Pipelining: with the new token at hand, the next batch can be
+        // requested before this one is processed
+        prefetchHistory(std::ssize(events));
+        addHistoricalMessageEvents(std::move(events));
+        prefetchHistory(); // In case the estimate above was too optimistic
     });
-    connect(eventsHistoryJob, &QObject::destroyed, q,
-            &Room::eventsHistoryJobChanged);
+    connect(job, &QObject::destroyed, q, &Room::eventsHistoryJobChanged);
+}
+
+void Room::Private::prefetchHistory(qsizetype incomingEvents)
+{
+    if (historyReadAhead <= 0 || !prevBatch || isJobPending(eventsHistoryJob))
+        return;
+    const auto marker = q->firstDisplayedMarker();
+    if (marker == q->historyEdge())
+        return; // Nothing is displayed yet
+    const auto loadedAhead = q->historyEdge() - marker - 1 + incomingEvents;
+    if (loadedAhead < historyReadAhead)
+        getPreviousContent(
+            std::max(historyReadAhead - static_cast<int>(loadedAhead), 10));
+}
+
+int Room::historyReadAhead() const { return d->historyReadAhead; }
+
+void Room::setHistoryReadAhead(int events)
+{
+    d->historyReadAhead = std::max(events, 0);
+    d->prefetchHistory();
 }
 
 void Room::inviteToRoom(const QString& memberId)
@@ -2631,6 +3104,7 @@ void Room::Private::decryptIncomingEvents(RoomEvents& events)
     if (!q->usesEncryption())
         return; // If the room doesn't use encryption now, it never did
 
+    const Tracing::Span span { "e2ee", "decryptIncomingEvents", id };
     QElapsedTimer et;
     et.start();
     size_t totalDecrypted = 0;
@@ -2877,6 +3351,7 @@ Room::Changes Room::Private::addNewMessageEvents(RoomEvents&& events)
 
     decryptIncomingEvents(events);
 
+    const Tracing::Span span { "room", "addNewMessageEvents", id };
     QElapsedTimer et;
     et.start();
 
@@ -3025,6 +3500,7 @@ void Room::Private::addHistoricalMessageEvents(RoomEvents&& events)
 
     decryptIncomingEvents(events);
 
+    const Tracing::Span span { "room", "addHistoricalMessageEvents", id };
     QElapsedTimer et;
     et.start();
     Changes changes {};
@@ -3065,10 +3541,10 @@ void Room::Private::preprocessStateEvent(const RoomEvent& newEvent,
 {
     newEvent.switchOnType(
         [this, curEvent](const RoomMemberEvent& rme) {
-            auto* u = q->user(rme.userId());
-            if (!u) { // Some terribly malformed user id?
-                qCCritical(MAIN) << "Could not get a user object for"
-                                 << rme.userId();
+            const auto& userId = rme.userId();
+            if (!isValidMemberId(userId)) {
+                qCCritical(MAIN) << "Malformed user id in a member event:"
+                                 << userId;
                 return; // See also Room::Private::processStateEvent()
             }
             switch (const auto prevMembership =
@@ -3077,16 +3553,17 @@ void Room::Private::preprocessStateEvent(const RoomEvent& newEvent,
                             .value_or(Membership::Leave)) {
             case Membership::Invite:
                 if (rme.membership() != prevMembership) {
-                    usersInvited.removeOne(u);
-                    Q_ASSERT(!usersInvited.contains(u));
+                    usersInvited.removeOne(userId);
+                    Q_ASSERT(!usersInvited.contains(userId));
                 }
                 break;
             case Membership::Join:
                 if (rme.membership() == Membership::Join) {
                     // rename/avatar change or no-op
                     if (rme.newDisplayName()) {
-                        emit q->memberAboutToRename(u, *rme.newDisplayName());
-                        removeMemberFromMap(u);
+                        emitMemberSignal(&Room::memberAboutToRename, userId,
+                                         *rme.newDisplayName());
+                        removeMemberFromMap(userId);
                     }
                     if (!rme.newDisplayName() && !rme.newAvatarUrl())
                         qCDebug(MEMBERS).nospace().noquote()
@@ -3097,8 +3574,16 @@ void Room::Private::preprocessStateEvent(const RoomEvent& newEvent,
                         qCWarning(MAIN)
                             << "Membership change from Join to Invite:" << rme;
                     // whatever the new membership, it's no more Join
-                    removeMemberFromMap(u);
-                    emit q->userRemoved(u);
+                    removeMemberFromMap(userId);
+                    emitMemberSignal(&Room::userRemoved, userId);
+#ifdef Quotient_E2EE_ENABLED
+                    if (connection->encryptionEnabled()
+                        && hasValidMegolmSession()) {
+                        qCDebug(E2EE) << "Rotating the megolm session because"
+                                         " a user left";
+                        createMegolmSession();
+                    }
+#endif
                 }
                 break;
             case Membership::Ban:
@@ -3106,8 +3591,8 @@ void Room::Private::preprocessStateEvent(const RoomEvent& newEvent,
             case Membership::Leave:
                 if (rme.membership() == Membership::Invite
                     || rme.membership() == Membership::Join) {
-                    membersLeft.removeOne(u);
-                    Q_ASSERT(!membersLeft.contains(u));
+                    membersLeft.removeOne(userId);
+                    Q_ASSERT(!membersLeft.contains(userId));
                 }
                 break;
             case Membership::Undefined:
@@ -3194,40 +3679,55 @@ Room::Change Room::Private::processStateEvent(const RoomEvent& curEvent,
         },
         [this, oldEvent](const RoomMemberEvent& evt) {
             // See also Room::P::preprocessStateEvent()
-            if (auto* u = q->user(evt.userId())) {
+            if (const auto& userId = evt.userId(); isValidMemberId(userId)) {
+                const auto* oldMemberEvent =
+                    static_cast<const RoomMemberEvent*>(oldEvent);
                 const auto prevMembership =
-                    lift(&RoomMemberEvent::membership,
-                         static_cast<const RoomMemberEvent*>(oldEvent))
+                    lift(&RoomMemberEvent::membership, oldMemberEvent)
                         .value_or(Membership::Leave);
+                if (!displaynameDirty) {
+                    const auto prevName =
+                        oldMemberEvent
+                            ? oldMemberEvent->newDisplayName().value_or(
+                                QString())
+                            : QString();
+                    // Check before the maps are updated below, then again
+                    // after that, to catch both the old and the new state
+                    displaynameDirty =
+                        memberAffectsDisplayname(userId, prevName);
+                }
                 switch (evt.membership()) {
                 case Membership::Join:
                     if (prevMembership != Membership::Join) {
-                        insertMemberIntoMap(u);
-                        emit q->userAdded(u);
+                        insertMemberIntoMap(userId);
+                        emitMemberSignal(&Room::userAdded, userId);
                     } else {
                         if (evt.newDisplayName()) {
-                            insertMemberIntoMap(u);
-                            emit q->memberRenamed(u);
+                            insertMemberIntoMap(userId);
+                            emitMemberSignal(&Room::memberRenamed, userId);
                         }
                         if (evt.newAvatarUrl())
-                            emit q->memberAvatarChanged(u);
+                            emitMemberSignal(&Room::memberAvatarChanged,
+                                             userId);
                     }
                     break;
                 case Membership::Invite:
-                    if (!usersInvited.contains(u))
-                        usersInvited.push_back(u);
-                    if (u == q->localUser() && evt.isDirect())
+                    if (!usersInvited.contains(userId))
+                        usersInvited.push_back(userId);
+                    if (isLocalUser(userId) && evt.isDirect())
                         connection->addToDirectChats(q, q->user(evt.senderId()));
                     break;
                 case Membership::Knock:
                 case Membership::Ban:
                 case Membership::Leave:
-                    if (!membersLeft.contains(u))
-                        membersLeft.append(u);
+                    if (!membersLeft.contains(userId))
+                        membersLeft.append(userId);
                     break;
                 case Membership::Undefined:
                     qCWarning(MEMBERS) << "Ignored undefined membership type";
                 }
+                if (!displaynameDirty)
+                    displaynameDirty = memberAffectsDisplayname(userId, {});
             }
             return Change::Members;
         },
@@ -3355,35 +3855,52 @@ Room::Changes Room::processAccountDataEvent(EventPtr&& event)
 
 template <typename ContT>
 Room::Private::users_shortlist_t
-Room::Private::buildShortlist(const ContT& users) const
+Room::Private::buildShortlist(const ContT& userIds) const
 {
     // To calculate room display name the spec requires to sort users
     // lexicographically by state_key (user id) and use disambiguated
     // display names of two topmost users excluding the current one to render
     // the name of the room. The below code selects 3 topmost users,
     // slightly extending the spec.
-    users_shortlist_t shortlist {}; // Prefill with nullptrs
+    users_shortlist_t shortlist {}; // Prefill with empty ids
     std::partial_sort_copy(
-        users.begin(), users.end(), shortlist.begin(), shortlist.end(),
-        [this](const User* u1, const User* u2) {
+        userIds.begin(), userIds.end(), shortlist.begin(), shortlist.end(),
+        [this](const QString& u1, const QString& u2) {
             // localUser(), if it's in the list, is sorted
             // below all others
-            return isLocalUser(u2) || (!isLocalUser(u1) && u1->id() < u2->id());
+            return isLocalUser(u2) || (!isLocalUser(u1) && u1 < u2);
         });
     return shortlist;
 }
 
-Room::Private::users_shortlist_t
-Room::Private::buildShortlist(const QStringList& userIds) const
+bool Room::Private::memberAffectsDisplayname(const QString& userId,
+                                             const QString& prevName) const
 {
-    QList<User*> users;
-    users.reserve(userIds.size());
-    for (const auto& h : userIds)
-        users.push_back(q->user(h));
-    return buildShortlist(users);
+    // Rooms with a name or a canonical alias don't depend on members at all
+    if (!q->name().isEmpty() || !q->canonicalAlias().isEmpty())
+        return false;
+    // Without heroes, the name is made from the member lists and includes
+    // the number of members, so any change may affect it; same for (nearly)
+    // empty rooms, the name of which depends on the invited and left users
+    if (!summary.heroes || summary.heroes->empty() || membersMap.size() <= 2)
+        return true;
+    // With heroes, the number of members comes with the summary; so it only
+    // matters whether the user is one of the heroes or has the same name as
+    // one of them (which affects disambiguation of the hero's name)
+    if (summary.heroes->contains(userId))
+        return true;
+    const auto newName = q->memberName(userId);
+    return std::any_of(displaynameShortlist.cbegin(),
+                       displaynameShortlist.cend(),
+                       [this, &newName, &prevName](const QString& heroId) {
+                           if (heroId.isEmpty())
+                               return false;
+                           const auto heroName = q->memberName(heroId);
+                           return heroName == newName || heroName == prevName;
+                       });
 }
 
-QString Room::Private::calculateDisplayname() const
+QString Room::Private::calculateDisplayname()
 {
     // CS spec, section 13.2.2.5 Calculating the display name for a room
     // Numbers below refer to respective parts in the spec.
@@ -3423,18 +3940,25 @@ QString Room::Private::calculateDisplayname() const
     // When the heroes list is there, we can rely on it. If the heroes list is
     // missing, the below code gathers invited, or, if there are no invitees,
     // left members.
-    if (!shortlist.front() && localUserIsIn)
+    if (shortlist.front().isEmpty() && localUserIsIn)
         shortlist = buildShortlist(usersInvited);
 
-    if (!shortlist.front())
+    if (shortlist.front().isEmpty())
         shortlist = buildShortlist(membersLeft);
+    displaynameShortlist = shortlist;
 
     QStringList names;
-    for (const auto* u : shortlist) {
-        if (u == nullptr || isLocalUser(u))
+    for (const auto& userId : shortlist) {
+        if (userId.isEmpty() || isLocalUser(userId))
             break;
-        // Only disambiguate if the room is not empty
-        names.push_back(u->displayname(emptyRoom ? nullptr : q));
+        // Only disambiguate if the room is not empty; otherwise the names
+        // come from the user profiles
+        if (!emptyRoom)
+            names.push_back(q->safeMemberName(userId));
+        else if (const auto* u = q->user(userId))
+            names.push_back(u->displayname());
+        else
+            names.push_back(userId);
     }
 
     const auto usersCountExceptLocal =
@@ -12,6 +12,7 @@
 #include "connection.h"
 #include "roomstateview.h"
 #include "eventitem.h"
+#include "memoryusage.h"
 #include "quotient_common.h"
 
 #include "csapi/message_pagination.h"
@@ -25,7 +26,9 @@
 #include "events/eventrelation.h"
 
 #include <QtCore/QJsonObject>
-#include <QtGui/QImage>
+#ifndef Quotient_NO_GUI
+#    include <QtGui/QImage>
+#endif
 
 #include <deque>
 #include <memory>
@@ -272,9 +275,20 @@ public:
     const Avatar& avatarObject() const;
     Q_INVOKABLE JoinState joinState() const;
     Q_INVOKABLE QList<Quotient::User*> usersTyping() const;
+    //! \brief Get the users who have left the room
+    //!
+    //! \note The room tracks members by their ids; this creates user objects
+    //!       for those that don't have one yet.
     QList<User*> membersLeft() const;
 
+    //! \brief Get the users who are joined to the room
+    //!
+    //! \note The room tracks members by their ids; this creates user objects
+    //!       for those that don't have one yet, which is costly in large
+    //!       rooms. Use joinedMemberIds() where ids are enough.
     Q_INVOKABLE QList<Quotient::User*> users() const;
+    //! Get the ids of the users who are joined to the room
+    Q_INVOKABLE QStringList joinedMemberIds() const;
     Q_DECL_DEPRECATED_X("Use safeMemberNames() or htmlSafeMemberNames() instead") //
     QStringList memberNames() const;
     QStringList safeMemberNames() const;
@@ -291,6 +305,7 @@ public:
 
     GetRoomEventsJob* eventsHistoryJob() const;
 
+#ifndef Quotient_NO_GUI
     /**
      * Returns a square room avatar with the given size and requests it
      * from the network if needed
@@ -305,6 +320,7 @@ public:
      * available yet
      */
     Q_INVOKABLE QImage avatar(int width, int height);
+#endif
 
     /**
      * \brief Get a user object for a given user id
@@ -402,6 +418,29 @@ public:
     PendingEvents::iterator findPendingEvent(const QString& txnId);
     PendingEvents::const_iterator findPendingEvent(const QString& txnId) const;
 
+    //! \brief The maximum number of message send requests the room runs at
+    //!        a time
+    //!
+    //! Messages are sent in the order they were posted, one at a time by
+    //! default, so that the server receives them in that order too. Raising
+    //! this limit lets the room send several messages without waiting for
+    //! each to complete; server responses are still applied (and
+    //! messageSent() is emitted) in the posting order, but the server may
+    //! receive - and order - the messages differently. State events are not
+    //! queued: setState() starts its request right away.
+    int maxSendsInFlight() const;
+    void setMaxSendsInFlight(int n);
+
+    //! \brief Approximate memory used by the room's data
+    //!
+    //! Covers the timeline and pending events, the indices built on them,
+    //! the room state, members, notifications, receipts, account data and,
+    //! with E2EE, megolm sessions.
+    //! \sa MemoryUsage, sharedMemoryUsage, Connection::memoryUsageMetrics
+    MemoryUsage memoryUsage() const;
+    //! Approximate memory used by the data shared among all rooms
+    static MemoryUsage sharedMemoryUsage();
+
     const RelatedEvents relatedEvents(const QString& evtId,
                                       EventRelation::reltypeid_t relType) const;
     const RelatedEvents relatedEvents(const RoomEvent& evt,
@@ -423,6 +462,15 @@ public:
     rev_iter_t firstDisplayedMarker() const;
     void setFirstDisplayedEventId(const QString& eventId);
     void setFirstDisplayedEvent(TimelineItem::index_t index);
+
+    //! \brief Number of events to keep loaded beyond the first displayed one
+    //!
+    //! When positive, the room requests older history on its own as soon as
+    //! fewer than this many events are loaded before firstDisplayedEventId(),
+    //! and requests the next batch as soon as the previous one arrives, before
+    //! processing it. 0 (the default) switches prefetching off.
+    int historyReadAhead() const;
+    void setHistoryReadAhead(int events);
     QString lastDisplayedEventId() const;
     rev_iter_t lastDisplayedMarker() const;
     void setLastDisplayedEventId(const QString& eventId);
@@ -966,7 +1014,16 @@ Q_SIGNALS:
      * instead.
      */
     void memberListChanged();
-    /// The previously lazy-loaded members list is now loaded entirely
+    /// \brief Progress of applying the full members list
+    ///
+    /// Large member lists are applied in several steps, letting the event
+    /// loop run in between; this is emitted after each step.
+    void allMembersLoadProgress(qsizetype applied, qsizetype total);
+    /// \brief The previously lazy-loaded members list is now loaded entirely
+    ///
+    /// Changes in disambiguation of member names caused by loading the list
+    /// are not signalled individually; update the member list as a whole
+    /// upon this signal.
     /// \sa setDisplayed
     void allMembersLoaded();
     void encryption();
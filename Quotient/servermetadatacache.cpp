@@ -0,0 +1,216 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "servermetadatacache.h"
+
+#include "converters.h"
+#include "logging.h"
+#include "util.h"
+
+#include "jobs/basejob.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStringBuilder>
+#include <QtCore/QThreadPool>
+
+#include <array>
+
+using namespace Quotient;
+using namespace std::chrono;
+
+namespace {
+
+constexpr std::array KindNames { "well_known", "login_flows", "capabilities" };
+
+class {
+public:
+    std::optional<ServerMetadataCache::Entry> get(const QString& key)
+    {
+        const QMutexLocker _(&mutex);
+        load();
+        const auto entryJson = entries.value(key).toObject();
+        if (entryJson.isEmpty())
+            return std::nullopt;
+        return ServerMetadataCache::Entry {
+            entryJson.value("data"_ls).toObject(),
+            fromJson<QDateTime>(entryJson.value("fetched"_ls)),
+            fromJson<QDateTime>(entryJson.value("expires"_ls))
+        };
+    }
+
+    void put(const QString& key, const QJsonObject& data, seconds maxAge)
+    {
+        const QMutexLocker _(&mutex);
+        load();
+        const auto now = QDateTime::currentDateTimeUtc();
+        entries.insert(key,
+                       QJsonObject {
+                           { "data"_ls, data },
+                           { "fetched"_ls, toJson(now) },
+                           { "expires"_ls, toJson(now.addSecs(maxAge.count())) } });
+        save();
+    }
+
+    void remove(const QString& key)
+    {
+        const QMutexLocker _(&mutex);
+        load();
+        if (entries.contains(key)) {
+            entries.remove(key);
+            save();
+        }
+    }
+
+    void clear()
+    {
+        const QMutexLocker _(&mutex);
+        entries = {};
+        loaded = true;
+        save();
+    }
+
+    seconds timeToLive(ServerMetadataCache::Kind kind)
+    {
+        const QMutexLocker _(&mutex);
+        return timesToLive[kind];
+    }
+
+    void setTimeToLive(ServerMetadataCache::Kind kind, seconds ttl)
+    {
+        const QMutexLocker _(&mutex);
+        timesToLive[kind] = ttl;
+    }
+
+    BaseJob* pendingRequest(const QString& key)
+    {
+        const QMutexLocker _(&mutex);
+        const auto it = pendingRequests.find(key);
+        if (it == pendingRequests.end())
+            return nullptr;
+        if (!isJobPending(*it)) {
+            pendingRequests.erase(it);
+            return nullptr;
+        }
+        return *it;
+    }
+
+    void setPendingRequest(const QString& key, BaseJob* job)
+    {
+        const QMutexLocker _(&mutex);
+        pendingRequests.insert(key, job);
+    }
+
+private:
+    QMutex mutex;
+    QJsonObject entries;
+    bool loaded = false;
+    std::array<seconds, KindNames.size()> timesToLive { 24h, 24h, 24h };
+    QHash<QString, QPointer<BaseJob>> pendingRequests;
+    bool savePending = false;
+    //! Declared last so that it waits for the writes before other members go
+    QThreadPool writer;
+
+    static QString fileName()
+    {
+        return cacheLocation("servers"_ls) % "metadata.json"_ls;
+    }
+
+    void load()
+    {
+        if (std::exchange(loaded, true))
+            return;
+        QFile f { fileName() };
+        if (f.open(QFile::ReadOnly))
+            entries = QJsonDocument::fromJson(f.readAll()).object();
+    }
+
+    //! \brief Schedule writing the entries to the file
+    //!
+    //! Must be called with the mutex locked. Changes made before the write
+    //! starts are coalesced into it; a single writer thread keeps the writes
+    //! in order.
+    void save()
+    {
+        if (std::exchange(savePending, true))
+            return;
+        writer.setMaxThreadCount(1);
+        writer.start([this] {
+            QJsonObject snapshot;
+            {
+                const QMutexLocker _(&mutex);
+                savePending = false;
+                snapshot = entries;
+            }
+            QSaveFile f { fileName() };
+            if (!f.open(QFile::WriteOnly)
+                || f.write(QJsonDocument(snapshot).toJson(QJsonDocument::Compact))
+                       < 0
+                || !f.commit())
+                qCWarning(MAIN) << "Couldn't save the server metadata cache:"
+                                << f.errorString();
+        });
+    }
+} cache;
+
+QString cacheKey(ServerMetadataCache::Kind kind, const QString& server)
+{
+    return QLatin1String(KindNames[kind]) % u'|' % server;
+}
+
+} // namespace
+
+std::optional<ServerMetadataCache::Entry> ServerMetadataCache::get(
+    Kind kind, const QString& server)
+{
+    return cache.get(cacheKey(kind, server));
+}
+
+void ServerMetadataCache::put(Kind kind, const QString& server,
+                              const QJsonObject& data,
+                              std::optional<seconds> maxAge)
+{
+    const auto ttl = timeToLive(kind);
+    cache.put(cacheKey(kind, server), data,
+              maxAge ? std::min(*maxAge, ttl) : ttl);
+}
+
+void ServerMetadataCache::put(Kind kind, const QString& server,
+                              const QJsonObject& data, const BaseJob& job)
+{
+    if (job.responseAllowsStoring())
+        put(kind, server, data, job.responseMaxAge());
+    else
+        remove(kind, server);
+}
+
+void ServerMetadataCache::remove(Kind kind, const QString& server)
+{
+    cache.remove(cacheKey(kind, server));
+}
+
+void ServerMetadataCache::clear() { cache.clear(); }
+
+seconds ServerMetadataCache::timeToLive(Kind kind)
+{
+    return cache.timeToLive(kind);
+}
+
+void ServerMetadataCache::setTimeToLive(Kind kind, seconds ttl)
+{
+    cache.setTimeToLive(kind, ttl);
+}
+
+BaseJob* ServerMetadataCache::pendingRequest(Kind kind, const QString& server)
+{
+    return cache.pendingRequest(cacheKey(kind, server));
+}
+
+void ServerMetadataCache::setPendingRequest(Kind kind, const QString& server,
+                                            BaseJob* job)
+{
+    cache.setPendingRequest(cacheKey(kind, server), job);
+}
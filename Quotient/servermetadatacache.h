@@ -0,0 +1,86 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#pragma once
+
+#include "quotient_export.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonObject>
+
+#include <chrono>
+#include <optional>
+
+namespace Quotient {
+
+class BaseJob;
+
+//! \brief A persistent cache of rarely changing homeserver metadata
+//!
+//! The results of server discovery (.well-known), the login flows and
+//! the capabilities of homeservers are stored on disk along with the time
+//! they stay fresh for, and shared by all connections in the application.
+//! Connection uses fresh entries instead of making requests; stale entries
+//! are still used for login flows and capabilities while they are
+//! revalidated in the background.
+//!
+//! How long an entry stays fresh is determined by the `Cache-Control` or
+//! `Expires` headers of the response but never exceeds the time to live
+//! configured for its kind; the time to live is also used for responses that
+//! have neither header. Entries from responses marked `no-cache` or
+//! `max-age=0` are stale right away but still stored, to be used while they
+//! are revalidated; responses marked `no-store` are not stored at all.
+class QUOTIENT_API ServerMetadataCache {
+public:
+    enum Kind { WellKnown, LoginFlows, Capabilities };
+
+    struct Entry {
+        QJsonObject data;
+        QDateTime fetched;
+        QDateTime expires;
+
+        bool isFresh() const
+        {
+            return QDateTime::currentDateTimeUtc() < expires;
+        }
+    };
+
+    //! \brief Get the cached entry of \p kind for \p server
+    //!
+    //! \p server is the server name from a user id for WellKnown entries and
+    //! the homeserver base URL for others.
+    static std::optional<Entry> get(Kind kind, const QString& server);
+
+    //! \brief Store an entry, replacing the previous one if there was any
+    //! \param maxAge the time the entry stays fresh for, as given by
+    //!               BaseJob::responseMaxAge(), capped by the time to live
+    //!               configured for \p kind; the time to live itself is used
+    //!               if there's no \p maxAge
+    static void put(Kind kind, const QString& server, const QJsonObject& data,
+                    std::optional<std::chrono::seconds> maxAge = {});
+    //! \brief Store an entry from the response to \p job
+    //!
+    //! This takes the freshness of the entry from the response headers. If
+    //! the response is marked `no-store`, the entry is removed instead.
+    static void put(Kind kind, const QString& server, const QJsonObject& data,
+                    const BaseJob& job);
+
+    static void remove(Kind kind, const QString& server);
+    static void clear();
+
+    //! The longest time an entry of \p kind stays fresh; one day by default
+    static std::chrono::seconds timeToLive(Kind kind);
+    static void setTimeToLive(Kind kind, std::chrono::seconds ttl);
+
+    //! \brief Get the pending request for the entry of \p kind for \p server
+    //!
+    //! Connections to the same homeserver share their requests for its
+    //! metadata: the one sending a request registers it with
+    //! setPendingRequest(), others wait for its result instead of sending
+    //! their own. Returns nullptr if there's no such request or it's over.
+    static BaseJob* pendingRequest(Kind kind, const QString& server);
+    static void setPendingRequest(Kind kind, const QString& server,
+                                  BaseJob* job);
+};
+
+} // namespace Quotient
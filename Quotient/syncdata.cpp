@@ -3,7 +3,9 @@
 
 #include "syncdata.h"
 
+#include "jsonreader.h"
 #include "logging.h"
+#include "tracing.h"
 
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
@@ -77,8 +79,8 @@ SyncRoomData::SyncRoomData(QString roomId_, JoinState joinState,
         [[fallthrough]];
     case JoinState::Leave: {
         accountData = load<Events>(roomJson, "account_data"_ls);
-        timeline = load<RoomEvents>(roomJson, "timeline"_ls);
         const auto timelineJson = roomJson.value("timeline"_ls).toObject();
+        timeline = fromJson<RoomEvents>(timelineJson.value("events"_ls));
         timelineLimited = timelineJson.value("limited"_ls).toBool();
         timelinePrevBatch = timelineJson.value("prev_batch"_ls).toString();
 
@@ -190,6 +192,7 @@ QJsonObject SyncData::loadJson(const QString& fileName)
 
 void SyncData::parseJson(const QJsonObject& json, const QString& baseDir)
 {
+    const Tracing::Span span { "sync", "parseSync" };
     QElapsedTimer et;
     et.start();
 
@@ -241,3 +244,28 @@ void SyncData::parseJson(const QJsonObject& json, const QString& baseDir)
                           << totalRooms << "room(s)," << totalEvents
                           << "event(s) in" << et;
 }
+
+void SyncData::parseRooms(JsonReader& reader)
+{
+    const Tracing::Span span { "sync", "parseRooms" };
+    if (!reader.enterObject())
+        return;
+    while (reader.nextKey()) {
+        const auto it = std::find(JoinStateStrings.cbegin(),
+                                  JoinStateStrings.cend(),
+                                  QLatin1String(reader.key()));
+        if (it == JoinStateStrings.cend()) {
+            reader.skipValue();
+            continue;
+        }
+        // Same as in parseJson(), MemberState values go over powers of 2
+        const auto joinState =
+            JoinState(1U << (it - JoinStateStrings.cbegin()));
+        if (reader.enterObject())
+            while (reader.nextKey()) {
+                auto roomId = QString::fromUtf8(reader.key());
+                roomData.emplace_back(std::move(roomId), joinState,
+                                      reader.readValue().toObject());
+            }
+    }
+}
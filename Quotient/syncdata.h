@@ -8,6 +8,7 @@
 #include "events/stateevent.h"
 
 namespace Quotient {
+class JsonReader;
 
 constexpr inline auto UnreadNotificationsKey = "unread_notifications"_ls;
 constexpr inline auto PartiallyReadCountKey = "x-quotient.since_fully_read_count"_ls;
@@ -91,6 +92,11 @@ public:
     //! Parse sync response into room events
     //! \param json response from /sync or a room state cache
     void parseJson(const QJsonObject& json, const QString& baseDir = {});
+    //! \brief Read the `rooms` object of a sync response from raw JSON
+    //!
+    //! Unlike parseJson(), this never holds the JSON tree for more than one
+    //! room at a time. The rooms are added to those already loaded.
+    void parseRooms(JsonReader& reader);
 
     Events takePresenceData();
     Events takeAccountData();
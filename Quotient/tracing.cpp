@@ -0,0 +1,201 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "tracing.h"
+
+#include "logging.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include <atomic>
+
+using namespace Quotient;
+
+namespace {
+
+std::atomic_bool enabled = false;
+
+// Events are accumulated in memory and written out in large chunks so that
+// recording doesn't add file I/O to the spans being measured
+constexpr qsizetype FlushThreshold = 4 * 1024 * 1024;
+
+class {
+public:
+    bool open(const QString& fileName)
+    {
+        const QMutexLocker _(&mutex);
+        file.setFileName(fileName);
+        if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+            qCWarning(PROFILER) << "Couldn't open" << fileName
+                                << "for writing trace events:"
+                                << file.errorString();
+            return false;
+        }
+        clock.start();
+        buffer = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        firstEvent = true;
+        ++generation;
+        return true;
+    }
+
+    void close()
+    {
+        const QMutexLocker _(&mutex);
+        if (!file.isOpen())
+            return;
+        buffer += "\n]}\n";
+        file.write(buffer);
+        buffer.clear();
+        file.close();
+    }
+
+    double timestamp() const { return double(clock.nsecsElapsed()) / 1000; }
+    qint64 nsecsElapsed() const { return clock.nsecsElapsed(); }
+
+    void record(QJsonObject event)
+    {
+        static thread_local int threadId = 0;
+        static thread_local int threadGeneration = 0;
+        event.insert("pid"_ls, QCoreApplication::applicationPid());
+        const QMutexLocker _(&mutex);
+        if (!file.isOpen())
+            return;
+        if (threadGeneration != generation) {
+            // First event from this thread in this trace: name the thread
+            threadGeneration = generation;
+            threadId = ++lastThreadId;
+            auto threadName = QThread::currentThread()->objectName();
+            if (threadName.isEmpty())
+                threadName = qApp && QThread::currentThread() == qApp->thread()
+                                 ? QStringLiteral("Main thread")
+                                 : QStringLiteral("Thread %1").arg(threadId);
+            append({ { "ph"_ls, "M"_ls },
+                     { "name"_ls, "thread_name"_ls },
+                     { "pid"_ls, QCoreApplication::applicationPid() },
+                     { "tid"_ls, threadId },
+                     { "args"_ls,
+                       QJsonObject { { "name"_ls, threadName } } } });
+        }
+        event.insert("tid"_ls, threadId);
+        append(event);
+        if (buffer.size() >= FlushThreshold) {
+            file.write(buffer);
+            buffer.clear();
+        }
+    }
+
+private:
+    QMutex mutex;
+    QFile file;
+    QElapsedTimer clock;
+    QByteArray buffer;
+    bool firstEvent = true;
+    int generation = 0;
+    int lastThreadId = 0;
+
+    void append(const QJsonObject& event)
+    {
+        if (!std::exchange(firstEvent, false))
+            buffer += ",\n";
+        buffer += QJsonDocument(event).toJson(QJsonDocument::Compact);
+    }
+} trace;
+
+QJsonObject makeEvent(const char* phase, const char* category,
+                      const char* name, double timestamp)
+{
+    return { { "ph"_ls, QLatin1String(phase) },
+             { "cat"_ls, QLatin1String(category) },
+             { "name"_ls, QLatin1String(name) },
+             { "ts"_ls, timestamp } };
+}
+
+QString idString(const void* id)
+{
+    return QStringLiteral("0x%1").arg(reinterpret_cast<quintptr>(id), 0, 16);
+}
+
+void startFromEnvironment()
+{
+    const auto fileName = qEnvironmentVariable("QUOTIENT_TRACE_FILE");
+    if (!fileName.isEmpty() && Tracing::start(fileName))
+        qAddPostRoutine(&Tracing::stop);
+}
+
+} // namespace
+
+Q_COREAPP_STARTUP_FUNCTION(startFromEnvironment)
+
+bool Tracing::start(const QString& fileName)
+{
+    stop();
+    if (!trace.open(fileName))
+        return false;
+    enabled = true;
+    qCInfo(PROFILER) << "Recording trace events to" << fileName;
+    return true;
+}
+
+void Tracing::stop()
+{
+    enabled = false;
+    trace.close();
+}
+
+bool Tracing::isEnabled() { return enabled; }
+
+void Tracing::counter(const char* name, qint64 value)
+{
+    if (!enabled)
+        return;
+    auto event = makeEvent("C", "counter", name, trace.timestamp());
+    event.insert("args"_ls, QJsonObject { { "value"_ls, value } });
+    trace.record(std::move(event));
+}
+
+void Tracing::asyncBegin(const char* category, const char* name,
+                         const void* id, const QString& tag)
+{
+    if (!enabled)
+        return;
+    auto event = makeEvent("b", category, name, trace.timestamp());
+    event.insert("id"_ls, idString(id));
+    if (!tag.isEmpty())
+        event.insert("args"_ls, QJsonObject { { "tag"_ls, tag } });
+    trace.record(std::move(event));
+}
+
+void Tracing::asyncEnd(const char* category, const char* name, const void* id)
+{
+    if (!enabled)
+        return;
+    auto event = makeEvent("e", category, name, trace.timestamp());
+    event.insert("id"_ls, idString(id));
+    trace.record(std::move(event));
+}
+
+Tracing::Span::Span(const char* category, const char* name, const QString& tag)
+    : category(category), name(name)
+{
+    if (!enabled)
+        return;
+    this->tag = tag;
+    startNsecs = trace.nsecsElapsed();
+}
+
+Tracing::Span::~Span()
+{
+    if (startNsecs < 0 || !enabled)
+        return;
+    auto event = makeEvent("X", category, name, double(startNsecs) / 1000);
+    event.insert("dur"_ls, double(trace.nsecsElapsed() - startNsecs) / 1000);
+    if (!tag.isEmpty())
+        event.insert("args"_ls, QJsonObject { { "tag"_ls, tag } });
+    trace.record(std::move(event));
+}
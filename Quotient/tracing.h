@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#pragma once
+
+#include "quotient_export.h"
+
+#include <QtCore/QString>
+
+//! \brief Recording of trace events for performance analysis
+//!
+//! Trace events are written in the Chrome trace-event format, which can be
+//! opened with Perfetto (https://ui.perfetto.dev) or chrome://tracing.
+//! Recording is off by default; it can be turned on either with start() or
+//! by setting the QUOTIENT_TRACE_FILE environment variable to the name of
+//! the trace file before the application starts, in which case the file is
+//! finished when the application quits.
+//!
+//! When recording is off, each of the functions below and creating a Span
+//! amount to a check of a single flag.
+namespace Quotient::Tracing {
+
+//! \brief Start recording trace events to \p fileName
+//!
+//! If recording is already on, the previous trace file is finished first.
+//! \return false if the file could not be opened for writing
+QUOTIENT_API bool start(const QString& fileName);
+
+//! Stop recording and finish the trace file
+QUOTIENT_API void stop();
+
+QUOTIENT_API bool isEnabled();
+
+//! Record the current value of a counter, shown as a graph in the trace
+QUOTIENT_API void counter(const char* name, qint64 value);
+
+//! \brief Mark the beginning of an operation spanning event loop iterations
+//!
+//! Use this for things like network requests that start in one function
+//! and end in another. \p id must be unique among the operations of the same
+//! \p category in flight.
+QUOTIENT_API void asyncBegin(const char* category, const char* name,
+                             const void* id, const QString& tag = {});
+//! Mark the end of an operation started with asyncBegin()
+QUOTIENT_API void asyncEnd(const char* category, const char* name,
+                           const void* id);
+
+//! \brief A span of work on the current thread, from construction to
+//!        destruction
+//!
+//! Spans nest the way their scopes do. The tag (usually the id of a room,
+//! or the name of a job) is shown with the span in the trace.
+class QUOTIENT_API Span {
+public:
+    Span(const char* category, const char* name, const QString& tag = {});
+    ~Span();
+    Q_DISABLE_COPY_MOVE(Span)
+
+private:
+    const char* category;
+    const char* name;
+    QString tag;
+    qint64 startNsecs = -1;
+};
+
+} // namespace Quotient::Tracing
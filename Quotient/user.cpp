@@ -191,6 +191,7 @@ const Avatar& User::avatarObject(const Room* room) const
     return d->otherAvatars.try_emplace(mediaId, url).first->second;
 }
 
+#ifndef Quotient_NO_GUI
 QImage User::avatar(int dimension, const Room* room) const
 {
     return avatar(dimension, dimension, room);
@@ -206,6 +207,7 @@ QImage User::avatar(int width, int height, const Room* room,
 {
     return avatarObject(room).get(connection(), width, height, callback);
 }
+#endif
 
 QString User::avatarMediaId(const Room* room) const
 {
@@ -217,4 +219,17 @@ QUrl User::avatarUrl(const Room* room) const
     return avatarObject(room).url();
 }
 
+MemoryUsage User::sharedMemoryUsage()
+{
+    qint64 bytes = 0;
+    for (const auto& [mediaId, avatar] : Private::otherAvatars)
+        bytes += MemoryUsage::NodeOverhead + MemoryUsage::bytesOf(mediaId)
+                 + qint64(sizeof(Avatar))
+                 + MemoryUsage::bytesOf(avatar.url().toString());
+    MemoryUsage usage;
+    usage.add("otherAvatars"_ls, qsizetype(Private::otherAvatars.size()),
+              bytes);
+    return usage;
+}
+
 qreal User::hueF() const { return d->hueF; }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "avatar.h"
+#include "memoryusage.h"
 #include "util.h"
 
 #include <QtCore/QObject>
@@ -82,16 +83,25 @@ public:
      * room member event for this user may (or may not) invalidate it.
      */
     const Avatar& avatarObject(const Room* room = nullptr) const;
+#ifndef Quotient_NO_GUI
     Q_INVOKABLE QImage avatar(int dimension,
                               const Quotient::Room* room = nullptr) const;
     Q_INVOKABLE QImage avatar(int requestedWidth, int requestedHeight,
                               const Quotient::Room* room = nullptr) const;
     QImage avatar(int width, int height, const Room* room,
                   const Avatar::get_callback_t& callback) const;
+#endif
 
     QString avatarMediaId(const Room* room = nullptr) const;
     QUrl avatarUrl(const Room* room = nullptr) const;
 
+    //! \brief Approximate memory used by the data shared among all users
+    //!
+    //! This is mostly avatars users had in different rooms and at different
+    //! times; these are never dropped.
+    //! \sa MemoryUsage
+    static MemoryUsage sharedMemoryUsage();
+
 public Q_SLOTS:
     /// Set a new name in the global user profile
     void rename(const QString& newName);
@@ -0,0 +1,190 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include <Quotient/jsonreader.h>
+#include <Quotient/csapi/keys.h>
+
+#include <QtCore/QJsonDocument>
+#include <QtTest/QtTest>
+
+using namespace Quotient;
+
+class TestJsonReader : public QObject {
+    Q_OBJECT
+private Q_SLOTS:
+    void readValue_data();
+    void readValue();
+    void strings();
+    void scalars();
+    void skipValue();
+    void malformed_data();
+    void malformed();
+    void generatedStructures();
+};
+
+void TestJsonReader::readValue_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    QTest::newRow("empty object") << QByteArray("{}");
+    QTest::newRow("empty array") << QByteArray(" [ ] ");
+    QTest::newRow("scalars")
+        << QByteArray(R"({"a": 1, "b": -2.5e3, "c": true, "d": false,
+                          "e": null, "f": "text", "g": 12345678901234})");
+    QTest::newRow("nested")
+        << QByteArray(R"([{"a": [1, {"b": []}, "x"]}, [[]], {"": {}}])");
+}
+
+void TestJsonReader::readValue()
+{
+    QFETCH(QByteArray, json);
+
+    const auto expected = QJsonDocument::fromJson(json);
+    QVERIFY(!expected.isNull());
+    JsonReader reader(json);
+    const auto actual = reader.readValue();
+    QVERIFY(reader.finish());
+    QCOMPARE(actual.isObject() ? QJsonDocument(actual.toObject())
+                               : QJsonDocument(actual.toArray()),
+             expected);
+}
+
+void TestJsonReader::strings()
+{
+    JsonReader reader(
+        R"(["plain", "esc\"aped\\\/\b\f\n\r\t", "фé", "😀",
+            "\ud83d", "пример"])");
+    QVERIFY(reader.enterArray());
+    QStringList strings;
+    while (reader.nextElement())
+        strings.push_back(reader.readString());
+    QVERIFY(reader.finish());
+    const QStringList expected {
+        QStringLiteral("plain"), QStringLiteral("esc\"aped\\/\b\f\n\r\t"),
+        QString::fromUtf8("фé"), QString::fromUtf8("😀"),
+        QString(QChar::ReplacementCharacter), QString::fromUtf8("пример")
+    };
+    QCOMPARE(strings, expected);
+
+    JsonReader keyReader(R"({"key": 1, "other": 2})");
+    QVERIFY(keyReader.enterObject());
+    QVERIFY(keyReader.nextKey());
+    QCOMPARE(keyReader.key(), QByteArray("key"));
+    QCOMPARE(keyReader.readInteger(), 1LL);
+    QVERIFY(keyReader.nextKey());
+    QCOMPARE(keyReader.key(), QByteArray("other"));
+    keyReader.skipValue();
+    QVERIFY(!keyReader.nextKey());
+    QVERIFY(keyReader.finish());
+}
+
+void TestJsonReader::scalars()
+{
+    JsonReader reader(R"([42, -7, 1.5, 1e2, true, false, "1", null])");
+    QVERIFY(reader.enterArray());
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.readInteger(), 42LL);
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.readInteger(), -7LL);
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.readDouble(), 1.5);
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.readInteger(), 100LL);
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.readBool(), true);
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.readBool(), false);
+    // Values of unexpected types are skipped, yielding defaults
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.readInteger(), 0LL);
+    QVERIFY(reader.nextElement());
+    QCOMPARE(reader.readString(), QString());
+    QVERIFY(!reader.nextElement());
+    QVERIFY(reader.finish());
+}
+
+void TestJsonReader::skipValue()
+{
+    JsonReader reader(
+        R"({"skip": {"a": ["]", "}", {"b": "\"}"}], "c": 1}, "keep": "yes"})");
+    QVERIFY(reader.enterObject());
+    QVERIFY(reader.nextKey());
+    reader.skipValue();
+    QVERIFY(reader.nextKey());
+    QCOMPARE(reader.key(), QByteArray("keep"));
+    QCOMPARE(reader.readString(), QStringLiteral("yes"));
+    QVERIFY(!reader.nextKey());
+    QVERIFY(reader.finish());
+}
+
+void TestJsonReader::malformed_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("unterminated object") << QByteArray(R"({"a": 1)");
+    QTest::newRow("unterminated string") << QByteArray(R"(["abc)");
+    QTest::newRow("missing comma") << QByteArray("[1 2]");
+    QTest::newRow("trailing comma") << QByteArray("[1, 2,]");
+    QTest::newRow("missing colon") << QByteArray(R"({"a" 1})");
+    QTest::newRow("bad literal") << QByteArray("[nul]");
+    QTest::newRow("bad escape") << QByteArray(R"(["\x"])");
+    QTest::newRow("garbage after") << QByteArray("{} {}");
+    QTest::newRow("too deep") << QByteArray(2000, '[') + QByteArray(2000, ']');
+}
+
+void TestJsonReader::malformed()
+{
+    QFETCH(QByteArray, json);
+
+    JsonReader reader(json);
+    reader.readValue();
+    QVERIFY(!reader.finish());
+    QVERIFY(reader.hasError());
+    QVERIFY(!reader.errorString().isEmpty());
+    // Errors are sticky
+    QCOMPARE(reader.peek(), JsonReader::Invalid);
+    QVERIFY(!reader.enterObject());
+}
+
+void TestJsonReader::generatedStructures()
+{
+    const auto json = QByteArray(R"({
+        "@alice:example.org": {
+            "DEVICE1": {
+                "user_id": "@alice:example.org",
+                "device_id": "DEVICE1",
+                "algorithms": ["m.olm.v1.curve25519-aes-sha2"],
+                "keys": {"ed25519:DEVICE1": "key1", "curve25519:DEVICE1": "key2"},
+                "signatures": {"@alice:example.org": {"ed25519:DEVICE1": "sig"}},
+                "unsigned": {"device_display_name": "Alice's phone"},
+                "extra": {"ignored": [1, 2, 3]}
+            }
+        }
+    })");
+    using DeviceKeysMap =
+        QHash<QString, QHash<QString, QueryKeysJob::DeviceInformation>>;
+
+    DeviceKeysMap streamed;
+    JsonReader reader(json);
+    readFromJson(reader, streamed);
+    QVERIFY(reader.finish());
+    const auto converted =
+        fromJson<DeviceKeysMap>(QJsonDocument::fromJson(json).object());
+
+    const auto& device = streamed["@alice:example.org"_ls]["DEVICE1"_ls];
+    const auto& expected = converted["@alice:example.org"_ls]["DEVICE1"_ls];
+    QCOMPARE(device.userId, expected.userId);
+    QCOMPARE(device.deviceId, expected.deviceId);
+    QCOMPARE(device.algorithms, expected.algorithms);
+    QCOMPARE(device.keys, expected.keys);
+    QCOMPARE(device.signatures, expected.signatures);
+    QVERIFY(device.unsignedData.has_value());
+    QCOMPARE(device.unsignedData->deviceDisplayName,
+             QStringLiteral("Alice's phone"));
+    QCOMPARE(device.unsignedData->deviceDisplayName,
+             expected.unsignedData->deviceDisplayName);
+}
+
+QTEST_GUILESS_MAIN(TestJsonReader)
+#include "jsonreadertest.moc"
@@ -0,0 +1,115 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include <Quotient/servermetadatacache.h>
+#include <Quotient/jobs/basejob.h>
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QStandardPaths>
+#include <QtTest/QtTest>
+
+using namespace Quotient;
+using namespace std::chrono_literals;
+
+class TestServerMetadataCache : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void maxAgeFromHeaders();
+    void freshness();
+    void cleanupTestCase();
+};
+
+void TestServerMetadataCache::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    ServerMetadataCache::clear();
+}
+
+void TestServerMetadataCache::maxAgeFromHeaders()
+{
+    const auto maxAge = [](const QByteArray& cacheControl,
+                           const QByteArray& expires = {}) {
+        return BaseJob::maxAgeFromHeaders(cacheControl, expires);
+    };
+    QCOMPARE(maxAge("max-age=3600"), std::optional(3600s));
+    QCOMPARE(maxAge("public, Max-Age=60 , must-revalidate"),
+             std::optional(60s));
+    QCOMPARE(maxAge("max-age=-5"), std::optional(0s));
+    QCOMPARE(maxAge("no-cache"), std::optional(0s));
+    QCOMPARE(maxAge("no-store, max-age=3600"), std::optional(0s));
+    QVERIFY(!maxAge("max-age=bogus"));
+    QVERIFY(BaseJob::cacheControlAllowsStoring("no-cache, max-age=0"));
+    QVERIFY(BaseJob::cacheControlAllowsStoring({}));
+    QVERIFY(!BaseJob::cacheControlAllowsStoring("private, No-Store"));
+    QVERIFY(!maxAge({}));
+
+    // Cache-Control takes precedence over Expires
+    QCOMPARE(maxAge("max-age=10", "Wed, 21 Oct 2015 07:28:00 GMT"),
+             std::optional(10s));
+    QCOMPARE(maxAge({}, "Wed, 21 Oct 2015 07:28:00 GMT"), std::optional(0s));
+    const auto inAnHour =
+        maxAge({}, QDateTime::currentDateTimeUtc()
+                       .addSecs(3600)
+                       .toString(Qt::RFC2822Date)
+                       .toLatin1());
+    QVERIFY(inAnHour);
+    QVERIFY(*inAnHour > 3590s && *inAnHour <= 3600s);
+    QVERIFY(!maxAge({}, "not a date"));
+}
+
+void TestServerMetadataCache::freshness()
+{
+    const auto server = QStringLiteral("https://example.org");
+    const QJsonObject data { { QStringLiteral("flows"), QJsonArray() } };
+    const auto kind = ServerMetadataCache::LoginFlows;
+    QVERIFY(!ServerMetadataCache::get(kind, server));
+
+    const auto expiresIn = [&] {
+        const auto entry = ServerMetadataCache::get(kind, server);
+        return entry ? std::chrono::seconds(entry->fetched.secsTo(entry->expires))
+                     : -1s;
+    };
+    ServerMetadataCache::put(kind, server, data, 600s);
+    QCOMPARE(ServerMetadataCache::get(kind, server)->data, data);
+    QVERIFY(ServerMetadataCache::get(kind, server)->isFresh());
+    QCOMPARE(expiresIn(), 600s);
+
+    // The time to live is used as a cap, as well as when the response has no
+    // caching headers
+    const auto ttl = ServerMetadataCache::timeToLive(kind);
+    ServerMetadataCache::put(kind, server, data, ttl + 1h);
+    QCOMPARE(expiresIn(), ttl);
+    ServerMetadataCache::put(kind, server, data);
+    QCOMPARE(expiresIn(), ttl);
+    QVERIFY(ServerMetadataCache::get(kind, server)->isFresh());
+    // no-cache responses are kept, to be used while being revalidated
+    ServerMetadataCache::put(kind, server, data, 0s);
+    QCOMPARE(expiresIn(), 0s);
+    QCOMPARE(ServerMetadataCache::get(kind, server)->data, data);
+    QVERIFY(!ServerMetadataCache::get(kind, server)->isFresh());
+
+    ServerMetadataCache::setTimeToLive(kind, 0s);
+    ServerMetadataCache::put(kind, server, data);
+    QVERIFY(!ServerMetadataCache::get(kind, server)->isFresh());
+    // Other kinds have their own time to live
+    ServerMetadataCache::put(ServerMetadataCache::Capabilities, server, data);
+    QVERIFY(ServerMetadataCache::get(ServerMetadataCache::Capabilities, server)
+                ->isFresh());
+    ServerMetadataCache::setTimeToLive(kind, ttl);
+
+    ServerMetadataCache::remove(kind, server);
+    QVERIFY(!ServerMetadataCache::get(kind, server));
+    QVERIFY(ServerMetadataCache::get(ServerMetadataCache::Capabilities, server));
+}
+
+void TestServerMetadataCache::cleanupTestCase()
+{
+    ServerMetadataCache::clear();
+}
+
+QTEST_GUILESS_MAIN(TestServerMetadataCache)
+#include "servermetadatacachetest.moc"
@@ -22,7 +22,9 @@ std::shared_ptr<Quotient::Connection> Quotient::createTestConnection(
     const QString& deviceName)
 {
     static constexpr auto homeserverAddr = "localhost:1234"_ls;
-    auto* const nam = NetworkAccessManager::instance();
+    // The Interactive lane instance re-emits sslErrors() from the instances
+    // of other lanes (/sync, media), so this covers all requests
+    auto* const nam = NetworkAccessManager::instance(NetworkLane::Interactive);
     QObject::connect(nam, &QNetworkAccessManager::sslErrors, nam,
                      [](QNetworkReply* reply) { reply->ignoreSslErrors(); });
 
@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include <Quotient/tracing.h>
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+using namespace Quotient;
+
+class TestTracing : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void disabled();
+    void writeTrace();
+};
+
+void TestTracing::disabled()
+{
+    QVERIFY(!Tracing::isEnabled());
+    // Nothing to check except that these don't crash without a trace file
+    const Tracing::Span span { "test", "span" };
+    Tracing::counter("counter", 1);
+    Tracing::asyncBegin("test", "async", this);
+    Tracing::asyncEnd("test", "async", this);
+}
+
+void TestTracing::writeTrace()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const auto fileName = dir.filePath(QStringLiteral("trace.json"));
+    QVERIFY(Tracing::start(fileName));
+    QVERIFY(Tracing::isEnabled());
+    {
+        const Tracing::Span outer { "test", "outer",
+                                    QStringLiteral("!room:example.org") };
+        const Tracing::Span inner { "test", "inner" };
+        Tracing::counter("counter", 42);
+        Tracing::asyncBegin("test", "async", this);
+        Tracing::asyncEnd("test", "async", this);
+    }
+    Tracing::stop();
+    QVERIFY(!Tracing::isEnabled());
+
+    QFile f { fileName };
+    QVERIFY(f.open(QFile::ReadOnly));
+    QJsonParseError error;
+    const auto json = QJsonDocument::fromJson(f.readAll(), &error).object();
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    const auto events = json.value(QStringLiteral("traceEvents")).toArray();
+
+    QHash<QString, QJsonObject> eventsByName;
+    for (const auto& e : events) {
+        const auto event = e.toObject();
+        eventsByName.insert(event.value(QStringLiteral("name")).toString(),
+                            event);
+    }
+    QVERIFY(eventsByName.contains(QStringLiteral("thread_name")));
+    const auto outer = eventsByName.value(QStringLiteral("outer"));
+    const auto inner = eventsByName.value(QStringLiteral("inner"));
+    QCOMPARE(outer.value(QStringLiteral("ph")).toString(), QStringLiteral("X"));
+    QCOMPARE(outer.value(QStringLiteral("args"))[QStringLiteral("tag")]
+                 .toString(),
+             QStringLiteral("!room:example.org"));
+    // The inner span is nested in the outer one
+    const auto start = [](const QJsonObject& event) {
+        return event.value(QStringLiteral("ts")).toDouble();
+    };
+    const auto end = [start](const QJsonObject& event) {
+        return start(event) + event.value(QStringLiteral("dur")).toDouble();
+    };
+    QVERIFY(start(outer) <= start(inner));
+    QVERIFY(end(inner) <= end(outer));
+    QCOMPARE(eventsByName.value(QStringLiteral("counter"))
+                 .value(QStringLiteral("args"))[QStringLiteral("value")]
+                 .toInt(),
+             42);
+    QCOMPARE(eventsByName.value(QStringLiteral("async"))
+                 .value(QStringLiteral("ph"))
+                 .toString(),
+             QStringLiteral("e"));
+}
+
+QTEST_GUILESS_MAIN(TestTracing)
+#include "tracingtest.moc"
@@ -2,7 +2,10 @@
 // SPDX-License-Identifier: LGPL-2.1-or-later
 
 #include <Quotient/omittable.h>
+#include <Quotient/jobs/requestdata.h>
 
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
 #include <QtTest/QtTest>
 
 // compile-time Omittable<> tests
@@ -38,8 +41,41 @@ static_assert(std::is_same_v<Omittable<bool>,
 class TestUtils : public QObject {
     Q_OBJECT
 private Q_SLOTS:
-    // TODO
+    void jsonObjectWriter();
 };
 
+void TestUtils::jsonObjectWriter()
+{
+    const auto tricky = QStringLiteral("\"quotes\", \\, \n, \x01 and \u00e9");
+    const QJsonObject deviceContent { { QStringLiteral("body"), tricky } };
+
+    JsonObjectWriter writer;
+    writer.beginObject(QStringLiteral("messages"));
+    writer.beginObject(QStringLiteral("@alice:example.org"));
+    writer.write(QStringLiteral("DEVICE1"), deviceContent);
+    writer.write(QStringLiteral("DEVICE2"), QJsonObject());
+    writer.endObject();
+    writer.beginObject(tricky);
+    writer.endObject();
+    // The last object is closed by finish()
+    writer.beginObject(QStringLiteral("unfinished"));
+    writer.write(QStringLiteral("key"), tricky);
+
+    QJsonParseError error;
+    const auto json = QJsonDocument::fromJson(writer.finish(), &error).object();
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    const QJsonObject expected {
+        { QStringLiteral("messages"),
+          QJsonObject {
+              { QStringLiteral("@alice:example.org"),
+                QJsonObject { { QStringLiteral("DEVICE1"), deviceContent },
+                              { QStringLiteral("DEVICE2"), QJsonObject() } } },
+              { tricky, QJsonObject() },
+              { QStringLiteral("unfinished"),
+                QJsonObject { { QStringLiteral("key"), tricky } } } } }
+    };
+    QCOMPARE(json, expected);
+}
+
 QTEST_APPLESS_MAIN(TestUtils)
 #include "utiltests.moc"
@@ -0,0 +1,183 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "eventexercise.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonDocument>
+#include <QtTest/QtTest>
+
+using namespace Quotient;
+
+namespace {
+
+QByteArray messageWithContent(const QByteArray& extraContent)
+{
+    return R"({"type":"m.room.message","event_id":"$evt:example.org",)"
+           R"("sender":"@alice:example.org","origin_server_ts":1,)"
+           R"("content":{"msgtype":"m.text","body":"Hi",)"
+           + extraContent + "}}";
+}
+
+QByteArray deepNesting(int depth)
+{
+    // QJsonDocument refuses to parse nesting deeper than 1024 levels, so
+    // depths above that are only interesting for the fuzzer
+    return messageWithContent("\"nested\":" + QByteArray("{\"a\":").repeated(depth)
+                              + "1" + QByteArray("}").repeated(depth));
+}
+
+QByteArray hugeUnsigned(int keys)
+{
+    QByteArray json =
+        R"({"type":"m.room.message","event_id":"$evt:example.org",)"
+        R"("sender":"@alice:example.org","origin_server_ts":1,)"
+        R"("content":{"msgtype":"m.text","body":"Hi"},"unsigned":{)";
+    for (int i = 0; i < keys; ++i)
+        json += "\"key" + QByteArray::number(i) + "\":\"value\",";
+    return json + R"("age":1}})";
+}
+
+QByteArray giantReactionKey(int repeats)
+{
+    return R"({"type":"m.reaction","event_id":"$evt:example.org",)"
+           R"("sender":"@alice:example.org","origin_server_ts":1,)"
+           R"("content":{"m.relates_to":{"rel_type":"m.annotation",)"
+           R"("event_id":"$target:example.org","key":")"
+           + QByteArray("\xf0\x9f\x91\x8d").repeated(repeats) + "\"}}}";
+}
+
+QByteArray longFormattedBody(int paragraphs)
+{
+    return messageWithContent(R"("format":"org.matrix.custom.html",)"
+                              R"("formatted_body":")"
+                              + QByteArray("<p>Lorem <b>ipsum</b></p>")
+                                    .repeated(paragraphs)
+                              + "\"");
+}
+
+QByteArray manyPowerLevelUsers(int users)
+{
+    QByteArray json =
+        R"({"type":"m.room.power_levels","event_id":"$evt:example.org",)"
+        R"("sender":"@alice:example.org","origin_server_ts":1,)"
+        R"("state_key":"","content":{"users":{)";
+    for (int i = 0; i < users; ++i)
+        json += "\"@user" + QByteArray::number(i) + ":example.org\":50,";
+    return json + R"("@alice:example.org":100}}})";
+}
+
+QByteArray manyReceipts(int events)
+{
+    QByteArray json = R"({"type":"m.receipt","content":{)";
+    for (int i = 0; i < events; ++i) {
+        if (i > 0)
+            json += ',';
+        json += "\"$evt" + QByteArray::number(i)
+                + R"(:example.org":{"m.read":{"@alice:example.org":{"ts":1}}})";
+    }
+    return json + "}}";
+}
+
+// Growing the input this many times should increase the time spent by about
+// as much if processing is linear; quadratic behaviour gives ScaleFactor
+// squared, which stands out in the results of scaling()
+constexpr int ScaleFactor = 4;
+
+qint64 bestTimeNsecs(const QByteArray& input)
+{
+    // The best of several runs filters out noise from the system
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int i = 0; i < 5; ++i) {
+        QElapsedTimer et;
+        et.start();
+        exerciseEvent(QJsonDocument::fromJson(input).object());
+        best = std::min(best, et.nsecsElapsed());
+    }
+    return best;
+}
+
+} // namespace
+
+class EventBenchmark : public QObject {
+    Q_OBJECT
+private Q_SLOTS:
+    void corpus_data();
+    void corpus();
+    void pathological_data();
+    void pathological();
+    void scaling_data() { pathological_data(); }
+    void scaling();
+};
+
+void EventBenchmark::corpus_data()
+{
+    QTest::addColumn<QByteArray>("input");
+    const QDir corpusDir { QStringLiteral(EVENT_CORPUS_DIR) };
+    const auto fileNames =
+        corpusDir.entryList({ QStringLiteral("*.json") }, QDir::Files);
+    QVERIFY(!fileNames.isEmpty());
+    for (const auto& fileName : fileNames) {
+        QFile f { corpusDir.filePath(fileName) };
+        QVERIFY(f.open(QFile::ReadOnly));
+        QTest::newRow(qPrintable(fileName)) << f.readAll();
+    }
+}
+
+void EventBenchmark::corpus()
+{
+    QFETCH(QByteArray, input);
+    const auto json = QJsonDocument::fromJson(input).object();
+    QVERIFY(!json.isEmpty());
+    QBENCHMARK {
+        exerciseEvent(json);
+    }
+}
+
+void EventBenchmark::pathological_data()
+{
+    QTest::addColumn<QByteArray>("input");
+    QTest::addColumn<QByteArray>("scaledInput");
+    const auto addRow = [](const char* name, auto makeInput, int size) {
+        QTest::newRow(name)
+            << makeInput(size) << makeInput(size * ScaleFactor);
+    };
+    addRow("deep nesting", deepNesting, 200);
+    addRow("huge unsigned", hugeUnsigned, 10'000);
+    addRow("giant reaction key", giantReactionKey, 100'000);
+    addRow("long formatted body", longFormattedBody, 20'000);
+    addRow("many power level users", manyPowerLevelUsers, 10'000);
+    addRow("many receipts", manyReceipts, 5'000);
+}
+
+void EventBenchmark::pathological()
+{
+    QFETCH(QByteArray, input);
+    // Unlike corpus(), this includes parsing the JSON text: with inputs this
+    // large, that's a part of the cost that a client has to pay too
+    QBENCHMARK {
+        exerciseEvent(QJsonDocument::fromJson(input).object());
+    }
+}
+
+void EventBenchmark::scaling()
+{
+    QFETCH(QByteArray, input);
+    QFETCH(QByteArray, scaledInput);
+    const auto smallTime = bestTimeNsecs(input);
+    const auto largeTime = bestTimeNsecs(scaledInput);
+    const auto growth =
+        double(largeTime) / double(std::max(smallTime, qint64(1)));
+    qInfo().nospace() << "x" << ScaleFactor << " input: " << smallTime / 1000
+                      << " us -> " << largeTime / 1000 << " us (x" << growth
+                      << ")";
+    // Timings depend too much on the machine and its load to pass or fail
+    // on them; the growth ratio (in percent, as QtTest has no metric for
+    // plain ratios) goes to the results instead, to be compared across runs
+    QTest::setBenchmarkResult(growth * 100, QTest::Events);
+}
+
+QTEST_GUILESS_MAIN(EventBenchmark)
+#include "eventbenchmark.moc"
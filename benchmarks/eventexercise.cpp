@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "eventexercise.h"
+
+#include <Quotient/events/encryptedevent.h>
+#include <Quotient/events/reactionevent.h>
+#include <Quotient/events/receiptevent.h>
+#include <Quotient/events/redactionevent.h>
+#include <Quotient/events/roommemberevent.h>
+#include <Quotient/events/roommessageevent.h>
+#include <Quotient/events/roompowerlevelsevent.h>
+#include <Quotient/events/stickerevent.h>
+
+using namespace Quotient;
+
+size_t Quotient::exerciseEvent(const QJsonObject& json)
+{
+    const auto event = loadEvent<Event>(json);
+    if (!event)
+        return 0;
+
+    size_t seed = qHash(event->matrixType());
+    const auto mix = [&seed](const auto& value) {
+        seed = qHashMulti(seed, value);
+    };
+    mix(event->contentJson().size());
+    mix(event->unsignedJson().size());
+    if (const auto* roomEvent = eventCast<const RoomEvent>(event)) {
+        mix(roomEvent->id());
+        mix(roomEvent->senderId());
+        mix(roomEvent->originTimestamp().toMSecsSinceEpoch());
+        mix(roomEvent->transactionId());
+        mix(int(roomEvent->isRedacted()));
+        if (roomEvent->isStateEvent())
+            mix(roomEvent->stateKey());
+    }
+    switchOnType(
+        *event,
+        [&mix](const RoomMessageEvent& e) {
+            mix(e.plainBody());
+            mix(e.rawMsgtype());
+            mix(int(e.hasFileContent()));
+            mix(e.replacedEvent());
+        },
+        [&mix](const ReactionEvent& e) {
+            mix(e.eventId());
+            mix(e.key());
+        },
+        [&mix](const RoomMemberEvent& e) {
+            mix(int(e.membership()));
+            mix(e.newDisplayName().value_or(QString()));
+            mix(e.newAvatarUrl().value_or(QUrl()).toString());
+        },
+        [&mix](const RoomPowerLevelsEvent& e) {
+            mix(e.users().size());
+            mix(e.usersDefault());
+        },
+        [&mix](const RedactionEvent& e) {
+            mix(e.redactedEvent());
+            mix(e.reason());
+        },
+        [&mix](const ReceiptEvent& e) { mix(e.content().size()); },
+        [&mix](const StickerEvent& e) {
+            mix(e.body());
+            mix(e.url().toString());
+        },
+        [&mix](const EncryptedEvent& e) { mix(e.algorithm()); },
+        [](const Event&) {});
+    return seed;
+}
@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#pragma once
+
+#include <QtCore/QJsonObject>
+
+namespace Quotient {
+
+//! \brief Load an event from \p json and read it through its typed accessors
+//!
+//! This goes through the path that untrusted JSON from the homeserver takes:
+//! loadEvent() with the event type tree, the content parsing of the specific
+//! event class and the fromJson() converters behind its accessors. The result
+//! is a hash of what was read, only returned so that the compiler doesn't
+//! optimise the work away.
+size_t exerciseEvent(const QJsonObject& json);
+
+} // namespace Quotient
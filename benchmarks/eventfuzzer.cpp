@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+// A libFuzzer harness for the event loading code; see README.md for how to
+// build and run it
+
+#include "eventexercise.h"
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QLoggingCategory>
+
+using namespace Quotient;
+
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+    // Warnings about malformed events are expected in abundance here
+    QLoggingCategory::setFilterRules(QStringLiteral("quotient.*=false"));
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    const auto json = QJsonDocument::fromJson(
+        QByteArray::fromRawData(reinterpret_cast<const char*>(data),
+                                qsizetype(size)));
+    if (json.isObject())
+        exerciseEvent(json.object());
+    else if (json.isArray()) // Same as the "events" array in a sync response
+        for (const auto& v : json.array())
+            exerciseEvent(v.toObject());
+    return 0;
+}
@@ -0,0 +1,350 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "syncdatagenerator.h"
+
+#include <Quotient/connection.h>
+#include <Quotient/eventstats.h>
+#include <Quotient/jsonreader.h>
+#include <Quotient/room.h>
+#include <Quotient/syncdata.h>
+
+#include <Quotient/csapi/keys.h>
+
+#include <QtCore/QEventLoop>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QStandardPaths>
+#include <QtTest/QtTest>
+
+#include <functional>
+
+using namespace Quotient;
+
+// Room::updateData() and Room::toJson() are protected
+class BenchmarkRoom : public Room {
+public:
+    using Room::Room;
+    using Room::toJson;
+    using Room::updateData;
+};
+
+class IngestBenchmark : public QObject {
+    Q_OBJECT
+private:
+    std::unique_ptr<Connection> connection;
+    SyncDataGenerator generator;
+
+    std::unique_ptr<BenchmarkRoom> makeRoom(int roomIndex,
+                                            const QJsonObject& roomJson);
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void parseSync_data();
+    void parseSync();
+    void parseJsonBytes_data();
+    void parseJsonBytes();
+    void convertJsonTree_data();
+    void convertJsonTree();
+    void streamResponse_data();
+    void streamResponse();
+    void loadEvents();
+    void updateRoom_data();
+    void updateRoom();
+    void eventStats();
+    void roomToJson();
+    void saveState();
+    void loadState();
+};
+
+std::unique_ptr<BenchmarkRoom> IngestBenchmark::makeRoom(
+    int roomIndex, const QJsonObject& roomJson)
+{
+    auto room = std::make_unique<BenchmarkRoom>(connection.get(),
+                                                generator.roomId(roomIndex),
+                                                JoinState::Join);
+    room->updateData({ room->id(), JoinState::Join, roomJson });
+    return room;
+}
+
+void IngestBenchmark::initTestCase()
+{
+    // Keep the state cache away from the user's real one
+    QStandardPaths::setTestModeEnabled(true);
+    Connection::setRoomType<BenchmarkRoom>();
+    connection.reset(
+        Connection::makeMockConnection("@bench:example.org"_ls, false));
+    connection->setCacheState(false);
+}
+
+void IngestBenchmark::parseSync_data()
+{
+    QTest::addColumn<int>("rooms");
+    QTest::addColumn<int>("members");
+    QTest::addColumn<int>("messages");
+
+    QTest::newRow("100 small rooms") << 100 << 10 << 20;
+    QTest::newRow("10 busy rooms") << 10 << 100 << 500;
+    QTest::newRow("1 large room") << 1 << 10000 << 100;
+}
+
+void IngestBenchmark::parseSync()
+{
+    QFETCH(int, rooms);
+    QFETCH(int, members);
+    QFETCH(int, messages);
+    const auto json = generator.makeSyncJson(rooms, { members, messages });
+
+    QBENCHMARK {
+        SyncData data;
+        data.parseJson(json);
+    }
+}
+
+// parseJsonBytes and convertJsonTree split the time of handling a response
+// between QJsonDocument::fromJson() and the fromJson<>() conversion of
+// the resulting tree that generated code does (see CODE_GENERATION.md);
+// streamResponse does the same job with JsonReader, the way jobs do it when
+// BaseJob::setStreamingParsersEnabled() is on. Run
+// `ingestbenchmark parseJsonBytes convertJsonTree streamResponse` to compare.
+enum class Endpoint { Sync, KeysQuery, Members, Messages };
+
+void IngestBenchmark::parseJsonBytes_data()
+{
+    QTest::addColumn<QByteArray>("response");
+    QTest::addColumn<int>("endpoint");
+
+    const auto addRow = [](const char* name, const QJsonObject& json,
+                           Endpoint endpoint) {
+        QTest::newRow(name)
+            << QJsonDocument(json).toJson(QJsonDocument::Compact)
+            << int(endpoint);
+    };
+    addRow("/keys/query, 100 users", generator.makeKeysQueryJson(100, 3),
+           Endpoint::KeysQuery);
+    addRow("/keys/query, 5000 users", generator.makeKeysQueryJson(5000, 3),
+           Endpoint::KeysQuery);
+    addRow("/sync, 100 small rooms",
+           generator.makeSyncJson(100, { 10, 20 }), Endpoint::Sync);
+    addRow("/sync, 10 busy rooms", generator.makeSyncJson(10, { 100, 500 }),
+           Endpoint::Sync);
+    addRow("/members, 10000 members",
+           { { "chunk"_ls, generator.makeMemberEvents(0, 0, 10000) } },
+           Endpoint::Members);
+    addRow("/messages, 1000 events",
+           { { "chunk"_ls, generator.makeTimeline(0, 1000, 100) },
+             { "start"_ls, "t1-start"_ls },
+             { "end"_ls, "t1-end"_ls } },
+           Endpoint::Messages);
+}
+
+void IngestBenchmark::parseJsonBytes()
+{
+    QFETCH(QByteArray, response);
+
+    QBENCHMARK {
+        QJsonDocument::fromJson(response);
+    }
+}
+
+void IngestBenchmark::convertJsonTree_data() { parseJsonBytes_data(); }
+
+using DeviceKeysMap =
+    QHash<QString, QHash<QString, QueryKeysJob::DeviceInformation>>;
+
+void IngestBenchmark::convertJsonTree()
+{
+    QFETCH(QByteArray, response);
+    QFETCH(int, endpoint);
+    const auto json = QJsonDocument::fromJson(response).object();
+
+    std::function<void()> convert;
+    switch (Endpoint(endpoint)) {
+    case Endpoint::Sync:
+        convert = [&json] {
+            SyncData data;
+            data.parseJson(json);
+        };
+        break;
+    case Endpoint::KeysQuery: // What QueryKeysJob::deviceKeys() does
+        convert = [&json] {
+            fromJson<DeviceKeysMap>(json.value("device_keys"_ls));
+        };
+        break;
+    case Endpoint::Members:
+        convert = [&json] {
+            fromJson<StateEvents>(json.value("chunk"_ls));
+        };
+        break;
+    case Endpoint::Messages:
+        convert = [&json] {
+            fromJson<RoomEvents>(json.value("chunk"_ls));
+        };
+    }
+
+    QBENCHMARK {
+        convert();
+    }
+}
+
+void IngestBenchmark::streamResponse_data() { parseJsonBytes_data(); }
+
+// Read the top-level object, passing the property \p key to \p readProperty
+// and keeping the rest as JSON, as BaseJob does; return false on errors
+static bool streamTopLevel(const QByteArray& response, QLatin1String key,
+                           const std::function<void(JsonReader&)>& readProperty)
+{
+    JsonReader reader(response);
+    QJsonObject otherProperties;
+    if (reader.enterObject())
+        while (reader.nextKey())
+            if (QLatin1String(reader.key()) == key)
+                readProperty(reader);
+            else
+                otherProperties.insert(QString::fromUtf8(reader.key()),
+                                       reader.readValue());
+    return reader.finish();
+}
+
+void IngestBenchmark::streamResponse()
+{
+    QFETCH(QByteArray, response);
+    QFETCH(int, endpoint);
+
+    auto key = "chunk"_ls;
+    std::function<void(JsonReader&)> readProperty;
+    switch (Endpoint(endpoint)) {
+    case Endpoint::Sync:
+        key = "rooms"_ls;
+        readProperty = [](JsonReader& reader) {
+            SyncData data;
+            data.parseRooms(reader);
+        };
+        break;
+    case Endpoint::KeysQuery:
+        key = "device_keys"_ls;
+        readProperty = [](JsonReader& reader) {
+            DeviceKeysMap deviceKeys;
+            readFromJson(reader, deviceKeys);
+        };
+        break;
+    case Endpoint::Members:
+        readProperty = [](JsonReader& reader) {
+            StateEvents events;
+            readFromJson(reader, events);
+        };
+        break;
+    case Endpoint::Messages:
+        readProperty = [](JsonReader& reader) {
+            RoomEvents events;
+            readFromJson(reader, events);
+        };
+    }
+
+    QBENCHMARK {
+        QVERIFY(streamTopLevel(response, key, readProperty));
+    }
+}
+
+void IngestBenchmark::loadEvents()
+{
+    const auto timelineJson = generator.makeTimeline(0, 1000, 100);
+
+    QBENCHMARK {
+        for (const auto& eventJson : timelineJson)
+            loadEvent<RoomEvent>(eventJson.toObject());
+    }
+}
+
+void IngestBenchmark::updateRoom_data()
+{
+    QTest::addColumn<int>("members");
+    QTest::addColumn<int>("messages");
+
+    QTest::newRow("small") << 10 << 20;
+    QTest::newRow("busy") << 100 << 500;
+    QTest::newRow("large") << 10000 << 100;
+}
+
+void IngestBenchmark::updateRoom()
+{
+    QFETCH(int, members);
+    QFETCH(int, messages);
+    const auto roomJson = generator.makeRoomJson(0, { members, messages });
+
+    // Sync data is consumed by updateData() and a room only takes the same
+    // events once, so every iteration starts afresh; this includes
+    // constructing SyncRoomData from JSON and the room object itself.
+    QBENCHMARK {
+        makeRoom(0, roomJson);
+    }
+}
+
+void IngestBenchmark::eventStats()
+{
+    const auto room = makeRoom(0, generator.makeRoomJson(0, { 100, 5000 }));
+
+    QBENCHMARK {
+        EventStats::fromRange(room.get(), Room::rev_iter_t(room->syncEdge()),
+                              room->historyEdge());
+    }
+}
+
+void IngestBenchmark::roomToJson()
+{
+    const auto room = makeRoom(0, generator.makeRoomJson(0, { 1000, 500 }));
+
+    QBENCHMARK {
+        room->toJson();
+    }
+}
+
+void IngestBenchmark::saveState()
+{
+    // Only the part on the calling thread is measured; writing the files
+    // happens in the background
+    std::unique_ptr<Connection> c {
+        Connection::makeMockConnection("@save:example.org"_ls, false)
+    };
+    generator.writeStateCache(c->stateCachePath(), 100, { 100, 50 });
+    QEventLoop loop;
+    connect(c.get(), &Connection::roomUpdatesProgress, &loop,
+            [&loop](qsizetype done, qsizetype total) {
+                if (done == total)
+                    loop.quit();
+            });
+    c->loadState();
+    loop.exec();
+
+    QBENCHMARK {
+        c->saveState();
+    }
+}
+
+void IngestBenchmark::loadState()
+{
+    static constexpr auto userId = "@load:example.org"_ls;
+    generator.writeStateCache(
+        std::unique_ptr<Connection>(Connection::makeMockConnection(userId, false))
+            ->stateCachePath(),
+        100, { 100, 50 });
+
+    // Rooms take the same events only once, so there's only one run
+    QBENCHMARK_ONCE {
+        std::unique_ptr<Connection> c {
+            Connection::makeMockConnection(userId, false)
+        };
+        QEventLoop loop;
+        connect(c.get(), &Connection::roomUpdatesProgress, &loop,
+                [&loop](qsizetype done, qsizetype total) {
+                    if (done == total)
+                        loop.quit();
+                });
+        c->loadState();
+        loop.exec();
+    }
+}
+
+QTEST_GUILESS_MAIN(IngestBenchmark)
+#include "ingestbenchmark.moc"
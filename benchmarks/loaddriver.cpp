@@ -0,0 +1,427 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+// Runs a Connection against MockHomeserver on the local machine and reports
+// throughput and latency percentiles of syncing, opening rooms (loading
+// members and history) and sending messages. Run with --help for options.
+
+#include "mockhomeserver.h"
+
+#include <Quotient/connection.h>
+#include <Quotient/room.h>
+
+#include <Quotient/csapi/message_pagination.h>
+#include <Quotient/csapi/rooms.h>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QTextStream>
+#include <QtCore/QTimer>
+
+#include <algorithm>
+
+using namespace Quotient;
+
+namespace {
+class Samples {
+public:
+    explicit Samples(QString name) : name(std::move(name)) {}
+
+    void add(const QElapsedTimer& timer)
+    {
+        nsecs.push_back(timer.nsecsElapsed());
+    }
+
+    void report(QTextStream& out)
+    {
+        if (nsecs.empty()) {
+            out << name << ": no samples\n";
+            return;
+        }
+        std::sort(nsecs.begin(), nsecs.end());
+        const auto percentile = [this](int p) {
+            return QString::number(
+                double(nsecs[(nsecs.size() - 1) * size_t(p) / 100]) / 1e6, 'f',
+                2);
+        };
+        out << name << ": " << nsecs.size() << " samples, p50 "
+            << percentile(50) << " ms, p90 " << percentile(90) << " ms, p99 "
+            << percentile(99) << " ms, max " << percentile(100) << " ms\n";
+    }
+
+private:
+    QString name;
+    std::vector<qint64> nsecs;
+};
+
+class LoadDriver : public QObject {
+public:
+    LoadDriver(const MockHomeserver::Config& config, int syncs, int openRooms,
+               int sends, std::chrono::seconds phaseTimeout)
+        : server(config), syncsLeft(syncs), openRoomCount(openRooms),
+          sendCount(sends), phaseTimeout(phaseTimeout)
+    {
+        phaseDeadline.setSingleShot(true);
+        connect(&phaseDeadline, &QTimer::timeout, this,
+                &LoadDriver::onPhaseTimeout);
+    }
+
+    bool start(bool lazyLoading);
+
+private:
+    MockHomeserver server;
+    Connection connection;
+    int syncsLeft;
+    int openRoomCount;
+    int sendCount;
+    std::chrono::seconds phaseTimeout;
+
+    enum class Phase { NotStarted, Syncing, OpeningRooms, Sending, Done };
+    Phase phase = Phase::NotStarted;
+    QElapsedTimer phaseTimer;
+    //! Moves on to the next phase if the current one takes too long, e.g.
+    //! because a request never completes
+    QTimer phaseDeadline;
+    QElapsedTimer syncTimer;
+    Samples syncSamples { "Sync request"_ls };
+    Samples ingestSamples { "Sync request and room updates"_ls };
+    Samples membersSamples { "Loading all members"_ls };
+    Samples historySamples { "Loading a page of history"_ls };
+    Samples sendSamples { "Sending a message"_ls };
+    QHash<QString, QElapsedTimer> sendTimers;
+    int sendFailures = 0;
+    QHash<QString, QElapsedTimer> membersTimers; //!< Keyed by room id
+    int pendingRoomOps = 0;
+    int roomOpFailures = 0;
+
+    void startPhase(Phase newPhase);
+    void onPhaseTimeout();
+    void nextSync();
+    void onSyncDone();
+    void openRooms();
+    void sendMessages();
+    void finishSend(const QString& txnId, bool success);
+    void failMembersLoading(const BaseJob* job);
+    void completeRoomOp(bool success);
+    void finish();
+};
+
+bool LoadDriver::start(bool lazyLoading)
+{
+    if (!server.listen(QHostAddress::LocalHost)) {
+        qCritical() << "Couldn't start the mock homeserver:"
+                    << server.errorString();
+        return false;
+    }
+    qInfo() << "Mock homeserver is listening at" << server.url();
+    connection.setCacheState(false);
+    connection.setLazyLoading(lazyLoading);
+    connect(&connection, &Connection::connected, this, [this] {
+        startPhase(Phase::Syncing);
+        nextSync();
+    });
+    connect(&connection, &Connection::syncDone, this, &LoadDriver::onSyncDone);
+    connect(&connection, &Connection::syncError, this, [this] {
+        qWarning() << "Sync failed, retrying";
+        nextSync();
+    });
+    connect(&connection, &Connection::roomUpdatesProgress, this,
+            [this](qsizetype done, qsizetype total) {
+                if (done == total && syncTimer.isValid()) {
+                    ingestSamples.add(syncTimer);
+                    syncTimer.invalidate();
+                    nextSync();
+                }
+            });
+    connection.setHomeserver(server.url());
+    connection.assumeIdentity(MockHomeserver::userId(), "mock_token"_ls);
+    return true;
+}
+
+void LoadDriver::startPhase(Phase newPhase)
+{
+    phase = newPhase;
+    phaseTimer.start();
+    phaseDeadline.start(phaseTimeout);
+}
+
+void LoadDriver::onPhaseTimeout()
+{
+    switch (phase) {
+    case Phase::Syncing:
+        qWarning() << "Syncing timed out after" << server.stats().syncs
+                   << "syncs";
+        syncTimer.invalidate();
+        openRooms();
+        break;
+    case Phase::OpeningRooms:
+        qWarning() << "Opening rooms timed out with" << pendingRoomOps
+                   << "operations pending";
+        sendMessages();
+        break;
+    case Phase::Sending:
+        qWarning() << "Sending timed out with" << sendTimers.size()
+                   << "messages pending";
+        finish();
+        break;
+    case Phase::NotStarted:
+    case Phase::Done:
+        break;
+    }
+}
+
+void LoadDriver::nextSync()
+{
+    if (phase != Phase::Syncing)
+        return;
+    if (syncsLeft-- < 0) {
+        QTextStream(stdout)
+            << "Synced " << server.stats().syncs << " times in "
+            << phaseTimer.elapsed() << " ms\n";
+        openRooms();
+        return;
+    }
+    syncTimer.start();
+    connection.sync();
+}
+
+void LoadDriver::onSyncDone()
+{
+    if (phase != Phase::Syncing || !syncTimer.isValid())
+        return;
+    syncSamples.add(syncTimer);
+    // Room updates are applied in slices after the sync; wait for them
+    // unless there are none
+    if (server.lastSyncRoomCount() == 0) {
+        ingestSamples.add(syncTimer);
+        syncTimer.invalidate();
+        nextSync();
+    }
+}
+
+void LoadDriver::openRooms()
+{
+    startPhase(Phase::OpeningRooms);
+    // Loading members ends either with Room::allMembersLoaded or, once
+    // the retries are exhausted, with a failed /members request
+    connect(&connection, &Connection::requestFailed, this,
+            [this](BaseJob* job) {
+                if (phase == Phase::OpeningRooms
+                    && qobject_cast<GetMembersByRoomJob*>(job))
+                    failMembersLoading(job);
+            });
+    const auto rooms = connection.allRooms();
+    for (auto* room : rooms.mid(0, openRoomCount)) {
+        // Without lazy-loading, all members are already there
+        if (room->joinedCount() > room->joinedMemberIds().size()) {
+            ++pendingRoomOps;
+            membersTimers[room->id()].start();
+            connect(room, &Room::allMembersLoaded, this, [this, room] {
+                const auto it = membersTimers.constFind(room->id());
+                if (phase != Phase::OpeningRooms
+                    || it == membersTimers.cend())
+                    return;
+                membersSamples.add(*it);
+                membersTimers.erase(it);
+                completeRoomOp(true);
+            });
+        }
+        room->setDisplayed();
+
+        QElapsedTimer historyTimer;
+        historyTimer.start();
+        room->getPreviousContent(50);
+        // No job means the history is exhausted already
+        auto* historyJob = room->eventsHistoryJob();
+        if (!historyJob || !isJobPending(historyJob))
+            continue;
+        ++pendingRoomOps;
+        // Connected after the room's own handler, so the sample includes
+        // adding the loaded events to the timeline
+        connect(historyJob, &BaseJob::result, this,
+                [this, historyJob, historyTimer] {
+                    if (phase != Phase::OpeningRooms)
+                        return;
+                    const auto success = historyJob->status().good();
+                    if (success)
+                        historySamples.add(historyTimer);
+                    completeRoomOp(success);
+                });
+        // An abandoned job only emits finished()
+        connect(historyJob, &BaseJob::finished, this, [this, historyJob] {
+            if (phase == Phase::OpeningRooms
+                && historyJob->error() == BaseJob::Abandoned)
+                completeRoomOp(false);
+        });
+    }
+    if (pendingRoomOps == 0)
+        sendMessages();
+}
+
+void LoadDriver::failMembersLoading(const BaseJob* job)
+{
+    const auto path = job->requestUrl().path(QUrl::FullyDecoded);
+    for (auto it = membersTimers.begin(); it != membersTimers.end(); ++it)
+        if (path.contains(it.key())) {
+            membersTimers.erase(it);
+            completeRoomOp(false);
+            return;
+        }
+}
+
+void LoadDriver::completeRoomOp(bool success)
+{
+    if (!success)
+        ++roomOpFailures;
+    if (--pendingRoomOps > 0)
+        return;
+    QTextStream(stdout) << "Opened rooms in " << phaseTimer.elapsed()
+                        << " ms, " << roomOpFailures << " operations failed\n";
+    sendMessages();
+}
+
+void LoadDriver::sendMessages()
+{
+    startPhase(Phase::Sending);
+    const auto rooms = connection.allRooms();
+    if (rooms.isEmpty() || sendCount == 0) {
+        finish();
+        return;
+    }
+    for (auto* room : rooms) {
+        connect(room, &Room::messageSent, this,
+                [this](const QString& txnId) { finishSend(txnId, true); });
+        connect(room, &Room::pendingEventChanged, this, [this, room](int index) {
+            const auto& item = room->pendingEvents()[size_t(index)];
+            if (item.deliveryStatus() == EventStatus::SendingFailed)
+                finishSend(item->transactionId(), false);
+        });
+    }
+    for (int i = 0; i < sendCount; ++i) {
+        auto* room = rooms[i % rooms.size()];
+        QElapsedTimer timer;
+        timer.start();
+        sendTimers.insert(room->postPlainText("Load message "_ls
+                                              + QString::number(i)),
+                          timer);
+    }
+}
+
+void LoadDriver::finishSend(const QString& txnId, bool success)
+{
+    const auto it = sendTimers.constFind(txnId);
+    if (phase != Phase::Sending || it == sendTimers.cend())
+        return;
+    if (success)
+        sendSamples.add(*it);
+    else
+        ++sendFailures;
+    sendTimers.erase(it);
+    if (sendTimers.isEmpty()) {
+        const auto elapsed = phaseTimer.elapsed();
+        QTextStream(stdout)
+            << "Sent " << sendCount - sendFailures << " messages in "
+            << elapsed << " ms (" << sendCount * 1000 / std::max(elapsed, 1LL)
+            << " per second), " << sendFailures << " failed\n";
+        finish();
+    }
+}
+
+void LoadDriver::finish()
+{
+    phase = Phase::Done;
+    phaseDeadline.stop();
+    QTextStream out(stdout);
+    syncSamples.report(out);
+    ingestSamples.report(out);
+    membersSamples.report(out);
+    historySamples.report(out);
+    sendSamples.report(out);
+    const auto& stats = server.stats();
+    out << "Server: " << stats.requests << " requests, " << stats.syncs
+        << " syncs, " << stats.sentEvents << " events sent, " << stats.errors
+        << " injected errors, " << stats.rateLimited << " rate-limited, "
+        << stats.notFound << " not found\n";
+    auto memoryBytes = connection.memoryUsage().totalBytes();
+    for (auto* room : connection.allRooms())
+        memoryBytes += room->memoryUsage().totalBytes();
+    out << "Approximate memory used by the connection and rooms: "
+        << memoryBytes / 1024 << " KiB\n";
+    QCoreApplication::quit();
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Load testing of libQuotient against a local mock homeserver"_ls);
+    parser.addHelpOption();
+    const auto addIntOption = [&parser](const QString& name,
+                                        const QString& description,
+                                        int defaultValue) {
+        parser.addOption({ name, description, "n"_ls,
+                           QString::number(defaultValue) });
+        return name;
+    };
+    const auto addDoubleOption = [&parser](const QString& name,
+                                           const QString& description) {
+        parser.addOption({ name, description, "share"_ls, "0"_ls });
+        return name;
+    };
+    const auto rooms = addIntOption("rooms"_ls, "Joined rooms"_ls, 1000);
+    const auto members = addIntOption("members"_ls, "Members per room"_ls, 200);
+    const auto messages =
+        addIntOption("messages"_ls, "Events per room in the initial sync"_ls, 50);
+    const auto syncs = addIntOption("syncs"_ls, "Incremental syncs"_ls, 100);
+    const auto roomsPerSync =
+        addIntOption("rooms-per-sync"_ls, "Rooms updated in each sync"_ls, 50);
+    const auto messagesPerSync = addIntOption(
+        "messages-per-sync"_ls, "Events per updated room in each sync"_ls, 5);
+    const auto openRooms = addIntOption(
+        "open"_ls, "Rooms to load members and history for"_ls, 20);
+    const auto sends = addIntOption("sends"_ls, "Messages to send"_ls, 1000);
+    const auto latency =
+        addIntOption("latency"_ls, "Server latency, milliseconds"_ls, 0);
+    const auto jitter = addIntOption(
+        "jitter"_ls, "Random addition to the latency, milliseconds"_ls, 0);
+    const auto errorRate =
+        addDoubleOption("error-rate"_ls, "Share of requests failing with 500"_ls);
+    const auto rateLimitRate = addDoubleOption(
+        "rate-limit-rate"_ls, "Share of requests failing with 429"_ls);
+    const auto phaseTimeout = addIntOption(
+        "phase-timeout"_ls,
+        "Time limit for each of syncing, opening rooms and sending, seconds"_ls,
+        300);
+    const QCommandLineOption noLazyLoading { "no-lazy-loading"_ls,
+                                             "Don't lazy-load members"_ls };
+    parser.addOption(noLazyLoading);
+    parser.process(app);
+
+    const auto intValue = [&parser](const QString& name) {
+        return parser.value(name).toInt();
+    };
+    MockHomeserver::Config config;
+    config.rooms = intValue(rooms);
+    config.roomShape.members = intValue(members);
+    config.roomShape.messages = intValue(messages);
+    config.roomsPerSync = intValue(roomsPerSync);
+    config.messagesPerSync = intValue(messagesPerSync);
+    config.latency = std::chrono::milliseconds(intValue(latency));
+    config.latencyJitter = std::chrono::milliseconds(intValue(jitter));
+    config.errorRate = parser.value(errorRate).toDouble();
+    config.rateLimitRate = parser.value(rateLimitRate).toDouble();
+
+    LoadDriver driver(config, intValue(syncs), intValue(openRooms),
+                      intValue(sends),
+                      std::chrono::seconds(intValue(phaseTimeout)));
+    if (!driver.start(!parser.isSet(noLazyLoading)))
+        return 1;
+    return app.exec();
+}
@@ -0,0 +1,383 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "mockhomeserver.h"
+
+#include <Quotient/util.h>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QStringBuilder>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpSocket>
+
+#include <algorithm>
+
+using namespace Quotient;
+
+namespace {
+// A 1x1 transparent PNG, served for any media request
+constexpr unsigned char PngPixel[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+    0x08, 0x06, 0x00, 0x00, 0x00, 0x1f, 0x15, 0xc4, 0x89, 0x00, 0x00, 0x00,
+    0x0d, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0x00, 0x01, 0x00, 0x00,
+    0x05, 0x00, 0x01, 0x0d, 0x0a, 0x2d, 0xb4, 0x00, 0x00, 0x00, 0x00, 0x49,
+    0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82
+};
+
+constexpr auto HistoryTokenPrefix = u'h';
+
+QByteArray reasonPhrase(int httpCode)
+{
+    switch (httpCode) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 429: return "Too Many Requests";
+    default: return "Internal Server Error";
+    }
+}
+
+int roomIndexFromId(const QString& roomId)
+{
+    // SyncDataGenerator makes room ids of the form !<index>:<server>
+    bool ok = false;
+    const auto index = roomId.mid(1, roomId.indexOf(u':') - 1).toInt(&ok);
+    return ok ? index : -1;
+}
+} // namespace
+
+MockHomeserver::MockHomeserver(Config config, QObject* parent)
+    : QTcpServer(parent), cfg(std::move(config))
+{
+    connect(this, &QTcpServer::newConnection, this,
+            &MockHomeserver::acceptConnection);
+}
+
+QUrl MockHomeserver::url() const
+{
+    QUrl result;
+    result.setScheme("http"_ls);
+    result.setHost(serverAddress().toString());
+    result.setPort(serverPort());
+    return result;
+}
+
+void MockHomeserver::acceptConnection()
+{
+    while (auto* socket = nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this,
+                [this, socket] { readRequests(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket] {
+            buffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MockHomeserver::readRequests(QTcpSocket* socket)
+{
+    auto& buffer = buffers[socket];
+    buffer += socket->readAll();
+    while (true) {
+        const auto headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0)
+            return;
+
+        const auto lines = buffer.left(headerEnd).split('\n');
+        const auto requestLine = lines.front().trimmed().split(' ');
+        if (requestLine.size() < 2) {
+            respond(socket, error(400, "M_UNKNOWN"_ls, "Malformed request"_ls));
+            socket->disconnectFromHost();
+            return;
+        }
+        qsizetype contentLength = 0;
+        for (const auto& line : lines.mid(1))
+            if (const auto colon = line.indexOf(':');
+                colon > 0
+                && line.left(colon).trimmed().compare("content-length",
+                                                      Qt::CaseInsensitive)
+                       == 0)
+                contentLength = line.mid(colon + 1).trimmed().toLongLong();
+
+        const auto requestSize = headerEnd + 4 + contentLength;
+        if (buffer.size() < requestSize)
+            return; // Wait for the rest of the body
+
+        dispatch(socket, { requestLine[0], QUrl::fromEncoded(requestLine[1]),
+                           buffer.mid(headerEnd + 4, contentLength) });
+        buffer.remove(0, requestSize);
+    }
+}
+
+void MockHomeserver::dispatch(QPointer<QTcpSocket> socket,
+                              const Request& request)
+{
+    ++counters.requests;
+    auto* const rng = QRandomGenerator::global();
+    const auto dice = rng->generateDouble();
+    Response response;
+    if (dice < cfg.rateLimitRate) {
+        ++counters.rateLimited;
+        response = error(429, "M_LIMIT_EXCEEDED"_ls, "Too many requests"_ls);
+        response.json.insert("retry_after_ms"_ls,
+                             qint64(cfg.retryAfter.count()));
+    } else if (dice < cfg.rateLimitRate + cfg.errorRate) {
+        ++counters.errors;
+        response = error(500, "M_UNKNOWN"_ls, "Injected failure"_ls);
+    } else {
+        response = route(request);
+        if (response.httpCode == 404)
+            ++counters.notFound;
+    }
+
+    auto delay = cfg.latency;
+    if (cfg.latencyJitter.count() > 0)
+        delay += std::chrono::milliseconds(
+            rng->bounded(qint64(cfg.latencyJitter.count()) + 1));
+    if (delay.count() == 0) {
+        respond(socket, response);
+        return;
+    }
+    QTimer::singleShot(delay, this, [this, socket, response] {
+        if (socket)
+            respond(socket, response);
+    });
+}
+
+void MockHomeserver::respond(QTcpSocket* socket, const Response& response)
+{
+    const auto body = response.rawBody.isEmpty()
+                          ? QJsonDocument(response.json).toJson(
+                                QJsonDocument::Compact)
+                          : response.rawBody;
+    socket->write("HTTP/1.1 " % QByteArray::number(response.httpCode) % ' '
+                  % reasonPhrase(response.httpCode)
+                  % "\r\nContent-Type: " % response.contentType
+                  % "\r\nContent-Length: " % QByteArray::number(body.size())
+                  % "\r\nConnection: keep-alive\r\n\r\n");
+    socket->write(body);
+}
+
+MockHomeserver::Response MockHomeserver::route(const Request& request)
+{
+    QStringList segments;
+    for (const auto& s : request.url.path(QUrl::FullyEncoded).split(u'/'))
+        if (!s.isEmpty())
+            segments.append(QUrl::fromPercentEncoding(s.toLatin1()));
+    const QUrlQuery query { request.url };
+    const auto notFound =
+        error(404, "M_UNRECOGNIZED"_ls, "Unrecognized request"_ls);
+    if (segments.size() < 3 || segments[0] != "_matrix"_ls)
+        return notFound;
+
+    if (segments[1] == "media"_ls) {
+        if (segments.size() > 3 && segments[3] == "upload"_ls)
+            return { 200,
+                     { { "content_uri"_ls,
+                         QString("mxc://example.org/upload"_ls
+                                 % QString::number(++uploadCount)) } } };
+        if (segments.size() > 3 && segments[3] == "config"_ls)
+            return { 200, { { "m.upload.size"_ls, 50'000'000 } } };
+        return media();
+    }
+    if (segments[1] != "client"_ls)
+        return notFound;
+    if (segments[2] == "versions"_ls)
+        return { 200,
+                 { { "versions"_ls,
+                     QJsonArray { "r0.6.1"_ls, "v1.1"_ls, "v1.5"_ls,
+                                  "v1.11"_ls } } } };
+
+    // Skip the API version: r0, v3, v1 and so on
+    const auto path = segments.mid(3);
+    if (path.isEmpty())
+        return notFound;
+    const auto& endpoint = path.front();
+    if (endpoint == "sync"_ls)
+        return sync(query);
+    if (endpoint == "login"_ls)
+        return { 200,
+                 { { "flows"_ls,
+                     QJsonArray { QJsonObject {
+                         { "type"_ls, "m.login.password"_ls } } } } } };
+    if (endpoint == "account"_ls && path.value(1) == "whoami"_ls)
+        return { 200,
+                 { { "user_id"_ls, userId() },
+                   { "device_id"_ls, "MOCKDEVICE"_ls } } };
+    if (endpoint == "capabilities"_ls) {
+        const QJsonObject roomVersions {
+            { "default"_ls, "9"_ls },
+            { "available"_ls, QJsonObject { { "9"_ls, "stable"_ls } } }
+        };
+        return { 200,
+                 { { "capabilities"_ls,
+                     QJsonObject { { "m.room_versions"_ls, roomVersions } } } } };
+    }
+    if (endpoint == "profile"_ls && path.size() > 1)
+        return { 200,
+                 { { "displayname"_ls,
+                     path[1].mid(1).section(u':', 0, 0) } } };
+    if (endpoint == "keys"_ls) {
+        const auto& keysEndpoint = path.value(1);
+        if (keysEndpoint == "upload"_ls)
+            return { 200,
+                     { { "one_time_key_counts"_ls,
+                         QJsonObject { { "signed_curve25519"_ls, 50 } } } } };
+        if (keysEndpoint == "query"_ls)
+            return { 200,
+                     { { "device_keys"_ls, QJsonObject() },
+                       { "failures"_ls, QJsonObject() } } };
+        if (keysEndpoint == "claim"_ls)
+            return { 200,
+                     { { "one_time_keys"_ls, QJsonObject() },
+                       { "failures"_ls, QJsonObject() } } };
+        if (keysEndpoint == "changes"_ls)
+            return { 200,
+                     { { "changed"_ls, QJsonArray() },
+                       { "left"_ls, QJsonArray() } } };
+        return notFound;
+    }
+    if (endpoint == "sendToDevice"_ls)
+        return { 200, {} };
+    if (endpoint == "rooms"_ls && path.size() > 2) {
+        const auto& roomId = path[1];
+        const auto roomIndex = roomIndexFromId(roomId);
+        if (roomIndex < 0 || roomIndex >= cfg.rooms)
+            return error(403, "M_FORBIDDEN"_ls, "Not a member of the room"_ls);
+        if (path[2] == "messages"_ls)
+            return messages(roomIndex, query);
+        if (path[2] == "members"_ls)
+            return members(roomIndex);
+        if (path[2] == "send"_ls && path.size() > 4)
+            return sendEvent(roomId, path[3], path[4], request.body);
+    }
+    return notFound;
+}
+
+MockHomeserver::Response MockHomeserver::sync(const QUrlQuery& query)
+{
+    ++counters.syncs;
+    const auto& shape = cfg.roomShape;
+    QJsonObject joinedRooms;
+    if (!query.hasQueryItem("since"_ls)) {
+        const auto filter = QJsonDocument::fromJson(
+            query.queryItemValue("filter"_ls, QUrl::FullyDecoded).toUtf8());
+        const auto lazyLoad = filter["room"_ls]["state"_ls]["lazy_load_members"_ls]
+                                  .toBool();
+        auto initialShape = shape;
+        initialShape.stateMembers = lazyLoad ? cfg.lazyLoadedMembers : -1;
+        roomEventCounts.clear();
+        for (int i = 0; i < cfg.rooms; ++i) {
+            nextEvents(i, shape.messages);
+            joinedRooms.insert(SyncDataGenerator::roomId(i),
+                               generator.makeRoomJson(i, initialShape));
+        }
+    } else {
+        auto* const rng = QRandomGenerator::global();
+        const auto makeRoom = [](QJsonArray events) {
+            return QJsonObject {
+                { "timeline"_ls, QJsonObject { { "events"_ls, events },
+                                               { "limited"_ls, false } } }
+            };
+        };
+        for (int i = 0; i < std::min(cfg.roomsPerSync, cfg.rooms); ++i) {
+            const auto roomIndex = static_cast<int>(rng->bounded(cfg.rooms));
+            joinedRooms.insert(
+                SyncDataGenerator::roomId(roomIndex),
+                makeRoom(generator.makeTimeline(
+                    roomIndex, cfg.messagesPerSync, shape.members,
+                    nextEvents(roomIndex, cfg.messagesPerSync))));
+        }
+        for (auto&& [roomId, event] : std::exchange(echoes, {})) {
+            auto roomJson = joinedRooms.value(roomId).toObject();
+            auto timeline = roomJson.value("timeline"_ls)["events"_ls].toArray();
+            timeline.append(event);
+            joinedRooms.insert(roomId, makeRoom(timeline));
+        }
+    }
+    lastSyncRooms = static_cast<int>(joinedRooms.size());
+    return { 200,
+             { { "next_batch"_ls, QString(u's' % QString::number(++syncBatch)) },
+               { "rooms"_ls, QJsonObject { { "join"_ls, joinedRooms } } } } };
+}
+
+MockHomeserver::Response MockHomeserver::messages(int roomIndex,
+                                                  const QUrlQuery& query)
+{
+    // Tokens made by SyncDataGenerator (prev<n>) lead to the first page;
+    // the following pages have tokens of the form h<page>
+    const auto from = query.queryItemValue("from"_ls);
+    const auto page =
+        from.startsWith(HistoryTokenPrefix) ? from.mid(1).toInt() : 0;
+    const auto limit =
+        std::clamp(query.queryItemValue("limit"_ls).toInt(), 1, 1000);
+    auto events = generator.makeTimeline(roomIndex, limit,
+                                         cfg.roomShape.members,
+                                         1'000'000 + page * 1000);
+    // The history goes backwards, so do the events
+    std::reverse(events.begin(), events.end());
+    QJsonObject json { { "start"_ls, from }, { "chunk"_ls, events } };
+    if (page + 1 < cfg.historyPages)
+        json.insert("end"_ls,
+                    QString(HistoryTokenPrefix % QString::number(page + 1)));
+    return { 200, json };
+}
+
+MockHomeserver::Response MockHomeserver::members(int roomIndex)
+{
+    return { 200,
+             { { "chunk"_ls,
+                 generator.makeMemberEvents(roomIndex, 0,
+                                            cfg.roomShape.members,
+                                            cfg.roomShape.namesakeEvery) } } };
+}
+
+MockHomeserver::Response MockHomeserver::sendEvent(const QString& roomId,
+                                                   const QString& eventType,
+                                                   const QString& txnId,
+                                                   const QByteArray& body)
+{
+    ++counters.sentEvents;
+    const QString eventId = "$sent"_ls % QString::number(++sentEventCount)
+                         % ":example.org"_ls;
+    echoes.append(
+        { roomId,
+          { { "type"_ls, eventType },
+            { "event_id"_ls, eventId },
+            { "room_id"_ls, roomId },
+            { "sender"_ls, userId() },
+            { "origin_server_ts"_ls, QDateTime::currentMSecsSinceEpoch() },
+            { "content"_ls, QJsonDocument::fromJson(body).object() },
+            { "unsigned"_ls,
+              QJsonObject { { "transaction_id"_ls, txnId } } } } });
+    return { 200, { { "event_id"_ls, eventId } } };
+}
+
+MockHomeserver::Response MockHomeserver::media()
+{
+    return { 200,
+             {},
+             QByteArray(reinterpret_cast<const char*>(PngPixel),
+                        sizeof(PngPixel)),
+             "image/png" };
+}
+
+MockHomeserver::Response MockHomeserver::error(int httpCode,
+                                               const QString& errcode,
+                                               const QString& message)
+{
+    return { httpCode, { { "errcode"_ls, errcode }, { "error"_ls, message } } };
+}
+
+int MockHomeserver::nextEvents(int roomIndex, int count)
+{
+    auto& eventCount = roomEventCounts[roomIndex];
+    return std::exchange(eventCount, eventCount + count);
+}
+
+#include "moc_mockhomeserver.cpp"
@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#pragma once
+
+#include "syncdatagenerator.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
+#include <QtCore/QUrl>
+#include <QtCore/QUrlQuery>
+#include <QtNetwork/QTcpServer>
+
+#include <chrono>
+
+class QTcpSocket;
+
+namespace Quotient {
+
+//! \brief A stand-in for a homeserver, for load testing on the local machine
+//!
+//! The server speaks plain HTTP/1.1 (without pipelining) and serves
+//! synthetic data made by SyncDataGenerator: the initial and incremental
+//! /sync responses, room history (/messages), member lists (/members),
+//! key management (/keys/*) endpoints and media. Events sent to rooms are
+//! echoed in the next /sync response. Responses can be delayed, and a share
+//! of them can be replaced with 500 errors or 429 (rate limited) responses.
+//!
+//! Endpoints not listed above get 404 with M_UNRECOGNIZED, the way
+//! a homeserver responds to unsupported requests.
+class MockHomeserver : public QTcpServer {
+    Q_OBJECT
+public:
+    struct Config {
+        int rooms = 100;
+        SyncDataGenerator::RoomShape roomShape {};
+        //! Members sent with the room state when the client asks to
+        //! lazy-load members; the rest only come with /members
+        int lazyLoadedMembers = 20;
+        //! Rooms getting new messages in each incremental /sync
+        int roomsPerSync = 10;
+        int messagesPerSync = 5;
+        //! Pages of history available via /messages in each room
+        int historyPages = 10;
+        std::chrono::milliseconds latency { 0 };
+        //! Up to this much is randomly added to the latency
+        std::chrono::milliseconds latencyJitter { 0 };
+        //! Shares of requests to fail with 500 and 429 respectively
+        double errorRate = 0;
+        double rateLimitRate = 0;
+        std::chrono::milliseconds retryAfter { 100 };
+    };
+
+    struct Stats {
+        qsizetype requests = 0;
+        qsizetype syncs = 0;
+        qsizetype sentEvents = 0;
+        qsizetype errors = 0;
+        qsizetype rateLimited = 0;
+        qsizetype notFound = 0;
+    };
+
+    explicit MockHomeserver(Config config, QObject* parent = nullptr);
+
+    static QString userId() { return SyncDataGenerator::userId(0); }
+
+    //! The URL to pass to Connection::setHomeserver(); the server must listen
+    QUrl url() const;
+    const Config& config() const { return cfg; }
+    //! Change the latency and failure injection settings on the go
+    void setConfig(Config newConfig) { cfg = std::move(newConfig); }
+    const Stats& stats() const { return counters; }
+    //! Rooms in the last /sync response, for clients to know what to wait for
+    int lastSyncRoomCount() const { return lastSyncRooms; }
+
+private:
+    struct Request {
+        QByteArray method;
+        QUrl url;
+        QByteArray body;
+    };
+    struct Response {
+        int httpCode = 200;
+        QJsonObject json {};
+        QByteArray rawBody {};
+        QByteArray contentType = "application/json";
+    };
+    struct Echo {
+        QString roomId;
+        QJsonObject event;
+    };
+
+    Config cfg;
+    Stats counters;
+    SyncDataGenerator generator;
+    QHash<QTcpSocket*, QByteArray> buffers;
+    //! Event counts generated so far per room index, to keep event ids unique
+    QHash<int, int> roomEventCounts;
+    QList<Echo> echoes;
+    int syncBatch = 0;
+    int sentEventCount = 0;
+    int uploadCount = 0;
+    int lastSyncRooms = 0;
+
+    void acceptConnection();
+    void readRequests(QTcpSocket* socket);
+    void dispatch(QPointer<QTcpSocket> socket, const Request& request);
+    void respond(QTcpSocket* socket, const Response& response);
+
+    Response route(const Request& request);
+    Response sync(const QUrlQuery& query);
+    Response messages(int roomIndex, const QUrlQuery& query);
+    Response members(int roomIndex);
+    Response sendEvent(const QString& roomId, const QString& eventType,
+                       const QString& txnId, const QByteArray& body);
+    static Response media();
+    static Response error(int httpCode, const QString& errcode,
+                         const QString& message);
+
+    int nextEvents(int roomIndex, int count);
+};
+
+} // namespace Quotient
@@ -0,0 +1,261 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#include "syncdatagenerator.h"
+
+#include <Quotient/syncdata.h>
+
+#include <QtCore/QCborValue>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QStringBuilder>
+
+#include <algorithm>
+#include <array>
+
+using namespace Quotient;
+
+namespace {
+constexpr auto ServerName = "example.org"_ls;
+}
+
+QString SyncDataGenerator::roomId(int roomIndex)
+{
+    return u'!' % QString::number(roomIndex) % u':' % ServerName;
+}
+
+QString SyncDataGenerator::userId(int userIndex)
+{
+    return "@user"_ls % QString::number(userIndex) % u':' % ServerName;
+}
+
+QJsonObject SyncDataGenerator::makeEvent(const QString& type, int roomIndex,
+                                         int eventIndex, const QString& sender,
+                                         QJsonObject content)
+{
+    return { { "type"_ls, type },
+             { "event_id"_ls, QString(u'$' % QString::number(roomIndex) % u'_'
+                                          % QString::number(eventIndex)
+                                          % u':' % ServerName) },
+             { "room_id"_ls, roomId(roomIndex) },
+             { "sender"_ls, sender },
+             { "origin_server_ts"_ls, ts += 1000 },
+             { "content"_ls, std::move(content) } };
+}
+
+QJsonObject SyncDataGenerator::makeStateEvent(const QString& type,
+                                              const QString& stateKey,
+                                              int roomIndex, int eventIndex,
+                                              const QString& sender,
+                                              QJsonObject content)
+{
+    auto json = makeEvent(type, roomIndex, eventIndex, sender,
+                          std::move(content));
+    json.insert("state_key"_ls, stateKey);
+    return json;
+}
+
+QJsonArray SyncDataGenerator::makeMemberEvents(int roomIndex, int firstMember,
+                                               int count, int namesakeEvery)
+{
+    QJsonArray events;
+    for (int i = firstMember; i < firstMember + count; ++i) {
+        const auto nameIndex =
+            namesakeEvery > 0 && i > 0 && i % namesakeEvery == 0 ? i - 1 : i;
+        events.append(makeStateEvent(
+            "m.room.member"_ls, userId(i), roomIndex, 3 + i, userId(i),
+            { { "membership"_ls, "join"_ls },
+              { "displayname"_ls,
+                QString("User "_ls % QString::number(nameIndex)) } }));
+    }
+    return events;
+}
+
+QJsonArray SyncDataGenerator::makeTimeline(int roomIndex, int count,
+                                           int memberCount, int skipEvents)
+{
+    // Event indices of the timeline start after those of the state
+    const auto firstIndex = memberCount + 3 + skipEvents;
+    QJsonArray events;
+    QString lastMessageId;
+    for (int i = 0; i < count; ++i) {
+        const auto eventIndex = firstIndex + i;
+        const auto sender =
+            userId(static_cast<int>(rng.bounded(std::max(memberCount, 1))));
+        const auto kind = rng.bounded(100);
+        QJsonObject event;
+        if (kind < 60 || lastMessageId.isEmpty()) {
+            event = makeEvent("m.room.message"_ls, roomIndex, eventIndex,
+                              sender,
+                              { { "msgtype"_ls, "m.text"_ls },
+                                { "body"_ls, QString("Message number "_ls
+                                                         % QString::number(i)) } });
+        } else if (kind < 70) {
+            event = makeEvent("m.room.message"_ls, roomIndex, eventIndex,
+                              sender,
+                              { { "msgtype"_ls, "m.notice"_ls },
+                                { "body"_ls, "Notice"_ls } });
+        } else if (kind < 75) {
+            event = makeEvent("m.room.message"_ls, roomIndex, eventIndex,
+                              sender,
+                              { { "msgtype"_ls, "m.emote"_ls },
+                                { "body"_ls, "waves"_ls } });
+        } else if (kind < 85) {
+            event = makeEvent(
+                "m.room.message"_ls, roomIndex, eventIndex, sender,
+                { { "msgtype"_ls, "m.image"_ls },
+                  { "body"_ls, "image.png"_ls },
+                  { "url"_ls, QString("mxc://example.org/image"_ls
+                                          % QString::number(i)) },
+                  { "info"_ls, QJsonObject { { "w"_ls, 640 },
+                                             { "h"_ls, 480 },
+                                             { "mimetype"_ls, "image/png"_ls },
+                                             { "size"_ls, 100000 } } } });
+        } else if (kind < 97) {
+            event = makeEvent(
+                "m.reaction"_ls, roomIndex, eventIndex, sender,
+                { { "m.relates_to"_ls,
+                    QJsonObject { { "rel_type"_ls, "m.annotation"_ls },
+                                  { "event_id"_ls, lastMessageId },
+                                  { "key"_ls, QStringLiteral("👍") } } } });
+        } else {
+            event = makeEvent("m.room.redaction"_ls, roomIndex, eventIndex,
+                              sender, {});
+            event.insert("redacts"_ls, lastMessageId);
+            lastMessageId.clear();
+        }
+        if (event.value("type"_ls).toString() == "m.room.message"_ls)
+            lastMessageId = event.value("event_id"_ls).toString();
+        events.append(event);
+    }
+    return events;
+}
+
+QJsonObject SyncDataGenerator::makeRoomJson(int roomIndex,
+                                            const RoomShape& shape)
+{
+    const auto creator = userId(0);
+    QJsonArray state {
+        makeStateEvent("m.room.create"_ls, {}, roomIndex, 0, creator,
+                       { { "creator"_ls, creator },
+                         { "room_version"_ls, "9"_ls } }),
+        makeStateEvent("m.room.power_levels"_ls, {}, roomIndex, 1, creator,
+                       { { "users"_ls, QJsonObject { { creator, 100 } } } }),
+        makeStateEvent("m.room.name"_ls, {}, roomIndex, 2, creator,
+                       { { "name"_ls,
+                           QString("Room "_ls % QString::number(roomIndex)) } })
+    };
+    const auto stateMembers = shape.stateMembers < 0
+                                  ? shape.members
+                                  : std::min(shape.stateMembers, shape.members);
+    for (const auto& memberEvent :
+         makeMemberEvents(roomIndex, 0, stateMembers, shape.namesakeEvery))
+        state.append(memberEvent);
+
+    return {
+        { "state"_ls, QJsonObject { { "events"_ls, state } } },
+        { "timeline"_ls,
+          QJsonObject {
+              { "events"_ls,
+                makeTimeline(roomIndex, shape.messages, shape.members) },
+              { "limited"_ls, true },
+              { "prev_batch"_ls,
+                QString("prev"_ls % QString::number(roomIndex)) } } },
+        { "ephemeral"_ls, QJsonObject { { "events"_ls, QJsonArray() } } },
+        { "account_data"_ls, QJsonObject { { "events"_ls, QJsonArray() } } },
+        { "summary"_ls, QJsonObject { { "m.joined_member_count"_ls,
+                                        shape.members } } },
+        { "unread_notifications"_ls,
+          QJsonObject { { "notification_count"_ls, 0 },
+                        { "highlight_count"_ls, 0 } } }
+    };
+}
+
+QJsonObject SyncDataGenerator::makeSyncJson(int roomCount,
+                                            const RoomShape& shape)
+{
+    QJsonObject joinedRooms;
+    for (int i = 0; i < roomCount; ++i)
+        joinedRooms.insert(roomId(i), makeRoomJson(i, shape));
+    return { { "next_batch"_ls, "s1_benchmark"_ls },
+             { "rooms"_ls, QJsonObject { { "join"_ls, joinedRooms } } } };
+}
+
+QString SyncDataGenerator::makeKey()
+{
+    std::array<quint32, 8> bits;
+    rng.fillRange(bits.data(), bits.size());
+    return QString::fromLatin1(
+        QByteArray(reinterpret_cast<const char*>(bits.data()), sizeof(bits))
+            .toBase64(QByteArray::OmitTrailingEquals));
+}
+
+QJsonObject SyncDataGenerator::makeKeysQueryJson(int userCount,
+                                                 int devicesPerUser)
+{
+    QJsonObject deviceKeys;
+    for (int u = 0; u < userCount; ++u) {
+        const auto user = userId(u);
+        QJsonObject devices;
+        for (int d = 0; d < devicesPerUser; ++d) {
+            const QString deviceId = "DEVICE"_ls % QString::number(d);
+            devices.insert(
+                deviceId,
+                QJsonObject {
+                    { "user_id"_ls, user },
+                    { "device_id"_ls, deviceId },
+                    { "algorithms"_ls,
+                      QJsonArray { "m.olm.v1.curve25519-aes-sha2"_ls,
+                                   "m.megolm.v1.aes-sha2"_ls } },
+                    { "keys"_ls,
+                      QJsonObject {
+                          { QString("curve25519:"_ls % deviceId), makeKey() },
+                          { QString("ed25519:"_ls % deviceId), makeKey() } } },
+                    { "signatures"_ls,
+                      QJsonObject {
+                          { user,
+                            QJsonObject {
+                                { QString("ed25519:"_ls % deviceId),
+                                  QString(makeKey() % makeKey()) } } } } },
+                    { "unsigned"_ls,
+                      QJsonObject { { "device_display_name"_ls,
+                                      QString("Device "_ls
+                                              % QString::number(d)) } } } });
+        }
+        deviceKeys.insert(user, devices);
+    }
+    return { { "failures"_ls, QJsonObject() },
+             { "device_keys"_ls, deviceKeys } };
+}
+
+void SyncDataGenerator::writeStateCache(const QString& cacheDir, int roomCount,
+                                        const RoomShape& shape, bool binary)
+{
+    const auto writeFile = [binary](const QString& fileName,
+                                    const QJsonObject& json) {
+        QFile f { fileName };
+        if (!f.open(QFile::WriteOnly)) {
+            qCritical() << "Couldn't open" << fileName << "for writing";
+            return;
+        }
+        f.write(binary ? QCborValue::fromJsonValue(json).toCbor()
+                       : QJsonDocument(json).toJson(QJsonDocument::Compact));
+    };
+
+    const QDir dir { cacheDir };
+    QJsonObject joinedRooms;
+    for (int i = 0; i < roomCount; ++i) {
+        joinedRooms.insert(roomId(i), QJsonValue::Null);
+        writeFile(dir.filePath(SyncData::fileNameForRoom(roomId(i))),
+                  makeRoomJson(i, shape));
+    }
+    const auto [cacheMajor, cacheMinor] = SyncData::cacheVersion();
+    writeFile(dir.filePath("state.json"_ls),
+              { { "cache_version"_ls,
+                  QJsonObject { { "major"_ls, cacheMajor },
+                                { "minor"_ls, cacheMinor } } },
+                { "next_batch"_ls, "s1_benchmark"_ls },
+                { "rooms"_ls, QJsonObject { { "join"_ls, joinedRooms } } } });
+}
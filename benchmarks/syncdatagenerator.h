@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: 2026 Kitsune Ral <Kitsune-Ral@users.sf.net>
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+#pragma once
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRandomGenerator>
+
+namespace Quotient {
+
+//! \brief Generator of synthetic sync responses and state caches
+//!
+//! Produces rooms with a given number of members and timeline events;
+//! the timeline mixes text messages, notices, emotes, images, reactions
+//! and redactions. The output is deterministic for a given seed.
+class SyncDataGenerator {
+public:
+    struct RoomShape {
+        int members = 100;
+        int messages = 100;
+        //! Every n-th member gets the name of the previous one, to exercise
+        //! disambiguation; 0 means all names are unique
+        int namesakeEvery = 10;
+        //! Members included in the room state, as a server does when
+        //! members are lazy-loaded; -1 means all of them
+        int stateMembers = -1;
+    };
+
+    explicit SyncDataGenerator(quint32 seed = 42) : rng(seed) {}
+
+    static QString roomId(int roomIndex);
+    static QString userId(int userIndex);
+
+    //! Make the JSON of a single joined room as it comes in a sync response
+    QJsonObject makeRoomJson(int roomIndex, const RoomShape& shape);
+    //! Make a whole sync response with \p roomCount joined rooms
+    QJsonObject makeSyncJson(int roomCount, const RoomShape& shape);
+    //! \brief Make a /keys/query response for \p userCount users
+    //!
+    //! Each user has \p devicesPerUser devices with signed Curve25519 and
+    //! Ed25519 keys and a display name.
+    QJsonObject makeKeysQueryJson(int userCount, int devicesPerUser);
+    //! \brief Write a state cache with \p roomCount rooms to \p cacheDir
+    //!
+    //! The result is laid out the way Connection::saveState() does it and
+    //! can be loaded with Connection::loadState().
+    void writeStateCache(const QString& cacheDir, int roomCount,
+                         const RoomShape& shape, bool binary = true);
+
+    //! Make member events for \p count members starting from \p firstMember
+    QJsonArray makeMemberEvents(int roomIndex, int firstMember, int count,
+                                int namesakeEvery = 10);
+    //! \brief Make events of a timeline, with event ids unique within the room
+    //!
+    //! Timelines made with different \p skipEvents don't overlap as long as
+    //! the skipped ranges don't.
+    QJsonArray makeTimeline(int roomIndex, int count, int memberCount,
+                            int skipEvents = 0);
+
+private:
+    QRandomGenerator rng;
+    qint64 ts = 1'600'000'000'000;
+
+    //! Make a random unpadded base64 string the size of a 256-bit key
+    QString makeKey();
+
+    QJsonObject makeEvent(const QString& type, int roomIndex, int eventIndex,
+                          const QString& sender, QJsonObject content);
+    QJsonObject makeStateEvent(const QString& type, const QString& stateKey,
+                               int roomIndex, int eventIndex,
+                               const QString& sender, QJsonObject content);
+};
+
+} // namespace Quotient
@@ -464,7 +464,8 @@ struct DownloadRunner {
     {
         QEventLoop el;
         QScopedPointer<QNetworkReply, QScopedPointerDeleteLater> reply {
-            NetworkAccessManager::instance()->get(QNetworkRequest(url))
+            NetworkAccessManager::instance(NetworkLane::Bulk)
+                ->get(QNetworkRequest(url))
         };
         QObject::connect(
             reply.data(), &QNetworkReply::finished, &el, [&el] { el.exit(); },